@@ -0,0 +1,523 @@
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+#include <benchmark/benchmark.h>
+#include <dpipe/dpipe.h>
+#include <dpipe/utils/hardware.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+struct Payload {
+    uint64_t value{};
+};
+
+using PayloadFrame = dpipe::Frame<Payload>;
+
+// A payload of the given size, to measure how costs scale with the amount of data.
+template <std::size_t Bytes>
+struct Blob {
+    std::array<uint8_t, Bytes> data{};
+};
+
+struct CounterSource {
+    using OutputPayload = Payload;
+    std::optional<PayloadFrame> produce() {
+        return PayloadFrame::make(counter++);
+    }
+    uint64_t counter{};
+};
+
+struct PooledCounterSource {
+    using OutputPayload = Payload;
+    std::optional<PayloadFrame> produce() {
+        return PayloadFrame::make(pool, counter++);
+    }
+    dpipe::FramePool<Payload> pool;
+    uint64_t counter{};
+};
+
+struct PassFilter {
+    using InputPayload = Payload;
+    using OutputPayload = Payload;
+    std::optional<PayloadFrame> process(PayloadFrame&& frame) {
+        return frame;
+    }
+};
+
+struct DiscardSink {
+    using InputPayload = Payload;
+    void consume(PayloadFrame&& frame) {
+        benchmark::DoNotOptimize(frame->value);
+    }
+};
+
+// Reads one byte per cache line, so that the payload actually crosses threads, then counts frames.
+template <std::size_t Bytes>
+struct TouchSink {
+    using InputPayload = Blob<Bytes>;
+    void consume(dpipe::Frame<InputPayload>&& frame) {
+        uint8_t sum = 0;
+        for (std::size_t i = 0; i < Bytes; i += dpipe::CACHE_LINE_SIZE) {
+            sum += frame->data[i];
+        }
+        benchmark::DoNotOptimize(sum);
+        received.fetch_add(1, std::memory_order_release);
+    }
+    std::atomic<uint64_t>& received;
+};
+
+// Pushes the same frame over and over, so that only the cost of crossing the arm is measured.
+static void push_loop(benchmark::State& state, dpipe::Next<Payload>& arm) {
+    auto frame = PayloadFrame::make(uint64_t{42});
+    for (auto _ : state) {
+        arm.push(PayloadFrame{frame});
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Source to sink, one frame per iteration, including the creation of the frame.
+template <typename SourceImpl>
+static void BM_SourceToSink(benchmark::State& state) {
+    dpipe::Source<SourceImpl> source{dpipe::make_arm<Payload>(DiscardSink{})};
+    for (auto _ : state) {
+        source.push();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_SourceToSink, CounterSource);
+BENCHMARK_TEMPLATE(BM_SourceToSink, PooledCounterSource);
+
+template <std::size_t... Is>
+static auto make_dynamic_filters(std::index_sequence<Is...>) {
+    return dpipe::make_arm<Payload>(DiscardSink{}, ((void)Is, PassFilter{})...);
+}
+
+template <std::size_t... Is>
+static auto make_static_filters(std::index_sequence<Is...>) {
+    return dpipe::make_static_arm<Payload>(DiscardSink{}, ((void)Is, PassFilter{})...);
+}
+
+template <std::size_t Filters>
+static void BM_DynamicFilters(benchmark::State& state) {
+    auto arm = make_dynamic_filters(std::make_index_sequence<Filters>{});
+    push_loop(state, *arm);
+}
+BENCHMARK_TEMPLATE(BM_DynamicFilters, 1);
+BENCHMARK_TEMPLATE(BM_DynamicFilters, 2);
+BENCHMARK_TEMPLATE(BM_DynamicFilters, 4);
+BENCHMARK_TEMPLATE(BM_DynamicFilters, 8);
+BENCHMARK_TEMPLATE(BM_DynamicFilters, 16);
+
+template <std::size_t Filters>
+static void BM_StaticFilters(benchmark::State& state) {
+    auto arm = make_static_filters(std::make_index_sequence<Filters>{});
+    push_loop(state, *arm);
+}
+BENCHMARK_TEMPLATE(BM_StaticFilters, 1);
+BENCHMARK_TEMPLATE(BM_StaticFilters, 2);
+BENCHMARK_TEMPLATE(BM_StaticFilters, 4);
+BENCHMARK_TEMPLATE(BM_StaticFilters, 8);
+BENCHMARK_TEMPLATE(BM_StaticFilters, 16);
+
+// A frame crossing a decoupler, from the benchmark thread to the consumer thread.
+// The producer writes the payload and the consumer reads it. Pooled frames keep allocation out of
+// the measure. Backpressure bounds the frames still queued when the loop ends to the capacity.
+template <std::size_t Bytes>
+static void BM_DecouplerHop(benchmark::State& state) {
+    std::atomic<uint64_t> received{0};
+    dpipe::FramePool<Blob<Bytes>> pool;
+    auto arm = dpipe::make_arm<Blob<Bytes>>(TouchSink<Bytes>{received},
+                                            dpipe::DecouplerPlaceholder{});
+    uint8_t value = 0;
+    for (auto _ : state) {
+        auto frame = dpipe::MutFrame<Blob<Bytes>>::make(pool);
+        frame->data.fill(value++);
+        arm->push(std::move(frame));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(Bytes));
+    while (received.load(std::memory_order_acquire) < static_cast<uint64_t>(state.iterations())) {
+        std::this_thread::yield();
+    }
+}
+BENCHMARK_TEMPLATE(BM_DecouplerHop, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_DecouplerHop, 4096)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_DecouplerHop, 65536)->UseRealTime();
+
+template <std::size_t... Is>
+static auto make_fan_out(std::index_sequence<Is...>) {
+    return dpipe::make_splitter(dpipe::make_arm<Payload>(((void)Is, DiscardSink{}))...);
+}
+
+// Copying a frame into every arm only bumps its reference count.
+template <std::size_t Arms>
+static void BM_SplitterFanOut(benchmark::State& state) {
+    auto splitter = make_fan_out(std::make_index_sequence<Arms>{});
+    push_loop(state, *splitter);
+}
+BENCHMARK_TEMPLATE(BM_SplitterFanOut, 2);
+BENCHMARK_TEMPLATE(BM_SplitterFanOut, 4);
+BENCHMARK_TEMPLATE(BM_SplitterFanOut, 8);
+
+struct CountingSink {
+    using InputPayload = Payload;
+    void consume(PayloadFrame&& /* frame */) {
+        received.fetch_add(1, std::memory_order_release);
+    }
+    std::atomic<uint64_t>& received;
+};
+
+template <std::size_t... Is>
+static auto make_decoupled_fan_out(std::atomic<uint64_t>& received, std::index_sequence<Is...>) {
+    return dpipe::make_splitter(dpipe::make_arm<Payload>(
+            ((void)Is, CountingSink{received}), dpipe::DecouplerPlaceholder{})...);
+}
+
+template <std::size_t... Is>
+static auto make_broadcast_fan_out(std::atomic<uint64_t>& received, std::index_sequence<Is...>) {
+    return dpipe::make_broadcast_splitter(
+            {}, dpipe::make_arm<Payload>(((void)Is, CountingSink{received}))...);
+}
+
+// Fan-out to decoupled arms, waiting for every arm to get every frame.
+template <std::size_t Arms, typename Make>
+static void fan_out_loop(benchmark::State& state, Make make) {
+    std::atomic<uint64_t> received{0};
+    auto splitter = make(received, std::make_index_sequence<Arms>{});
+    auto frame = PayloadFrame::make(uint64_t{42});
+    for (auto _ : state) {
+        splitter->push(PayloadFrame{frame});
+    }
+    state.SetItemsProcessed(state.iterations());
+    const auto expected = static_cast<uint64_t>(state.iterations()) * Arms;
+    while (received.load(std::memory_order_acquire) < expected) {
+        std::this_thread::yield();
+    }
+}
+
+// One decoupler, hence one queue, per arm.
+template <std::size_t Arms>
+static void BM_DecoupledFanOut(benchmark::State& state) {
+    fan_out_loop<Arms>(state, [](auto& received, auto arms) {
+        return make_decoupled_fan_out(received, arms);
+    });
+}
+BENCHMARK_TEMPLATE(BM_DecoupledFanOut, 2)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_DecoupledFanOut, 6)->UseRealTime();
+
+// A single ring shared by all arms.
+template <std::size_t Arms>
+static void BM_BroadcastFanOut(benchmark::State& state) {
+    fan_out_loop<Arms>(state, [](auto& received, auto arms) {
+        return make_broadcast_fan_out(received, arms);
+    });
+}
+BENCHMARK_TEMPLATE(BM_BroadcastFanOut, 2)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_BroadcastFanOut, 6)->UseRealTime();
+
+// Several producer threads, each feeding its own input of a merger with a single consumer thread.
+template <std::size_t Inputs>
+static void BM_MergerFanIn(benchmark::State& state) {
+    static constexpr uint64_t FRAMES_PER_INPUT = 1 << 14;
+    for (auto _ : state) {
+        std::atomic<uint64_t> received{0};
+        auto merger = dpipe::make_merger(Inputs, {},
+                                         dpipe::make_arm<Payload>(CountingSink{received}));
+        std::array<std::jthread, Inputs> producers;
+        for (std::size_t i = 0; i < Inputs; ++i) {
+            producers[i] = std::jthread{[input = merger.input(i)] {
+                auto frame = PayloadFrame::make(uint64_t{42});
+                for (uint64_t n = 0; n < FRAMES_PER_INPUT; ++n) {
+                    input->push(PayloadFrame{frame});
+                }
+            }};
+        }
+        while (received.load(std::memory_order_acquire) < Inputs * FRAMES_PER_INPUT) {
+            std::this_thread::yield();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(Inputs * FRAMES_PER_INPUT));
+}
+BENCHMARK_TEMPLATE(BM_MergerFanIn, 2)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_MergerFanIn, 4)->UseRealTime();
+
+struct Sample {
+    uint16_t raw{};
+    static constexpr auto COLUMNS = std::tuple{&Sample::raw};
+};
+
+struct Calibrated {
+    float value{};
+    static constexpr auto COLUMNS = std::tuple{&Calibrated::value};
+};
+
+static constexpr float CALIBRATION_SCALE = 100.0F / 65535.0F;
+
+struct CalibrateFilter {
+    using InputPayload = Sample;
+    using OutputPayload = Calibrated;
+    std::optional<dpipe::Frame<Calibrated>> process(dpipe::Frame<Sample>&& frame) {
+        auto output = dpipe::MutFrame<Calibrated>::make(pool);
+        output->value = static_cast<float>(frame->raw) * CALIBRATION_SCALE;
+        return output;
+    }
+    dpipe::FramePool<Calibrated> pool;
+};
+
+struct BatchCalibrateFilter {
+    using InputPayload = dpipe::FrameBatch<Sample>;
+    using OutputPayload = dpipe::FrameBatch<Calibrated>;
+    void process(const InputPayload& input, OutputPayload& output) {
+        const auto raws = input.column<&Sample::raw>();
+        auto values = output.column<&Calibrated::value>();
+        for (std::size_t i = 0; i < raws.size(); ++i) {
+            values[i] = static_cast<float>(raws[i]) * CALIBRATION_SCALE;
+        }
+    }
+};
+
+template <typename Payload>
+struct DiscardAnySink {
+    using InputPayload = Payload;
+    void consume(dpipe::Frame<Payload>&& frame) {
+        benchmark::DoNotOptimize(frame);
+    }
+};
+
+// Pushes frames with varying samples, one per iteration.
+static void sample_loop(benchmark::State& state, dpipe::Next<Sample>& arm) {
+    auto frame = dpipe::Frame<Sample>::make();
+    uint16_t raw = 0;
+    for (auto _ : state) {
+        auto sample = dpipe::MutFrame<Sample>::from(std::move(frame));
+        sample->raw = raw++;
+        frame = std::move(sample);
+        arm.push(dpipe::Frame<Sample>{frame});
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// A scale per sample, one frame at a time.
+static void BM_CalibrationPerFrame(benchmark::State& state) {
+    auto arm = dpipe::make_static_arm<Sample>(DiscardAnySink<Calibrated>{}, CalibrateFilter{});
+    sample_loop(state, *arm);
+}
+BENCHMARK(BM_CalibrationPerFrame);
+
+// The same scale, over the columns of batches of the given size.
+template <std::size_t Size>
+static void BM_CalibrationBatched(benchmark::State& state) {
+    auto arm = dpipe::make_static_arm<Sample>(DiscardAnySink<dpipe::FrameBatch<Calibrated>>{},
+                                              BatchCalibrateFilter{},
+                                              dpipe::Batcher<Sample>{Size});
+    sample_loop(state, *arm);
+}
+BENCHMARK_TEMPLATE(BM_CalibrationBatched, 64);
+BENCHMARK_TEMPLATE(BM_CalibrationBatched, 256);
+
+// Batched, then scattered back into a frame per sample.
+template <std::size_t Size>
+static void BM_CalibrationBatchedRoundTrip(benchmark::State& state) {
+    auto arm = dpipe::make_static_arm<Sample>(
+            DiscardAnySink<Calibrated>{},
+            dpipe::Unbatcher<Calibrated>{dpipe::FramePool<Calibrated>{}}, BatchCalibrateFilter{},
+            dpipe::Batcher<Sample>{Size});
+    sample_loop(state, *arm);
+}
+BENCHMARK_TEMPLATE(BM_CalibrationBatchedRoundTrip, 64);
+
+template <std::size_t Bytes>
+static void BM_FrameMake(benchmark::State& state) {
+    for (auto _ : state) {
+        auto frame = dpipe::Frame<Blob<Bytes>>::make();
+        benchmark::DoNotOptimize(frame);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_FrameMake, 8);
+BENCHMARK_TEMPLATE(BM_FrameMake, 4096);
+
+template <std::size_t Bytes>
+static void BM_FrameMakePooled(benchmark::State& state) {
+    dpipe::FramePool<Blob<Bytes>> pool;
+    for (auto _ : state) {
+        auto frame = dpipe::Frame<Blob<Bytes>>::make(pool);
+        benchmark::DoNotOptimize(frame);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_FrameMakePooled, 8);
+BENCHMARK_TEMPLATE(BM_FrameMakePooled, 4096);
+
+// The frame is the only reference to its data object, so it is modified in place.
+template <std::size_t Bytes>
+static void BM_MutFrameFromUnique(benchmark::State& state) {
+    auto frame = dpipe::Frame<Blob<Bytes>>::make();
+    for (auto _ : state) {
+        auto mut_frame = dpipe::MutFrame<Blob<Bytes>>::from(std::move(frame));
+        mut_frame->data[0] += 1;
+        frame = std::move(mut_frame);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_MutFrameFromUnique, 8);
+BENCHMARK_TEMPLATE(BM_MutFrameFromUnique, 4096);
+
+// The frame is shared, as after a splitter, so its data object is cloned.
+template <std::size_t Bytes>
+static void BM_MutFrameFromShared(benchmark::State& state) {
+    const auto frame = dpipe::Frame<Blob<Bytes>>::make();
+    for (auto _ : state) {
+        auto mut_frame = dpipe::MutFrame<Blob<Bytes>>::from(dpipe::Frame<Blob<Bytes>>{frame});
+        mut_frame->data[0] += 1;
+        benchmark::DoNotOptimize(mut_frame);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_MutFrameFromShared, 8);
+BENCHMARK_TEMPLATE(BM_MutFrameFromShared, 4096);
+
+// An image made of planes, one of which is forwarded by a filter.
+template <std::size_t Bytes>
+struct Planes {
+    Blob<Bytes> luma;
+    Blob<Bytes / 2> chroma;
+};
+
+// The plane is forwarded as a view sharing the image, without copying it.
+template <std::size_t Bytes>
+static void BM_PlaneView(benchmark::State& state) {
+    const auto image = dpipe::Frame<Planes<Bytes>>::make();
+    for (auto _ : state) {
+        auto plane = dpipe::Frame<Blob<Bytes>>::view_of(image, image->luma);
+        benchmark::DoNotOptimize(plane);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_PlaneView, 4096);
+BENCHMARK_TEMPLATE(BM_PlaneView, 65536);
+
+// The plane is copied into a new frame.
+template <std::size_t Bytes>
+static void BM_PlaneCopy(benchmark::State& state) {
+    const auto image = dpipe::Frame<Planes<Bytes>>::make();
+    dpipe::FramePool<Blob<Bytes>> pool;
+    for (auto _ : state) {
+        auto plane = dpipe::Frame<Blob<Bytes>>::make(pool, image->luma);
+        benchmark::DoNotOptimize(plane);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_PlaneCopy, 4096);
+BENCHMARK_TEMPLATE(BM_PlaneCopy, 65536);
+
+#if !defined(_WIN32)
+
+// Writes a file of records to replay, about 16 MiB, and returns its path.
+template <std::size_t Bytes>
+static std::string make_replay_file() {
+    const auto path = (std::filesystem::temp_directory_path() / "dpipe-bench-replay").string();
+    dpipe::MmapFileSink<Blob<Bytes>> sink{path};
+    auto frame = dpipe::Frame<Blob<Bytes>>::make();
+    for (std::size_t i = 0; i < (std::size_t{16} << 20) / Bytes; ++i) {
+        sink.consume(dpipe::Frame<Blob<Bytes>>{frame});
+    }
+    sink.finish();
+    return path;
+}
+
+// Reads records with `read`, copying each into a newly allocated frame.
+template <std::size_t Bytes>
+struct ReadFileSource {
+    using OutputPayload = Blob<Bytes>;
+    explicit ReadFileSource(const std::string& path)
+            : fd{::open(path.c_str(), O_RDONLY)} {}
+    ~ReadFileSource() {
+        ::close(fd);
+    }
+    ReadFileSource(const ReadFileSource& other) = delete;
+    ReadFileSource& operator=(const ReadFileSource& other) = delete;
+    std::optional<dpipe::Frame<OutputPayload>> produce() {
+        auto record = dpipe::MutFrame<OutputPayload>::make();
+        if (::read(fd, record->data.data(), Bytes) != static_cast<ssize_t>(Bytes)) {
+            done = true;
+            return {};
+        }
+        return record;
+    }
+    bool end_of_stream() const {
+        return done;
+    }
+    int fd;
+    bool done{false};
+};
+
+template <typename SourceImpl, std::size_t Bytes>
+static void replay_loop(benchmark::State& state) {
+    const auto path = make_replay_file<Bytes>();
+    std::atomic<uint64_t> received{0};
+    for (auto _ : state) {
+        dpipe::Source<SourceImpl> source{dpipe::make_arm<Blob<Bytes>>(TouchSink<Bytes>{received}),
+                                         path};
+        while (source.push() != dpipe::SourceStatus::EndOfStream) {
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(received.load()));
+    state.SetBytesProcessed(static_cast<int64_t>(received.load() * Bytes));
+    std::filesystem::remove(path);
+}
+
+// Replays a file whose records are mapped into memory, without copying them.
+template <std::size_t Bytes>
+static void BM_MmapFileReplay(benchmark::State& state) {
+    replay_loop<dpipe::MmapFileSource<Blob<Bytes>>, Bytes>(state);
+}
+BENCHMARK_TEMPLATE(BM_MmapFileReplay, 64);
+BENCHMARK_TEMPLATE(BM_MmapFileReplay, 4096);
+
+// Replays the same file with one `read` and one copy per record.
+template <std::size_t Bytes>
+static void BM_ReadFileReplay(benchmark::State& state) {
+    replay_loop<ReadFileSource<Bytes>, Bytes>(state);
+}
+BENCHMARK_TEMPLATE(BM_ReadFileReplay, 64);
+BENCHMARK_TEMPLATE(BM_ReadFileReplay, 4096);
+
+// A frame crossing a shared-memory ring, as it would cross two processes, from the benchmark thread
+// to the consumer thread. It is copied into the ring once, and read in place by the consumer.
+template <std::size_t Bytes>
+static void BM_ShmHop(benchmark::State& state) {
+    const auto name = "/dpipe-bench-hop-" + std::to_string(::getpid());
+    std::atomic<uint64_t> received{0};
+    dpipe::ShmSink<Blob<Bytes>> sink{name};
+    auto consumer =
+            dpipe::make_pipe(TouchSink<Bytes>{received}, dpipe::ShmSource<Blob<Bytes>>{name});
+    consumer.start();
+    dpipe::FramePool<Blob<Bytes>> pool;
+    uint8_t value = 0;
+    for (auto _ : state) {
+        auto frame = dpipe::MutFrame<Blob<Bytes>>::make(pool);
+        frame->data.fill(value++);
+        sink.consume(std::move(frame));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(Bytes));
+    sink.finish();
+    consumer.wait();
+}
+BENCHMARK_TEMPLATE(BM_ShmHop, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ShmHop, 4096)->UseRealTime();
+
+#endif
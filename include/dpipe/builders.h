@@ -1,6 +1,9 @@
 #ifndef DPIPE_BUILDERS_H_
 #define DPIPE_BUILDERS_H_
 
+#include <cstddef>
+#include <type_traits>
+
 #include <dpipe/elements.h>
 
 namespace dpipe {
@@ -9,19 +12,108 @@ namespace dpipe {
  * @brief An helper object to be used in `make_arm` or in `make_pipe` builder
  *        functions to put a decoupler between user-defined elements.
  */
-struct DecouplerPlaceholder {};
+struct DecouplerPlaceholder {
+    /// @brief Configuration of the decoupler to be created.
+    DecouplerOptions options{};
+};
+
+/**
+ * @brief An helper object to be used in `make_arm` or in `make_pipe` builder
+ *        functions to put a ParallelFilter between user-defined elements.
+ *
+ * @tparam Factory A callable taking no arguments and returning a user-defined filter
+ *                 implementation. It is called once per worker thread.
+ */
+template <typename Factory>
+struct ParallelPlaceholder {
+    /// @brief Creates the filter implementation of every worker thread.
+    Factory factory;
+    /// @brief Configuration of the parallel filter to be created.
+    ParallelOptions options{};
+};
+
+#if !defined(_WIN32)
+/**
+ * @brief An helper object to be used in `make_arm` or in `make_pipe` builder
+ *        functions to put an AsyncFilter between user-defined elements or, in last position of
+ *        `make_pipe`, an AsyncSource.
+ *
+ * @tparam Impl User-defined filter or source implementation, whose `process` or `produce`
+ *              function is a coroutine.
+ */
+template <typename Impl>
+struct AsyncPlaceholder {
+    /// @brief The user-defined implementation.
+    Impl impl;
+    /// @brief Configuration of the element to be created, including its event loop.
+    AsyncOptions options{};
+};
+#endif
 
 namespace impl {
 
+// Filter and asynchronous overloads are declared upfront, so that they can follow a decoupler
+// placeholder.
+
+template <typename T, typename NextType, typename FilterImpl, typename... Args>
+std::unique_ptr<dpipe::Next<T>> make_arm_inner(NextType&& next, FilterImpl&& filterImpl,
+                                               Args&&... args);
+
+template <typename NextType, typename FilterImpl, typename... Args>
+dpipe::Pipeline make_pipe_inner(NextType&& next, FilterImpl&& filterImpl, Args&&... args);
+
+template <typename T, typename Chain, typename FilterImpl, typename... Args>
+std::unique_ptr<dpipe::Next<T>> make_static_arm_inner(Chain&& chain, FilterImpl&& filterImpl,
+                                                      Args&&... args);
+
+template <typename Chain, typename FilterImpl, typename... Args>
+dpipe::Pipeline make_static_pipe_inner(Chain&& chain, FilterImpl&& filterImpl, Args&&... args);
+
+#if !defined(_WIN32)
+template <typename T, typename NextType, typename Impl, typename... Args>
+std::unique_ptr<dpipe::Next<T>> make_arm_inner(NextType&& next,
+                                               AsyncPlaceholder<Impl>&& placeholder,
+                                               Args&&... args);
+
+template <typename NextType, typename Impl>
+dpipe::Pipeline make_pipe_inner(NextType&& next, AsyncPlaceholder<Impl>&& placeholder);
+
+template <typename NextType, typename Impl, typename... Args>
+dpipe::Pipeline make_pipe_inner(NextType&& next, AsyncPlaceholder<Impl>&& placeholder,
+                                Args&&... args);
+
+template <typename T, typename Chain, typename Impl, typename... Args>
+std::unique_ptr<dpipe::Next<T>> make_static_arm_inner(Chain&& chain,
+                                                      AsyncPlaceholder<Impl>&& placeholder,
+                                                      Args&&... args);
+
+template <typename Chain, typename Impl>
+dpipe::Pipeline make_static_pipe_inner(Chain&& chain, AsyncPlaceholder<Impl>&& placeholder);
+
+template <typename Chain, typename Impl, typename... Args>
+dpipe::Pipeline make_static_pipe_inner(Chain&& chain, AsyncPlaceholder<Impl>&& placeholder,
+                                       Args&&... args);
+#endif
+
 template <typename T, typename NextType>
 std::unique_ptr<dpipe::Next<T>> make_arm_inner(NextType&& next) {
     return std::move(next);
 }
 
 template <typename T, typename NextType, typename... Args>
-std::unique_ptr<dpipe::Next<T>> make_arm_inner(NextType&& next, DecouplerPlaceholder&&,
+std::unique_ptr<dpipe::Next<T>> make_arm_inner(NextType&& next, DecouplerPlaceholder&& placeholder,
                                                Args&&... args) {
-    auto filter = std::make_unique<dpipe::Decoupler<T>>(std::move(next));
+    auto filter = std::make_unique<dpipe::Decoupler<T>>(std::move(next), placeholder.options);
+    return impl::make_arm_inner<T>(std::move(filter), std::forward<Args>(args)...);
+}
+
+template <typename T, typename NextType, typename Factory, typename... Args>
+std::unique_ptr<dpipe::Next<T>> make_arm_inner(NextType&& next,
+                                               ParallelPlaceholder<Factory>&& placeholder,
+                                               Args&&... args) {
+    using FilterImpl = std::invoke_result_t<Factory&>;
+    auto filter = std::make_unique<dpipe::ParallelFilter<FilterImpl>>(
+            std::move(next), placeholder.factory, placeholder.options);
     return impl::make_arm_inner<T>(std::move(filter), std::forward<Args>(args)...);
 }
 
@@ -41,9 +133,19 @@ dpipe::Pipeline make_pipe_inner(NextType&& next, SourceImpl&& sourceImpl) {
 }
 
 template <typename NextType, typename... Args>
-dpipe::Pipeline make_pipe_inner(NextType&& next, DecouplerPlaceholder&&, Args&&... args) {
+dpipe::Pipeline make_pipe_inner(NextType&& next, DecouplerPlaceholder&& placeholder,
+                                Args&&... args) {
     using T = typename NextType::element_type::Payload;
-    auto filter = std::make_unique<dpipe::Decoupler<T>>(std::move(next));
+    auto filter = std::make_unique<dpipe::Decoupler<T>>(std::move(next), placeholder.options);
+    return impl::make_pipe_inner(std::move(filter), std::forward<Args>(args)...);
+}
+
+template <typename NextType, typename Factory, typename... Args>
+dpipe::Pipeline make_pipe_inner(NextType&& next, ParallelPlaceholder<Factory>&& placeholder,
+                                Args&&... args) {
+    using FilterImpl = std::invoke_result_t<Factory&>;
+    auto filter = std::make_unique<dpipe::ParallelFilter<FilterImpl>>(
+            std::move(next), placeholder.factory, placeholder.options);
     return impl::make_pipe_inner(std::move(filter), std::forward<Args>(args)...);
 }
 
@@ -54,6 +156,136 @@ dpipe::Pipeline make_pipe_inner(NextType&& next, FilterImpl&& filterImpl, Args&&
     return impl::make_pipe_inner(std::move(filter), std::forward<Args>(args)...);
 }
 
+template <typename T, typename Chain>
+std::unique_ptr<dpipe::Next<T>> make_static_arm_inner(Chain&& chain) {
+    return std::make_unique<dpipe::StaticArm<Chain>>(std::move(chain));
+}
+
+template <typename T, typename Chain, typename... Args>
+std::unique_ptr<dpipe::Next<T>> make_static_arm_inner(Chain&& chain,
+                                                      DecouplerPlaceholder&& placeholder,
+                                                      Args&&... args) {
+    using U = typename Chain::Payload;
+    auto arm = std::make_unique<dpipe::StaticArm<Chain>>(std::move(chain));
+    auto decoupler = std::make_unique<dpipe::Decoupler<U>>(std::move(arm), placeholder.options);
+    return impl::make_static_arm_inner<T>(impl::DynamicLink<U>{std::move(decoupler)},
+                                          std::forward<Args>(args)...);
+}
+
+template <typename T, typename Chain, typename Factory, typename... Args>
+std::unique_ptr<dpipe::Next<T>> make_static_arm_inner(Chain&& chain,
+                                                      ParallelPlaceholder<Factory>&& placeholder,
+                                                      Args&&... args) {
+    using FilterImpl = std::invoke_result_t<Factory&>;
+    auto arm = std::make_unique<dpipe::StaticArm<Chain>>(std::move(chain));
+    auto filter = std::make_unique<dpipe::ParallelFilter<FilterImpl>>(
+            std::move(arm), placeholder.factory, placeholder.options);
+    using V = typename FilterImpl::InputPayload;
+    return impl::make_static_arm_inner<T>(impl::DynamicLink<V>{std::move(filter)},
+                                          std::forward<Args>(args)...);
+}
+
+template <typename T, typename Chain, typename FilterImpl, typename... Args>
+std::unique_ptr<dpipe::Next<T>> make_static_arm_inner(Chain&& chain, FilterImpl&& filterImpl,
+                                                      Args&&... args) {
+    using Linked = impl::StaticFilter<FilterImpl, Chain>;
+    return impl::make_static_arm_inner<T>(Linked{std::move(filterImpl), std::move(chain)},
+                                          std::forward<Args>(args)...);
+}
+
+template <typename Chain, typename SourceImpl>
+dpipe::Pipeline make_static_pipe_inner(Chain&& chain, SourceImpl&& sourceImpl) {
+    auto source = std::make_unique<dpipe::StaticSource<SourceImpl, Chain>>(std::move(chain),
+                                                                          std::move(sourceImpl));
+    return dpipe::Pipeline{std::move(source)};
+}
+
+template <typename Chain, typename... Args>
+dpipe::Pipeline make_static_pipe_inner(Chain&& chain, DecouplerPlaceholder&& placeholder,
+                                       Args&&... args) {
+    using T = typename Chain::Payload;
+    auto arm = std::make_unique<dpipe::StaticArm<Chain>>(std::move(chain));
+    auto decoupler = std::make_unique<dpipe::Decoupler<T>>(std::move(arm), placeholder.options);
+    return impl::make_static_pipe_inner(impl::DynamicLink<T>{std::move(decoupler)},
+                                        std::forward<Args>(args)...);
+}
+
+template <typename Chain, typename Factory, typename... Args>
+dpipe::Pipeline make_static_pipe_inner(Chain&& chain, ParallelPlaceholder<Factory>&& placeholder,
+                                       Args&&... args) {
+    using FilterImpl = std::invoke_result_t<Factory&>;
+    using T = typename FilterImpl::InputPayload;
+    auto arm = std::make_unique<dpipe::StaticArm<Chain>>(std::move(chain));
+    auto filter = std::make_unique<dpipe::ParallelFilter<FilterImpl>>(
+            std::move(arm), placeholder.factory, placeholder.options);
+    return impl::make_static_pipe_inner(impl::DynamicLink<T>{std::move(filter)},
+                                        std::forward<Args>(args)...);
+}
+
+template <typename Chain, typename FilterImpl, typename... Args>
+dpipe::Pipeline make_static_pipe_inner(Chain&& chain, FilterImpl&& filterImpl, Args&&... args) {
+    using Linked = impl::StaticFilter<FilterImpl, Chain>;
+    return impl::make_static_pipe_inner(Linked{std::move(filterImpl), std::move(chain)},
+                                        std::forward<Args>(args)...);
+}
+
+#if !defined(_WIN32)
+template <typename T, typename NextType, typename Impl, typename... Args>
+std::unique_ptr<dpipe::Next<T>> make_arm_inner(NextType&& next,
+                                               AsyncPlaceholder<Impl>&& placeholder,
+                                               Args&&... args) {
+    auto filter = std::make_unique<dpipe::AsyncFilter<Impl>>(
+            std::move(next), placeholder.options, std::move(placeholder.impl));
+    return impl::make_arm_inner<T>(std::move(filter), std::forward<Args>(args)...);
+}
+
+template <typename NextType, typename Impl>
+dpipe::Pipeline make_pipe_inner(NextType&& next, AsyncPlaceholder<Impl>&& placeholder) {
+    auto source = std::make_unique<dpipe::AsyncSource<Impl>>(
+            std::move(next), placeholder.options, std::move(placeholder.impl));
+    return dpipe::Pipeline{std::move(source)};
+}
+
+template <typename NextType, typename Impl, typename... Args>
+dpipe::Pipeline make_pipe_inner(NextType&& next, AsyncPlaceholder<Impl>&& placeholder,
+                                Args&&... args) {
+    auto filter = std::make_unique<dpipe::AsyncFilter<Impl>>(
+            std::move(next), placeholder.options, std::move(placeholder.impl));
+    return impl::make_pipe_inner(std::move(filter), std::forward<Args>(args)...);
+}
+
+template <typename T, typename Chain, typename Impl, typename... Args>
+std::unique_ptr<dpipe::Next<T>> make_static_arm_inner(Chain&& chain,
+                                                      AsyncPlaceholder<Impl>&& placeholder,
+                                                      Args&&... args) {
+    using U = typename Impl::InputPayload;
+    auto arm = std::make_unique<dpipe::StaticArm<Chain>>(std::move(chain));
+    auto filter = std::make_unique<dpipe::AsyncFilter<Impl>>(std::move(arm), placeholder.options,
+                                                             std::move(placeholder.impl));
+    return impl::make_static_arm_inner<T>(impl::DynamicLink<U>{std::move(filter)},
+                                          std::forward<Args>(args)...);
+}
+
+template <typename Chain, typename Impl>
+dpipe::Pipeline make_static_pipe_inner(Chain&& chain, AsyncPlaceholder<Impl>&& placeholder) {
+    auto arm = std::make_unique<dpipe::StaticArm<Chain>>(std::move(chain));
+    auto source = std::make_unique<dpipe::AsyncSource<Impl>>(std::move(arm), placeholder.options,
+                                                             std::move(placeholder.impl));
+    return dpipe::Pipeline{std::move(source)};
+}
+
+template <typename Chain, typename Impl, typename... Args>
+dpipe::Pipeline make_static_pipe_inner(Chain&& chain, AsyncPlaceholder<Impl>&& placeholder,
+                                       Args&&... args) {
+    using T = typename Impl::InputPayload;
+    auto arm = std::make_unique<dpipe::StaticArm<Chain>>(std::move(chain));
+    auto filter = std::make_unique<dpipe::AsyncFilter<Impl>>(std::move(arm), placeholder.options,
+                                                             std::move(placeholder.impl));
+    return impl::make_static_pipe_inner(impl::DynamicLink<T>{std::move(filter)},
+                                        std::forward<Args>(args)...);
+}
+#endif
+
 } // namespace impl
 
 /**
@@ -63,8 +295,9 @@ dpipe::Pipeline make_pipe_inner(NextType&& next, FilterImpl&& filterImpl, Args&&
  *
  * @tparam T        The input data type of the resulting arm.
  * @tparam SinkImpl User-defined sink implementation.
- * @tparam Args     Zero or more user-defined filter implementations or
- *                  `dpipe::DecouplerPlaceholder` objects.
+ * @tparam Args     Zero or more user-defined filter implementations,
+ *                  `dpipe::DecouplerPlaceholder`, `dpipe::ParallelPlaceholder` or
+ *                  `dpipe::AsyncPlaceholder` objects.
  */
 template <typename T, typename SinkImpl, typename... Args>
 std::unique_ptr<dpipe::Next<T>> make_arm(SinkImpl&& sinkImpl, Args&&... args) {
@@ -88,13 +321,45 @@ std::unique_ptr<dpipe::Splitter<T>> make_splitter(std::unique_ptr<dpipe::Next<T>
                                                 std::forward<Args>(args)...);
 }
 
+/**
+ * @brief Creates a broadcast splitter, _i.e._, a splitter whose arms are decoupled through a single
+ *        ring buffer shared by all of them.
+ *        By definition, a splitter is linked to two or more arms.
+ *
+ * @tparam T    The data type handled by the splitter.
+ * @tparam Args Additional linked arms.
+ */
+template <typename T, typename... Args>
+std::unique_ptr<dpipe::BroadcastSplitter<T>>
+make_broadcast_splitter(const BroadcastOptions& options, std::unique_ptr<dpipe::Next<T>>&& next1,
+                        std::unique_ptr<dpipe::Next<T>>&& next2, Args&&... args) {
+    return std::make_unique<dpipe::BroadcastSplitter<T>>(options, std::move(next1),
+                                                         std::move(next2),
+                                                         std::forward<Args>(args)...);
+}
+
+/**
+ * @brief Creates a merger, _i.e._, a node that receives in input the frames of multiple
+ *        pipelines and forwards them into a single arm.
+ *        Pipelines are linked to the merger by ending them with one of its inputs.
+ *
+ * @tparam T The data type handled by the merger.
+ */
+template <typename T>
+dpipe::Merger<T> make_merger(std::size_t inputs, const MergerOptions& options,
+                             std::unique_ptr<dpipe::Next<T>>&& next,
+                             typename dpipe::Merger<T>::TimestampOf timestamp_of = {}) {
+    return dpipe::Merger<T>{inputs, std::move(next), options, std::move(timestamp_of)};
+}
+
 /**
  * @brief Creates a pipeline that ends with a splitter and starts with a source.
  *        The elements must be passed in reverse orders (the splitter goes first).
  *
  * @tparam T        The data type handled by the splitter.
- * @tparam Args     Zero or more user-defined element implementations or
- *                  `dpipe::DecouplerPlaceholder` objects.
+ * @tparam Args     Zero or more user-defined element implementations,
+ *                  `dpipe::DecouplerPlaceholder`, `dpipe::ParallelPlaceholder` or
+ *                  `dpipe::AsyncPlaceholder` objects.
  *                  The last element (and only it) must be a source.
  */
 template <typename T, typename... Args>
@@ -102,13 +367,31 @@ dpipe::Pipeline make_pipe(std::unique_ptr<dpipe::Splitter<T>>&& splitter, Args&&
     return impl::make_pipe_inner(std::move(splitter), std::forward<Args>(args)...);
 }
 
+/**
+ * @brief Same as `make_pipe` ending with a splitter, but with a broadcast splitter.
+ */
+template <typename T, typename... Args>
+dpipe::Pipeline make_pipe(std::unique_ptr<dpipe::BroadcastSplitter<T>>&& splitter,
+                          Args&&... args) {
+    return impl::make_pipe_inner(std::move(splitter), std::forward<Args>(args)...);
+}
+
+/**
+ * @brief Same as `make_pipe` ending with a splitter, but with an input of a merger.
+ */
+template <typename T, typename... Args>
+dpipe::Pipeline make_pipe(std::unique_ptr<dpipe::MergerInput<T>>&& input, Args&&... args) {
+    return impl::make_pipe_inner(std::move(input), std::forward<Args>(args)...);
+}
+
 /**
  * @brief Creates a straight pipeline that ends with a sink and starts with a source.
  *        The elements must be passed in reverse orders (the sink goes first).
  *
  * @tparam SinkImpl User-defined sink implementation.
- * @tparam Args     Zero or more user-defined element implementations or
- *                  `dpipe::DecouplerPlaceholder` objects.
+ * @tparam Args     Zero or more user-defined element implementations,
+ *                  `dpipe::DecouplerPlaceholder`, `dpipe::ParallelPlaceholder` or
+ *                  `dpipe::AsyncPlaceholder` objects.
  *                  The last element (and only it) must be a source.
  */
 template <typename SinkImpl, typename... Args>
@@ -117,6 +400,75 @@ dpipe::Pipeline make_pipe(SinkImpl&& sinkImpl, Args&&... args) {
     return impl::make_pipe_inner(std::move(sink), std::forward<Args>(args)...);
 }
 
+/**
+ * @brief Same as `make_arm`, but the elements between decouplers are composed at compile-time
+ *        into a single object, so that frames flow through them without virtual calls.
+ *
+ * @tparam T        The input data type of the resulting arm.
+ * @tparam SinkImpl User-defined sink implementation.
+ * @tparam Args     Zero or more user-defined filter implementations,
+ *                  `dpipe::DecouplerPlaceholder`, `dpipe::ParallelPlaceholder` or
+ *                  `dpipe::AsyncPlaceholder` objects.
+ */
+template <typename T, typename SinkImpl, typename... Args>
+std::unique_ptr<dpipe::Next<T>> make_static_arm(SinkImpl&& sinkImpl, Args&&... args) {
+    return impl::make_static_arm_inner<T>(impl::StaticSink<SinkImpl>{std::move(sinkImpl)},
+                                          std::forward<Args>(args)...);
+}
+
+/**
+ * @brief Same as `make_pipe` ending with a splitter, but the elements between decouplers are
+ *        composed at compile-time into a single object, so that frames flow through them without
+ *        virtual calls.
+ *
+ * @tparam T    The data type handled by the splitter.
+ * @tparam Args Zero or more user-defined element implementations,
+ *              `dpipe::DecouplerPlaceholder`, `dpipe::ParallelPlaceholder` or
+ *              `dpipe::AsyncPlaceholder` objects.
+ *              The last element (and only it) must be a source.
+ */
+template <typename T, typename... Args>
+dpipe::Pipeline make_static_pipe(std::unique_ptr<dpipe::Splitter<T>>&& splitter, Args&&... args) {
+    return impl::make_static_pipe_inner(impl::DynamicLink<T>{std::move(splitter)},
+                                        std::forward<Args>(args)...);
+}
+
+/**
+ * @brief Same as `make_static_pipe` ending with a splitter, but with a broadcast splitter.
+ */
+template <typename T, typename... Args>
+dpipe::Pipeline make_static_pipe(std::unique_ptr<dpipe::BroadcastSplitter<T>>&& splitter,
+                                 Args&&... args) {
+    return impl::make_static_pipe_inner(impl::DynamicLink<T>{std::move(splitter)},
+                                        std::forward<Args>(args)...);
+}
+
+/**
+ * @brief Same as `make_static_pipe` ending with a splitter, but with an input of a merger.
+ */
+template <typename T, typename... Args>
+dpipe::Pipeline make_static_pipe(std::unique_ptr<dpipe::MergerInput<T>>&& input, Args&&... args) {
+    return impl::make_static_pipe_inner(impl::DynamicLink<T>{std::move(input)},
+                                        std::forward<Args>(args)...);
+}
+
+/**
+ * @brief Same as `make_pipe` ending with a sink, but the elements between decouplers are
+ *        composed at compile-time into a single object, so that frames flow through them without
+ *        virtual calls.
+ *
+ * @tparam SinkImpl User-defined sink implementation.
+ * @tparam Args     Zero or more user-defined element implementations,
+ *                  `dpipe::DecouplerPlaceholder`, `dpipe::ParallelPlaceholder` or
+ *                  `dpipe::AsyncPlaceholder` objects.
+ *                  The last element (and only it) must be a source.
+ */
+template <typename SinkImpl, typename... Args>
+dpipe::Pipeline make_static_pipe(SinkImpl&& sinkImpl, Args&&... args) {
+    return impl::make_static_pipe_inner(impl::StaticSink<SinkImpl>{std::move(sinkImpl)},
+                                        std::forward<Args>(args)...);
+}
+
 } // namespace dpipe
 
 #endif // DPIPE_BUILDERS_H_
@@ -3,8 +3,13 @@
 
 #include <dpipe/builders.h>
 #include <dpipe/elements.h>
+#include <dpipe/frame-batch.h>
+#include <dpipe/frame-header.h>
+#include <dpipe/frame-pool.h>
 #include <dpipe/frame.h>
+#include <dpipe/metrics.h>
 #include <dpipe/mut-frame.h>
+#include <dpipe/tracing.h>
 
 namespace dpipe {
 
@@ -1,12 +1,26 @@
 #ifndef DPIPE_ELEMENTS_H_
 #define DPIPE_ELEMENTS_H_
 
+#include <dpipe/elements/batching.h>
+#include <dpipe/elements/broadcast-splitter.h>
 #include <dpipe/elements/decoupler.h>
 #include <dpipe/elements/filter.h>
 #include <dpipe/elements/interfaces.h>
+#include <dpipe/elements/latency-sink.h>
+#include <dpipe/elements/merger.h>
+#include <dpipe/elements/parallel-filter.h>
 #include <dpipe/elements/pipeline.h>
+#include <dpipe/elements/shedding.h>
 #include <dpipe/elements/sink.h>
 #include <dpipe/elements/source.h>
 #include <dpipe/elements/splitter.h>
+#include <dpipe/elements/static.h>
+
+// Asynchronous elements, memory-mapped files and shared memory rely on POSIX file descriptors.
+#if !defined(_WIN32)
+#include <dpipe/elements/async.h>
+#include <dpipe/elements/mmap-file.h>
+#include <dpipe/elements/shared-memory.h>
+#endif
 
 #endif // DPIPE_ELEMENTS_H_
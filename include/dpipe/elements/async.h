@@ -0,0 +1,449 @@
+#ifndef DPIPE_ELEMENTS_ASYNC_H_
+#define DPIPE_ELEMENTS_ASYNC_H_
+
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include <dpipe/elements/interfaces.h>
+#include <dpipe/frame-header.h>
+#include <dpipe/frame.h>
+#include <dpipe/metrics.h>
+#include <dpipe/utils/coroutine.h>
+#include <dpipe/utils/event-loop.h>
+
+namespace dpipe {
+
+/**
+ * @brief Run-time configuration of an AsyncSource or of an AsyncFilter.
+ */
+struct AsyncOptions {
+    /// @brief Event loop running the coroutines of the element. It is required.
+    std::shared_ptr<EventLoop> loop{};
+    /// @brief Maximum number of frames queued in front of an asynchronous filter. Threads pushing
+    ///        frames into a full queue block, unless they are the loop thread.
+    std::size_t capacity{1024};
+};
+
+namespace impl {
+
+/**
+ * @brief Runs a function on the loop thread and waits for it to return, or runs it right away
+ *        if called by the loop thread.
+ */
+template <typename Function>
+void run_on_loop(EventLoop& loop, Function&& function) {
+    if (loop.in_loop()) {
+        function();
+        return;
+    }
+    std::promise<void> done;
+    auto future = done.get_future();
+    loop.post([&function, &done] {
+        function();
+        done.set_value();
+    });
+    future.wait();
+}
+
+} // namespace impl
+
+/**
+ * @brief A source whose frames are produced by a coroutine running on an event loop, so that
+ *        sources waiting for I/O share the loop thread instead of blocking a thread each.
+ *
+ * Once the pipeline is started, a coroutine on the loop awaits `produce` again and again, and
+ * pushes every frame into the following elements from the loop thread, as soon as it is produced.
+ *
+ * @tparam Impl_ User-defined source implementation.
+ *               It must define `OutputPayload` type, as well as a `produce` coroutine taking no
+ *               input and returning `Async<std::optional<Frame<OutputPayload>>>`, which may
+ *               `co_await` the readiness of file descriptors and timers on the event loop.
+ *               When no frame is returned, other coroutines on the loop run before `produce` is
+ *               awaited again, unless the implementation also defines an `end_of_stream` function
+ *               returning `true`, in which case the end of stream is propagated.
+ */
+template <typename Impl_>
+class AsyncSource : public Entry {
+public:
+    using Impl = Impl_;
+    using OutputPayload = typename Impl::OutputPayload;
+
+    /**
+     * @brief Constructor. Typically not used directly, but through `make_pipe` builder
+     *        functions, with a `dpipe::AsyncPlaceholder`.
+     */
+    template <typename... Args>
+    AsyncSource(std::unique_ptr<Next<OutputPayload>>&& next, const AsyncOptions& options,
+                Args&&... args)
+            : loop_{options.loop}
+            , shared_{std::make_unique<Shared>(std::move(next), *loop_,
+                                               std::forward<Args>(args)...)} {}
+
+    ~AsyncSource() override {
+        if (shared_) {
+            stop(false);
+        }
+    }
+
+    AsyncSource(const AsyncSource& other) = delete;
+    AsyncSource& operator=(const AsyncSource& other) = delete;
+
+    AsyncSource(AsyncSource&& other) = default;
+    // The coroutines of the overwritten source would have to be destroyed on its loop.
+    AsyncSource& operator=(AsyncSource&& other) = delete;
+
+    /**
+     * @brief Awaits `produce` once on the loop, blocking the calling thread until it returns.
+     */
+    SourceStatus push() override {
+        assert(shared_ && !loop_->in_loop());
+        auto& shared = *shared_;
+        std::promise<SourceStatus> status;
+        auto future = status.get_future();
+        loop_->post([&shared, &status] {
+            shared.polled = produce_once(shared, status);
+            shared.polled.start();
+        });
+        return future.get();
+    }
+
+    void finish() override {
+        assert(shared_);
+        shared_->next->finish();
+    }
+
+    bool start(std::function<void()>&& finished) override {
+        assert(shared_);
+        loop_->post([&shared = *shared_, finished = std::move(finished)]() mutable {
+            shared.finished = std::move(finished);
+            shared.driver = run(shared);
+            shared.driver.start();
+        });
+        return true;
+    }
+
+    void stop(bool drain) override {
+        assert(shared_);
+        if (loop_->in_loop()) {
+            assert(!shared_->finishing);
+            halt(*shared_, drain);
+            return;
+        }
+        std::promise<void> halted;
+        auto future = halted.get_future();
+        post_halt(*loop_, *shared_, drain, halted);
+        future.wait();
+    }
+
+    void collect(PipelineMetrics& metrics) const override {
+        assert(shared_);
+        shared_->metrics.collect(metrics, "AsyncSource");
+        shared_->next->collect(metrics);
+    }
+
+private:
+    // State of the source, only accessed by the loop thread once the data flow starts.
+    struct Shared {
+        template <typename... Args>
+        Shared(std::unique_ptr<Next<OutputPayload>>&& next, EventLoop& loop, Args&&... args)
+                : next{std::move(next)}
+                , loop{loop}
+                , impl{std::forward<Args>(args)...} {
+            assert(this->next);
+        }
+
+        // Propagates the end of stream, then signals it to the pipeline.
+        void end() {
+            finishing = true;
+            next->finish();
+            finishing = false;
+            if (finished) {
+                finished();
+            }
+        }
+
+        std::unique_ptr<Next<OutputPayload>> next;
+        EventLoop& loop;
+        Impl impl;
+        std::function<void()> finished;
+        // The coroutine producing frames until the end of stream.
+        Async<void> driver;
+        // The coroutine awaiting a single frame on behalf of `push`.
+        Async<void> polled;
+        // Set while the end of stream is being propagated, possibly running the loop meanwhile.
+        bool finishing{false};
+        [[no_unique_address]] impl::ElementMetrics<> metrics;
+        [[no_unique_address]] impl::FrameStamper<> stamper;
+    };
+
+    static Async<void> run(Shared& shared) {
+        while (true) {
+            auto output = co_await shared.impl.produce();
+            if (!output.has_value()) {
+                if (impl::end_of_stream(shared.impl)) {
+                    break;
+                }
+                // Let other coroutines run before asking again.
+                co_await shared.loop.yield();
+                continue;
+            }
+            shared.stamper.stamp(*output);
+            shared.metrics.frames_out();
+            shared.next->push(std::move(*output));
+        }
+        shared.end();
+    }
+
+    static Async<void> produce_once(Shared& shared, std::promise<SourceStatus>& status) {
+        auto output = co_await shared.impl.produce();
+        if (!output.has_value()) {
+            status.set_value(impl::end_of_stream(shared.impl) ? SourceStatus::EndOfStream
+                                                              : SourceStatus::Idle);
+            co_return;
+        }
+        shared.stamper.stamp(*output);
+        shared.metrics.frames_out();
+        shared.next->push(std::move(*output));
+        status.set_value(SourceStatus::Produced);
+    }
+
+    // Destroys the coroutines, cancelling any wait on the loop. To be called by the loop thread.
+    static void halt(Shared& shared, bool drain) {
+        const bool running = shared.driver.valid() && !shared.driver.done();
+        shared.driver = {};
+        shared.polled = {};
+        if (running && drain) {
+            shared.end();
+        }
+    }
+
+    static void post_halt(EventLoop& loop, Shared& shared, bool drain,
+                          std::promise<void>& halted) {
+        loop.post([&loop, &shared, drain, &halted] {
+            if (shared.finishing) {
+                // The coroutine cannot be destroyed while it propagates the end of stream.
+                post_halt(loop, shared, drain, halted);
+                return;
+            }
+            halt(shared, drain);
+            halted.set_value();
+        });
+    }
+
+    std::shared_ptr<EventLoop> loop_;
+    std::unique_ptr<Shared> shared_;
+};
+
+/**
+ * @brief A filter whose frames are processed by a coroutine running on an event loop, so that
+ *        filters waiting for I/O share the loop thread instead of blocking a thread each.
+ *
+ * Frames pushed into the filter are queued, and a coroutine on the loop awaits `process` on each of
+ * them in order, pushing every output frame into the following elements from the loop thread.
+ * The filter thus decouples the previous elements from the following ones, like a Decoupler.
+ *
+ * @tparam Impl_ User-defined filter implementation.
+ *               It must define `InputPayload` and `OutputPayload` types, as well as a `process`
+ *               coroutine taking `Frame<InputPayload>` and returning
+ *               `Async<std::optional<Frame<OutputPayload>>>`, which may `co_await` the readiness
+ *               of file descriptors and timers on the event loop.
+ *               It may also define a `finish` function, as Filter implementations do.
+ */
+template <typename Impl_>
+class AsyncFilter : public Next<typename Impl_::InputPayload> {
+public:
+    using Impl = Impl_;
+    using InputPayload = typename Impl::InputPayload;
+    using OutputPayload = typename Impl::OutputPayload;
+
+    /**
+     * @brief Constructor. Typically not used directly, but through `make_arm` or `make_pipe`
+     *        builder functions, with a `dpipe::AsyncPlaceholder`.
+     */
+    template <typename... Args>
+    AsyncFilter(std::unique_ptr<Next<OutputPayload>>&& next, const AsyncOptions& options,
+                Args&&... args)
+            : loop_{options.loop}
+            , shared_{std::make_unique<Shared>(std::move(next), *loop_, options.capacity,
+                                               std::forward<Args>(args)...)} {
+        loop_->post([&shared = *shared_] {
+            shared.driver = run(shared);
+            shared.driver.start();
+        });
+    }
+
+    ~AsyncFilter() override {
+        if (shared_) {
+            // Queued wake-ups run first, as tasks are run in order.
+            impl::run_on_loop(*loop_, [&shared = *shared_] {
+                shared.suspended = {};
+                shared.driver = {};
+            });
+        }
+    }
+
+    AsyncFilter(const AsyncFilter& other) = delete;
+    AsyncFilter& operator=(const AsyncFilter& other) = delete;
+
+    AsyncFilter(AsyncFilter&& other) = default;
+    // The coroutine of the overwritten filter would have to be destroyed on its loop.
+    AsyncFilter& operator=(AsyncFilter&& other) = delete;
+
+    void push(Frame<InputPayload>&& input) override {
+        assert(shared_);
+        impl::share_frame(input);
+        auto& shared = *shared_;
+        std::unique_lock<std::mutex> lock{shared.mutex};
+        while (shared.inputs.size() >= shared.capacity && !loop_->in_loop()) {
+            const auto popped = shared.popped.load();
+            lock.unlock();
+            shared.popped.wait(popped);
+            lock.lock();
+        }
+        shared.inputs.push_back(std::move(input));
+        shared.metrics.frames_in();
+        shared.metrics.queue_depth(shared.inputs.size());
+        wake(lock);
+    }
+
+    void finish() override {
+        assert(shared_);
+        auto& shared = *shared_;
+        {
+            std::unique_lock<std::mutex> lock{shared.mutex};
+            shared.ended = true;
+            wake(lock);
+        }
+        if (loop_->in_loop()) {
+            loop_->run_until([&] { return shared.finished.load(); });
+        } else {
+            shared.finished.wait(false);
+        }
+    }
+
+    void collect(PipelineMetrics& metrics) const override {
+        assert(shared_);
+        shared_->metrics.collect(metrics, "AsyncFilter");
+        shared_->next->collect(metrics);
+    }
+
+private:
+    struct Shared {
+        template <typename... Args>
+        Shared(std::unique_ptr<Next<OutputPayload>>&& next, EventLoop& loop, std::size_t capacity,
+               Args&&... args)
+                : next{std::move(next)}
+                , loop{loop}
+                , capacity{capacity}
+                , impl{std::forward<Args>(args)...} {
+            assert(this->next);
+            assert(this->capacity > 0);
+        }
+
+        std::unique_ptr<Next<OutputPayload>> next;
+        EventLoop& loop;
+        const std::size_t capacity;
+        Impl impl;
+        std::mutex mutex;
+        // Protected by the mutex.
+        std::deque<Frame<InputPayload>> inputs;
+        bool ended{false};
+        bool waiting{false};
+        // Bumped at every frame taken from the queue, to wake up blocked producers.
+        std::atomic<uint32_t> popped{0};
+        // Only accessed by the loop thread.
+        std::coroutine_handle<> suspended{};
+        Async<void> driver;
+        std::atomic<bool> finished{false};
+        [[no_unique_address]] impl::ElementMetrics<> metrics;
+    };
+
+    // Suspends the coroutine until a frame is queued or the end of stream is signalled.
+    struct NextInput {
+        bool await_ready() {
+            std::lock_guard<std::mutex> lock{shared.mutex};
+            return !shared.inputs.empty() || shared.ended;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            std::lock_guard<std::mutex> lock{shared.mutex};
+            if (!shared.inputs.empty() || shared.ended) {
+                return false;
+            }
+            shared.suspended = handle;
+            shared.waiting = true;
+            return true;
+        }
+
+        std::optional<Frame<InputPayload>> await_resume() {
+            std::lock_guard<std::mutex> lock{shared.mutex};
+            if (shared.inputs.empty()) {
+                return {};
+            }
+            auto input = std::move(shared.inputs.front());
+            shared.inputs.pop_front();
+            shared.popped.fetch_add(1);
+            shared.popped.notify_all();
+            return input;
+        }
+
+        Shared& shared;
+    };
+
+    // Resumes the coroutine, if waiting for frames, on the loop thread.
+    void wake(std::unique_lock<std::mutex>& lock) {
+        auto& shared = *shared_;
+        if (!std::exchange(shared.waiting, false)) {
+            return;
+        }
+        lock.unlock();
+        loop_->post([&shared] {
+            if (shared.suspended) {
+                std::exchange(shared.suspended, {}).resume();
+            }
+        });
+    }
+
+    static Async<void> run(Shared& shared) {
+        while (true) {
+            auto input = co_await NextInput{shared};
+            if (!input.has_value()) {
+                break;
+            }
+            // Copied, as the input frame is moved into the implementation.
+            const auto header = input->header();
+            auto output = co_await shared.impl.process(std::move(*input));
+            if (output.has_value()) {
+                impl::carry_header(*output, header);
+                shared.metrics.frames_out();
+                shared.next->push(std::move(*output));
+            } else {
+                shared.metrics.frames_dropped();
+            }
+        }
+        impl::finish_filter(shared.impl, [&shared](Frame<OutputPayload>&& output) {
+            shared.metrics.frames_out();
+            shared.next->push(std::move(output));
+        });
+        shared.next->finish();
+        shared.finished.store(true);
+        shared.finished.notify_all();
+    }
+
+    std::shared_ptr<EventLoop> loop_;
+    std::unique_ptr<Shared> shared_;
+};
+
+} // namespace dpipe
+
+#endif // DPIPE_ELEMENTS_ASYNC_H_
@@ -0,0 +1,112 @@
+#ifndef DPIPE_ELEMENTS_BATCHING_H_
+#define DPIPE_ELEMENTS_BATCHING_H_
+
+#include <cassert>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <dpipe/frame-batch.h>
+#include <dpipe/frame-pool.h>
+#include <dpipe/frame.h>
+#include <dpipe/mut-frame.h>
+
+namespace dpipe {
+
+/**
+ * @brief A filter implementation gathering the payloads of consecutive frames into a FrameBatch,
+ *        forwarded once full, or at the end of stream.
+ *
+ * Frames gathered into the pending batch are reported as dropped by the metrics of the filter.
+ * A batch carries the header of its first frame (see FrameHeader).
+ *
+ * @tparam T The payload type.
+ */
+template <typename T>
+class Batcher {
+public:
+    using InputPayload = T;
+    using OutputPayload = FrameBatch<T>;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param size Number of payloads in every batch, but the last one.
+     */
+    explicit Batcher(std::size_t size)
+            : size_{size} {
+        assert(size_ > 0);
+    }
+
+    std::optional<Frame<OutputPayload>> process(Frame<InputPayload>&& frame) {
+        if (!batch_.has_value()) {
+            batch_.emplace(MutFrame<OutputPayload>::make(size_));
+            batch_->set_header(frame.header());
+        }
+        (*batch_)->push_back(*frame);
+        if (!(*batch_)->full()) {
+            return {};
+        }
+        return take();
+    }
+
+    std::optional<Frame<OutputPayload>> finish() {
+        if (!batch_.has_value()) {
+            return {};
+        }
+        return take();
+    }
+
+private:
+    Frame<OutputPayload> take() {
+        auto batch = std::move(*batch_).into_immutable();
+        batch_.reset();
+        return batch;
+    }
+
+    std::size_t size_;
+    std::optional<MutFrame<OutputPayload>> batch_;
+};
+
+/**
+ * @brief A filter implementation scattering the payloads of a FrameBatch into a frame each.
+ *        Every frame carries the header of its batch (see FrameHeader).
+ *
+ * @tparam T The payload type.
+ */
+template <typename T>
+class Unbatcher {
+public:
+    using InputPayload = FrameBatch<T>;
+    using OutputPayload = T;
+
+    Unbatcher() = default;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param pool The pool the memory of output frames is drawn from.
+     */
+    explicit Unbatcher(FramePool<T> pool)
+            : pool_{std::move(pool)} {}
+
+    void process_batch(std::span<Frame<InputPayload>> batches,
+                       std::vector<Frame<OutputPayload>>& outputs) {
+        for (const auto& batch : batches) {
+            for (std::size_t i = 0; i < batch->size(); ++i) {
+                outputs.push_back(pool_.has_value() ? Frame<T>::make(*pool_, (*batch)[i])
+                                                    : Frame<T>::make((*batch)[i]));
+                outputs.back().set_header(batch.header());
+            }
+        }
+    }
+
+private:
+    std::optional<FramePool<T>> pool_;
+};
+
+} // namespace dpipe
+
+#endif // DPIPE_ELEMENTS_BATCHING_H_
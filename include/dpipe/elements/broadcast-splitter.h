@@ -0,0 +1,290 @@
+#ifndef DPIPE_ELEMENTS_BROADCAST_SPLITTER_H_
+#define DPIPE_ELEMENTS_BROADCAST_SPLITTER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include <dpipe/elements/interfaces.h>
+#include <dpipe/frame.h>
+#include <dpipe/metrics.h>
+#include <dpipe/utils/hardware.h>
+#include <dpipe/utils/wait-strategy.h>
+
+namespace dpipe {
+
+/**
+ * @brief Run-time configuration of a BroadcastSplitter.
+ */
+struct BroadcastOptions {
+    /// @brief Number of slots of the shared ring, rounded up to a power of two.
+    std::size_t capacity{1024};
+    /// @brief How consumer threads wait for frames, as well as how the producer waits for the
+    ///        slowest arm to free a slot.
+    WaitStrategy wait_strategy{WaitStrategy::SpinPark};
+    /// @brief Number of checks before yielding or parking a waiting thread.
+    std::size_t spin_budget{256};
+    /// @brief Maximum number of frames read from the ring at every wake-up of a consumer thread
+    ///        and forwarded as a single batch.
+    std::size_t max_batch{32};
+};
+
+/**
+ * @brief A splitter that decouples each of its arms, as if every arm started with a Decoupler, but
+ *        with a single ring buffer shared by all of them.
+ *
+ * The producer writes every frame once in the ring, then publishes it with a single sequence
+ * number. Each arm has its own consumer thread, reading the ring through its own cursor, so that
+ * arms progress independently; the slowest arm gates the reuse of slots, blocking the producer
+ * when the ring is full. The last arm to read a slot takes the frame out of it, so that frames are
+ * not kept alive by the ring.
+ *
+ * @tparam InputPayload_ The input data type.
+ */
+template <typename InputPayload_>
+class BroadcastSplitter : public Next<InputPayload_> {
+public:
+    using InputPayload = InputPayload_;
+    using OutputPayload = InputPayload;
+
+    /**
+     * @brief Constructor. Typically not used directly, but through `make_broadcast_splitter`
+     *        builder function.
+     */
+    template <typename Arg1, typename Arg2, typename... Args>
+    BroadcastSplitter(const BroadcastOptions& options, Arg1&& arg1, Arg2&& arg2, Args&&... args)
+            : shared_{std::make_shared<Shared>(options)} {
+        add_arm(std::move(arg1), options);
+        add_arm(std::move(arg2), options);
+        (add_arm(std::forward<Args>(args), options), ...);
+        start();
+    }
+
+    ~BroadcastSplitter() = default;
+
+    BroadcastSplitter(const BroadcastSplitter& other) = delete;
+    BroadcastSplitter& operator=(const BroadcastSplitter& other) = delete;
+
+    BroadcastSplitter(BroadcastSplitter&& other) = default;
+    BroadcastSplitter& operator=(BroadcastSplitter&& other) = default;
+
+    void push(Frame<InputPayload>&& input) override {
+        assert(shared_);
+        wait_for_room(1);
+        write(std::move(input));
+        publish(1);
+    }
+
+    void push_batch(std::span<Frame<InputPayload>> inputs) override {
+        assert(shared_);
+        while (!inputs.empty()) {
+            const auto count = std::min(inputs.size(), shared_->capacity);
+            wait_for_room(count);
+            for (auto& input : inputs.first(count)) {
+                write(std::move(input));
+            }
+            publish(count);
+            inputs = inputs.subspan(count);
+        }
+    }
+
+    /**
+     * @brief Waits for every arm to forward the frames in the ring, then to propagate the end of
+     *        stream.
+     */
+    void finish() override {
+        assert(shared_);
+        auto& shared = *shared_;
+        shared.finished.store(0);
+        for (auto& arm : shared.arms) {
+            // Frames published before are visible to the arm as soon as it sees the request.
+            arm->finish_requested.store(true, std::memory_order_release);
+            arm->not_empty.notify();
+        }
+        auto finished = shared.finished.load(std::memory_order_acquire);
+        while (finished < shared.arms.size()) {
+            shared.finished.wait(finished, std::memory_order_acquire);
+            finished = shared.finished.load(std::memory_order_acquire);
+        }
+    }
+
+    void collect(PipelineMetrics& metrics) const override {
+        assert(shared_);
+        metrics_.collect(metrics, "BroadcastSplitter");
+        for (const auto& arm : shared_->arms) {
+            arm->next->collect(metrics);
+        }
+    }
+
+private:
+    struct Slot {
+        std::optional<Frame<InputPayload>> frame;
+        // Number of arms that have not read the frame yet.
+        std::atomic<std::size_t> remaining{0};
+    };
+
+    struct Arm {
+        Arm(std::unique_ptr<Next<OutputPayload>>&& next, const BroadcastOptions& options)
+                : next{std::move(next)}
+                , not_empty{options.wait_strategy, options.spin_budget} {}
+
+        std::unique_ptr<Next<OutputPayload>> next;
+        // Sequence number of the next frame to be read by the arm.
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> cursor{0};
+        Waiter not_empty;
+        // Set by the producer at the end of stream, cleared by the arm when propagating it.
+        std::atomic<bool> finish_requested{false};
+        std::jthread thread;
+    };
+
+    // State shared between the producer and the consumer threads.
+    struct Shared {
+        explicit Shared(const BroadcastOptions& options)
+                : capacity{std::bit_ceil(std::max<std::size_t>(options.capacity, 2))}
+                , ring{std::make_unique<Slot[]>(capacity)}
+                , not_full{options.wait_strategy, options.spin_budget}
+                , max_batch{options.max_batch < 1 ? 1 : options.max_batch} {}
+
+        ~Shared() {
+            // Threads must be stopped before the arms they forward frames to are destroyed.
+            for (auto& arm : arms) {
+                arm->thread = {};
+            }
+        }
+
+        Slot& slot(uint64_t sequence) {
+            return ring[sequence & (capacity - 1)];
+        }
+
+        const std::size_t capacity;
+        const std::unique_ptr<Slot[]> ring;
+        // Sequence number following the last published frame.
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> published{0};
+        Waiter not_full;
+        const std::size_t max_batch;
+        // Number of arms that propagated the end of stream.
+        std::atomic<std::size_t> finished{0};
+        std::vector<std::unique_ptr<Arm>> arms;
+    };
+
+    void add_arm(std::unique_ptr<Next<OutputPayload>>&& next, const BroadcastOptions& options) {
+        assert(next);
+        shared_->arms.push_back(std::make_unique<Arm>(std::move(next), options));
+    }
+
+    void start() {
+        for (auto& arm : shared_->arms) {
+            arm->thread = std::jthread{[&arm = *arm, shared = shared_.get()](
+                                               std::stop_token token) {
+                run_arm(arm, *shared, token);
+            }};
+        }
+    }
+
+    // Waits until `count` slots are free, i.e., read by every arm.
+    void wait_for_room(std::size_t count) {
+        auto& shared = *shared_;
+        auto has_room = [&] {
+            if (sequence_ + count - gating_ <= shared.capacity) {
+                return true;
+            }
+            // The cached position of the slowest arm is refreshed only when the ring looks full.
+            gating_ = sequence_;
+            for (const auto& arm : shared.arms) {
+                gating_ = std::min(gating_, arm->cursor.load(std::memory_order_acquire));
+            }
+            return sequence_ + count - gating_ <= shared.capacity;
+        };
+        if (!has_room()) {
+            shared.not_full.wait(has_room, std::stop_token{});
+        }
+    }
+
+    void write(Frame<InputPayload>&& input) {
+        impl::share_frame(input);
+        auto& slot = shared_->slot(sequence_);
+        slot.frame.emplace(std::move(input));
+        slot.remaining.store(shared_->arms.size(), std::memory_order_relaxed);
+        sequence_ += 1;
+    }
+
+    void publish(std::size_t count) {
+        auto& shared = *shared_;
+        shared.published.store(sequence_, std::memory_order_release);
+        for (auto& arm : shared.arms) {
+            arm->not_empty.notify();
+        }
+        metrics_.frames_in(count);
+        metrics_.frames_out(count * shared.arms.size());
+        metrics_.queue_depth(sequence_ - gating_);
+    }
+
+    static void run_arm(Arm& arm, Shared& shared, const std::stop_token& token) {
+        std::vector<Frame<OutputPayload>> batch;
+        batch.reserve(shared.max_batch);
+        uint64_t cursor = arm.cursor.load(std::memory_order_relaxed);
+        uint64_t available = cursor;
+        auto ready = [&] {
+            available = shared.published.load(std::memory_order_acquire);
+            return available > cursor || arm.finish_requested.load(std::memory_order_acquire);
+        };
+        while (arm.not_empty.wait(ready, token)) {
+            const auto end = std::min(available, cursor + shared.max_batch);
+            for (; cursor < end; ++cursor) {
+                batch.push_back(take(shared.slot(cursor)));
+            }
+            // Slots are released before forwarding, so that the producer can go on meanwhile.
+            arm.cursor.store(cursor, std::memory_order_release);
+            shared.not_full.notify();
+            if (batch.size() == 1) {
+                arm.next->push(std::move(batch.front()));
+            } else if (!batch.empty()) {
+                arm.next->push_batch(batch);
+            }
+            batch.clear();
+            // The request is loaded first, so that frames published before it are seen.
+            if (arm.finish_requested.load(std::memory_order_acquire)
+                && shared.published.load(std::memory_order_acquire) == cursor) {
+                arm.finish_requested.store(false, std::memory_order_relaxed);
+                arm.next->finish();
+                shared.finished.fetch_add(1, std::memory_order_release);
+                shared.finished.notify_all();
+            }
+        }
+    }
+
+    // Copies the frame out of the slot or, for the last arm reading it, moves it out.
+    static Frame<OutputPayload> take(Slot& slot) {
+        if (slot.remaining.load(std::memory_order_acquire) == 1) {
+            // Every other arm is done with the slot.
+            auto frame = std::move(*slot.frame);
+            slot.frame.reset();
+            return frame;
+        }
+        auto frame = *slot.frame;
+        if (slot.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            slot.frame.reset();
+        }
+        return frame;
+    }
+
+    std::shared_ptr<Shared> shared_;
+    // Sequence number of the next frame to be written. Only accessed by the producer.
+    uint64_t sequence_{0};
+    // Cached position of the slowest arm. Only accessed by the producer.
+    uint64_t gating_{0};
+    [[no_unique_address]] impl::ElementMetrics<> metrics_;
+};
+
+} // namespace dpipe
+
+#endif // DPIPE_ELEMENTS_BROADCAST_SPLITTER_H_
@@ -1,17 +1,184 @@
 #ifndef DPIPE_ELEMENTS_DECOUPLER_H_
 #define DPIPE_ELEMENTS_DECOUPLER_H_
 
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
 #include <memory>
+#include <optional>
+#include <span>
+#include <stop_token>
 #include <thread>
+#include <variant>
+#include <vector>
 
 #include <dpipe/elements/interfaces.h>
+#include <dpipe/frame-header.h>
 #include <dpipe/frame.h>
+#include <dpipe/metrics.h>
+#include <dpipe/tracing.h>
 #include <dpipe/utils/async-queue.h>
+#include <dpipe/utils/executor.h>
+#include <dpipe/utils/spsc-queue.h>
+#include <dpipe/utils/thread-options.h>
+#include <dpipe/utils/wait-strategy.h>
 
 namespace dpipe {
 
+/**
+ * @brief The queue implementation backing a Decoupler.
+ */
+enum class DecouplerQueue {
+    /// Lock-free single-producer/single-consumer ring buffer (see SpscQueue).
+    LockFree,
+    /// Mutex-protected queue (see AsyncQueue).
+    Locked,
+};
+
+/**
+ * @brief What a Decoupler does when a frame is pushed into its full queue.
+ */
+enum class OverflowPolicy {
+    /// Block the producer until the consumer makes room, propagating backpressure upstream.
+    Block,
+    /// Discard the incoming frame.
+    DropNewest,
+    /// Discard the oldest queued frame to make room for the incoming one.
+    /// Requires evicting from the consumer end, so the locked queue is always used.
+    DropOldest,
+    /// Replace all the queued frames with the incoming one, so that the consumer always gets the
+    /// latest frame. The capacity is ignored and the locked queue is always used.
+    Conflate,
+};
+
+/**
+ * @brief Counters updated by a Decoupler while applying its overflow policy and its deadline.
+ */
+struct DecouplerCounters {
+    /// @brief Number of frames discarded by the overflow policy.
+    std::atomic<uint64_t> dropped{0};
+    /// @brief Total time, in nanoseconds, spent by the producer waiting on a full queue.
+    std::atomic<uint64_t> blocked_ns{0};
+    /// @brief Number of frames discarded for being older than `DecouplerOptions::max_age`.
+    std::atomic<uint64_t> shed{0};
+    /// @brief Number of frames left in the queue after the consumer last took frames from it.
+    std::atomic<std::size_t> queue_depth{0};
+};
+
+/**
+ * @brief Run-time configuration of a Decoupler.
+ */
+struct DecouplerOptions {
+    /// @brief The queue implementation.
+    DecouplerQueue queue{DecouplerQueue::LockFree};
+    /// @brief Maximum number of queued frames.
+    ///        The lock-free queue rounds it up to a power of two.
+    std::size_t capacity{1024};
+    /// @brief What to do when the queue is full.
+    OverflowPolicy overflow{OverflowPolicy::Block};
+    /// @brief How the consumer thread waits for frames when the queue is empty, as well as how
+    ///        the producer waits for room when the queue is full.
+    WaitStrategy wait_strategy{WaitStrategy::SpinPark};
+    /// @brief Number of checks of the queue before yielding or parking the waiting thread.
+    std::size_t spin_budget{256};
+    /// @brief Maximum number of frames drained from the queue at every wake-up of the consumer
+    ///        thread and forwarded as a single batch.
+    std::size_t max_batch{32};
+    /// @brief Maximum age of the frames forwarded by the consumer, measured from their creation
+    ///        by the source (see FrameHeader). Older frames are discarded once taken from the
+    ///        queue, before reaching the next element. If not set, no frame is discarded. It
+    ///        requires frame headers to be enabled (see `DPIPE_ENABLE_FRAME_HEADERS`).
+    std::optional<std::chrono::nanoseconds> max_age{};
+    /// @brief Counters to be updated by the decoupler, so that the application can read them.
+    ///        If not set, the decoupler uses its own counters.
+    std::shared_ptr<DecouplerCounters> counters{};
+    /// @brief Executor running the consumer side of the decoupler as tasks, scheduled when the
+    ///        queue has frames. If not set, the decoupler spawns its own consumer thread.
+    std::shared_ptr<Executor> executor{};
+    /// @brief Options of the consumer thread, if any. The queue is allocated by the consumer
+    ///        thread once they are applied, so that it is placed on the NUMA node of the thread.
+    ThreadOptions thread{};
+};
+
+namespace impl {
+
+/**
+ * @brief The queue of a Decoupler, dispatching to the implementation chosen at run-time.
+ */
+template <typename T>
+class AnyQueue {
+public:
+    explicit AnyQueue(const DecouplerOptions& options)
+            : queue_{make_queue(options)} {}
+
+    bool try_push_back(T&& t) {
+        if (auto* queue = std::get_if<LockFree>(&queue_)) {
+            return queue->try_push_back(std::move(t));
+        }
+        return std::get<Locked>(queue_).try_push_back(std::move(t));
+    }
+
+    /**
+     * @brief Only available with the locked queue.
+     */
+    std::optional<T> push_back_evicting(T&& t) {
+        return std::get<Locked>(queue_).push_back_evicting(std::move(t));
+    }
+
+    /**
+     * @brief Only available with the locked queue.
+     */
+    std::size_t push_back_replacing(T&& t) {
+        return std::get<Locked>(queue_).push_back_replacing(std::move(t));
+    }
+
+    std::optional<T> try_pop_front() {
+        if (auto* queue = std::get_if<LockFree>(&queue_)) {
+            return queue->try_pop_front();
+        }
+        return std::get<Locked>(queue_).try_pop_front();
+    }
+
+    std::size_t size() const {
+        return std::visit([](const auto& queue) { return queue.size(); }, queue_);
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+private:
+    using LockFree = SpscQueue<T>;
+    using Locked = AsyncQueue<T>;
+    using Variant = std::variant<LockFree, Locked>;
+
+    static Variant make_queue(const DecouplerOptions& options) {
+        switch (options.overflow) {
+            case OverflowPolicy::DropOldest:
+                return Variant{std::in_place_type<Locked>, options.capacity};
+            case OverflowPolicy::Conflate:
+                return Variant{std::in_place_type<Locked>};
+            case OverflowPolicy::Block:
+            case OverflowPolicy::DropNewest:
+                break;
+        }
+        switch (options.queue) {
+            case DecouplerQueue::Locked:
+                return Variant{std::in_place_type<Locked>, options.capacity};
+            case DecouplerQueue::LockFree:
+                break;
+        }
+        return Variant{std::in_place_type<LockFree>, options.capacity};
+    }
+
+    Variant queue_;
+};
+
+} // namespace impl
+
 /**
  * @brief A special kind of filter that decouples contiguous elements, so that the producer can push
  *        multiple frames without waiting for the consumer to finish its processing.
@@ -28,14 +195,25 @@ public:
      * @brief Constructor. Typically not used directly, but through `make_arm` or `make_pipe`
      *        builder functions.
      */
-    explicit Decoupler(std::unique_ptr<Next<OutputPayload>>&& next)
+    explicit Decoupler(std::unique_ptr<Next<OutputPayload>>&& next,
+                       const DecouplerOptions& options = {})
             : next_{std::move(next)}
-            , queue_{std::make_shared<AsyncQueue<Frame<OutputPayload>>>()} {
+            , executor_{options.executor} {
         assert(next_);
-        start();
+        // Ages are read from frame headers, so a deadline would never be enforced without them.
+        assert(FRAME_HEADERS_ENABLED || !options.max_age.has_value());
+        if (executor_) {
+            shared_ = std::make_shared<Shared>(options);
+        } else {
+            start(options);
+        }
     }
 
-    ~Decoupler() = default;
+    ~Decoupler() {
+        if (shared_ && executor_) {
+            shared_->stop_tasks();
+        }
+    }
 
     Decoupler(const Decoupler& other) = delete;
     Decoupler& operator=(const Decoupler& other) = delete;
@@ -44,27 +222,326 @@ public:
     Decoupler& operator=(Decoupler&& other) = default;
 
     void push(Frame<InputPayload>&& input) override {
-        assert(queue_);
-        queue_->push_back(std::move(input));
+        assert(shared_);
+        enqueue(std::move(input));
+        shared_->metrics.frames_in();
+        record_queue_depth();
+        wake_consumer();
+    }
+
+    void push_batch(std::span<Frame<InputPayload>> inputs) override {
+        assert(shared_);
+        for (auto& input : inputs) {
+            enqueue(std::move(input));
+        }
+        shared_->metrics.frames_in(inputs.size());
+        record_queue_depth();
+        wake_consumer();
+    }
+
+    /**
+     * @brief Forwards every queued frame, then propagates the end of stream from the consumer
+     *        thread or task. It blocks until the end of stream has reached every sink.
+     */
+    void finish() override {
+        assert(shared_);
+        auto& shared = *shared_;
+        // Frames pushed before are visible to the consumer as soon as it sees the request.
+        shared.finish_requested.store(true, std::memory_order_release);
+        wake_consumer();
+        if (shared.executor) {
+            // The consumer task may be queued behind this thread: help the executor meanwhile.
+            while (!shared.finished.load(std::memory_order_acquire)) {
+                if (!shared.executor->run_one()) {
+                    std::this_thread::yield();
+                }
+            }
+        } else {
+            shared.finished.wait(false, std::memory_order_acquire);
+        }
+        // Ready for the next stream.
+        shared.finished.store(false, std::memory_order_relaxed);
+    }
+
+    void collect(PipelineMetrics& metrics) const override {
+        assert(shared_);
+        shared_->metrics.collect(metrics, "Decoupler");
+        if constexpr (METRICS_ENABLED) {
+            // The depth recorded by the producer is stale after the consumer pops frames.
+            metrics.back().queue_depth = shared_->queue.size();
+            metrics.back().frames_dropped =
+                    shared_->counters->dropped.load(std::memory_order_relaxed)
+                    + shared_->counters->shed.load(std::memory_order_relaxed);
+        }
+        assert(next_);
+        next_->collect(metrics);
+    }
+
+    /**
+     * @brief Returns the counters updated while applying the overflow policy and the deadline.
+     */
+    const DecouplerCounters& counters() const {
+        assert(shared_);
+        return *shared_->counters;
     }
 
 private:
-    void start() {
-        thread_ = std::jthread{[next = next_, queue = queue_](std::stop_token token) {
-            while (!token.stop_requested()) {
-                static constexpr auto DURATION = std::chrono::milliseconds(1);
-                auto output = queue->try_pop_front_for(DURATION);
-                if (output.has_value()) {
-                    next->push(std::move(*output));
+    // State of the consumer task, when running on an executor.
+    enum class TaskState {
+        Idle,
+        Scheduled,
+        Running,
+        Stopped,
+    };
+
+    // State shared between the producer and the consumer thread or tasks.
+    struct Shared {
+        explicit Shared(const DecouplerOptions& options)
+                : queue{options}
+                , overflow{options.overflow}
+                , max_age{options.max_age}
+                , counters{options.counters ? options.counters
+                                            : std::make_shared<DecouplerCounters>()}
+                , not_empty{options.wait_strategy, options.spin_budget}
+                , not_full{options.wait_strategy, options.spin_budget}
+                , max_batch{options.max_batch < 1 ? 1 : options.max_batch}
+                , executor{options.executor.get()} {}
+
+        // Waits for the running task, if any, and prevents further ones from running.
+        void stop_tasks() {
+            auto state = task_state.load();
+            while (true) {
+                if (state == TaskState::Running) {
+                    task_state.wait(state);
+                    state = task_state.load();
+                } else if (task_state.compare_exchange_weak(state, TaskState::Stopped)) {
+                    return;
                 }
             }
+        }
+
+        impl::AnyQueue<Frame<OutputPayload>> queue;
+        const OverflowPolicy overflow;
+        const std::optional<std::chrono::nanoseconds> max_age;
+        const std::shared_ptr<DecouplerCounters> counters;
+        Waiter not_empty;
+        Waiter not_full;
+        const std::size_t max_batch;
+        // Used only when running on an executor. Tasks only refer to it, so that the decoupler
+        // is the one keeping it alive.
+        Executor* const executor;
+        std::atomic<TaskState> task_state{TaskState::Idle};
+        // Set by the producer at the end of stream, cleared by the consumer when propagating it.
+        std::atomic<bool> finish_requested{false};
+        // Set by the consumer once the end of stream has been propagated.
+        std::atomic<bool> finished{false};
+        std::vector<Frame<OutputPayload>> task_batch;
+        // Input counters and queue depth are updated by the producer, all the others by the
+        // consumer.
+        [[no_unique_address]] impl::ElementMetrics<> metrics;
+        [[no_unique_address]] impl::ElementTracer<> tracer;
+    };
+
+    void record_queue_depth() {
+        if constexpr (METRICS_ENABLED) {
+            shared_->metrics.queue_depth(shared_->queue.size());
+        }
+    }
+
+    void wake_consumer() {
+        if (shared_->executor) {
+            schedule(next_, shared_);
+        } else {
+            shared_->not_empty.notify();
+        }
+    }
+
+    void enqueue(Frame<InputPayload>&& input) {
+        impl::share_frame(input);
+        auto& shared = *shared_;
+        const auto trace_frame = shared.tracer.id(input);
+        shared.tracer.queue("Decoupler", TraceEvent::Phase::QueueBegin, trace_frame);
+        switch (shared.overflow) {
+            case OverflowPolicy::Block:
+                if (!shared.queue.try_push_back(std::move(input))) {
+                    block(std::move(input));
+                }
+                break;
+            case OverflowPolicy::DropNewest:
+                if (!shared.queue.try_push_back(std::move(input))) {
+                    shared.counters->dropped.fetch_add(1, std::memory_order_relaxed);
+                    shared.tracer.queue("Decoupler", TraceEvent::Phase::QueueEnd, trace_frame);
+                }
+                break;
+            case OverflowPolicy::DropOldest:
+                if (auto evicted = shared.queue.push_back_evicting(std::move(input))) {
+                    shared.counters->dropped.fetch_add(1, std::memory_order_relaxed);
+                    shared.tracer.queue("Decoupler", TraceEvent::Phase::QueueEnd,
+                                        shared.tracer.id(*evicted));
+                }
+                break;
+            case OverflowPolicy::Conflate:
+                if (auto replaced = shared.queue.push_back_replacing(std::move(input))) {
+                    shared.counters->dropped.fetch_add(replaced, std::memory_order_relaxed);
+                }
+                break;
+        }
+    }
+
+    void block(Frame<InputPayload>&& input) {
+        auto& shared = *shared_;
+        // Frames of the current batch may not have been notified yet.
+        wake_consumer();
+        const auto begin = std::chrono::steady_clock::now();
+        auto pushed = [&] { return shared.queue.try_push_back(std::move(input)); };
+        if (shared.executor) {
+            // The consumer task may be waiting for this thread: help the executor meanwhile.
+            while (!pushed()) {
+                if (!shared.executor->run_one()) {
+                    std::this_thread::yield();
+                }
+            }
+        } else {
+            // Producers are not stopped while pushing: the consumer thread is the one making room.
+            shared.not_full.wait(pushed, std::stop_token{});
+        }
+        const auto blocked = std::chrono::steady_clock::now() - begin;
+        shared.counters->blocked_ns.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(blocked).count(),
+                std::memory_order_relaxed);
+    }
+
+    void start(const DecouplerOptions& options) {
+        std::promise<std::shared_ptr<Shared>> created;
+        auto future = created.get_future();
+        // The thread refers to the options and to the promise only until the state is created.
+        thread_ = std::jthread{[next = next_, &options, &created](std::stop_token token) {
+            apply_thread_options(options.thread);
+            // Allocated from this thread, so that pages are first touched on its NUMA node.
+            auto shared = std::make_shared<Shared>(options);
+            created.set_value(shared);
+            std::vector<Frame<OutputPayload>> batch;
+            batch.reserve(shared->max_batch);
+            auto ready = [&] {
+                auto output = shared->queue.try_pop_front();
+                if (!output.has_value()) {
+                    return shared->finish_requested.load(std::memory_order_acquire);
+                }
+                batch.push_back(std::move(*output));
+                return true;
+            };
+            while (shared->not_empty.wait(ready, token)) {
+                drain(*next, *shared, batch);
+            }
         }};
+        shared_ = future.get();
+    }
+
+    static void schedule(const std::shared_ptr<Next<OutputPayload>>& next,
+                         const std::shared_ptr<Shared>& shared) {
+        // Pairs with the fence in `run_task`: either the task sees the new frames,
+        // or this thread sees the task done.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto expected = TaskState::Idle;
+        if (shared->task_state.compare_exchange_strong(expected, TaskState::Scheduled)) {
+            shared->executor->post([next, shared] { run_task(next, shared); });
+        }
+    }
+
+    static void run_task(const std::shared_ptr<Next<OutputPayload>>& next,
+                         const std::shared_ptr<Shared>& shared) {
+        auto expected = TaskState::Scheduled;
+        if (!shared->task_state.compare_exchange_strong(expected, TaskState::Running)) {
+            // The decoupler has been destroyed.
+            return;
+        }
+        drain(*next, *shared, shared->task_batch);
+        shared->task_state.store(TaskState::Idle);
+        shared->task_state.notify_all();
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!shared->queue.empty() || shared->finish_requested.load()) {
+            schedule(next, shared);
+        }
+    }
+
+    // Forwards the frames already in `batch`, plus as many queued frames as allowed.
+    // Then, propagates the end of stream if requested and no frame is left.
+    static void drain(Next<OutputPayload>& next, Shared& shared,
+                      std::vector<Frame<OutputPayload>>& batch) {
+        while (batch.size() < shared.max_batch) {
+            auto output = shared.queue.try_pop_front();
+            if (!output.has_value()) {
+                break;
+            }
+            batch.push_back(std::move(*output));
+        }
+        shared.counters->queue_depth.store(shared.queue.size(), std::memory_order_relaxed);
+        if (!batch.empty()) {
+            forward(next, shared, batch);
+        }
+        // The request is loaded first, so that frames pushed before it are seen in the queue.
+        if (shared.finish_requested.load(std::memory_order_acquire) && shared.queue.empty()) {
+            shared.finish_requested.store(false, std::memory_order_relaxed);
+            next.finish();
+            shared.finished.store(true, std::memory_order_release);
+            shared.finished.notify_all();
+        }
+    }
+
+    static void forward(Next<OutputPayload>& next, Shared& shared,
+                        std::vector<Frame<OutputPayload>>& batch) {
+        if (shared.overflow == OverflowPolicy::Block && !shared.executor) {
+            shared.not_full.notify();
+        }
+        const auto begin = shared.metrics.now();
+        if (tracing_enabled()) {
+            for (const auto& frame : batch) {
+                shared.tracer.queue("Decoupler", TraceEvent::Phase::QueueEnd,
+                                    shared.tracer.id(frame));
+            }
+        }
+        if constexpr (FRAME_HEADERS_ENABLED) {
+            if (shared.max_age.has_value()) {
+                shed_stale(shared, batch);
+            }
+        }
+        shared.metrics.frames_out(batch.size());
+        if (batch.empty()) {
+            return;
+        }
+        if (batch.size() == 1) {
+            next.push(std::move(batch.front()));
+        } else {
+            next.push_batch(batch);
+        }
+        batch.clear();
+        shared.metrics.busy(begin);
+    }
+
+    // Discards the frames older than the maximum age, keeping the others in order.
+    static void shed_stale(Shared& shared, std::vector<Frame<OutputPayload>>& batch) {
+        const auto now = FrameHeader::Clock::now();
+        std::size_t kept = 0;
+        for (auto& frame : batch) {
+            const auto& header = frame.header();
+            if (!header.is_stamped() || now - header.created <= *shared.max_age) {
+                if (&batch[kept] != &frame) {
+                    batch[kept] = std::move(frame);
+                }
+                kept += 1;
+            }
+        }
+        if (kept < batch.size()) {
+            shared.counters->shed.fetch_add(batch.size() - kept, std::memory_order_relaxed);
+            batch.erase(batch.begin() + static_cast<std::ptrdiff_t>(kept), batch.end());
+        }
     }
 
     // The reference to `Next` is stored as a shared pointer to allow its use in
     // the internally-spawned thread. Though, it is not meant to be shared outside of this class.
     std::shared_ptr<Next<OutputPayload>> next_;
-    std::shared_ptr<AsyncQueue<Frame<OutputPayload>>> queue_;
+    std::shared_ptr<Shared> shared_;
+    std::shared_ptr<Executor> executor_;
     std::jthread thread_;
 };
 
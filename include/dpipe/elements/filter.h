@@ -1,11 +1,11 @@
 #ifndef DPIPE_ELEMENTS_FILTER_H_
 #define DPIPE_ELEMENTS_FILTER_H_
 
-#include <cassert>
 #include <memory>
+#include <utility>
 
 #include <dpipe/elements/interfaces.h>
-#include <dpipe/frame.h>
+#include <dpipe/elements/static.h>
 
 namespace dpipe {
 
@@ -15,10 +15,25 @@ namespace dpipe {
  * @tparam Impl_ User-defined filter implementation.
  *               It must define `InputPayload` and `OutPayload` types, as well as a `process`
  *               function taking `Frame<InputPayload>` and returning
- *               `std::optional<Frame<OutputPayload>>`.
+ *               `std::optional<Frame<OutputPayload>>`, or taking the data objects instead, as
+ *               listed in `impl::process_payload` (_e.g._, to run vectorised loops over the
+ *               columns of a FrameBatch).
+ *               It may also define a `process_batch` function taking
+ *               `std::span<Frame<InputPayload>>` and `std::vector<Frame<OutputPayload>>&`, which
+ *               appends output frames to the vector; otherwise, batches are processed by calling
+ *               `process` on each frame. If it defines `process_batch` only, single frames are
+ *               processed as batches of one. Output frames it did not stamp itself take the
+ *               header of the input frame at the same position if it outputs as many frames
+ *               as it got, or the header of the first input frame otherwise (see
+ *               `impl::carry_headers`).
+ *               It may also define a `finish` function taking no input and returning
+ *               `std::optional<Frame<OutputPayload>>`, called at the end of stream to flush any
+ *               pending state; the returned frame, if any, is forwarded before the end of stream.
  */
 template <typename Impl_>
-class Filter : public Next<typename Impl_::InputPayload> {
+class Filter
+        : public StaticArm<impl::StaticFilter<
+                  Impl_, impl::DynamicLink<typename Impl_::OutputPayload>>> {
 public:
     using Impl = Impl_;
     using InputPayload = typename Impl::InputPayload;
@@ -30,30 +45,9 @@ public:
      */
     template <typename... Args>
     explicit Filter(std::unique_ptr<Next<OutputPayload>>&& next, Args&&... args)
-            : next_{std::move(next)}
-            , impl_{std::forward<Args>(args)...} {
-        assert(next_);
-    }
-
-    ~Filter() = default;
-
-    Filter(const Filter& other) = delete;
-    Filter& operator=(const Filter& other) = delete;
-
-    Filter(Filter&& other) = default;
-    Filter& operator=(Filter&& other) = default;
-
-    void push(Frame<InputPayload>&& input) override {
-        auto output = impl_.process(std::move(input));
-        if (output.has_value()) {
-            assert(next_);
-            next_->push(std::move(*output));
-        }
-    }
-
-private:
-    std::unique_ptr<Next<OutputPayload>> next_;
-    Impl impl_;
+            : StaticArm<impl::StaticFilter<Impl, impl::DynamicLink<OutputPayload>>>{
+                      std::in_place, impl::DynamicLink<OutputPayload>{std::move(next)},
+                      std::forward<Args>(args)...} {}
 };
 
 } // namespace dpipe
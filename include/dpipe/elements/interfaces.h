@@ -1,10 +1,30 @@
 #ifndef DPIPE_ELEMENTS_INTERFACES_H_
 #define DPIPE_ELEMENTS_INTERFACES_H_
 
+#include <functional>
+#include <optional>
+#include <span>
+#include <utility>
+
+#include <dpipe/frame-batch.h>
 #include <dpipe/frame.h>
+#include <dpipe/metrics.h>
+#include <dpipe/mut-frame.h>
 
 namespace dpipe {
 
+/**
+ * @brief The outcome of asking a source to produce a frame.
+ */
+enum class SourceStatus {
+    /// A frame has been produced and pushed into the pipeline.
+    Produced,
+    /// No frame is available now, but more may come later.
+    Idle,
+    /// No frame will ever come: the end of stream has been reached.
+    EndOfStream,
+};
+
 /**
  * @brief An interface for the first element in a pipeline (source).
  *        Client code does not need to use it directly.
@@ -16,7 +36,37 @@ public:
     /**
      * @brief Makes the source produce a frame.
      */
-    virtual void push() = 0;
+    virtual SourceStatus push() = 0;
+
+    /**
+     * @brief Propagates the end of stream through the following elements. It returns once every
+     *        frame queued in the pipeline has reached its sink.
+     */
+    virtual void finish() {}
+
+    /**
+     * @brief Starts a source that produces frames on its own, _e.g._, on an event loop, instead of
+     *        being polled through `push`.
+     *
+     * @param finished Called once the end of stream has been propagated.
+     * @return `false` if the source is to be polled through `push`.
+     */
+    virtual bool start(std::function<void()>&& /*finished*/) {
+        return false;
+    }
+
+    /**
+     * @brief Stops a source started through `start`. The call blocks.
+     *
+     * @param drain If `true`, the end of stream is propagated as if the source reached it.
+     */
+    virtual void stop(bool /*drain*/) {}
+
+    /**
+     * @brief Appends the metrics of the element and of the following ones to `metrics`.
+     *        Nothing is appended when the instrumentation is disabled.
+     */
+    virtual void collect(PipelineMetrics& /*metrics*/) const {}
 };
 
 /**
@@ -34,8 +84,136 @@ public:
      * @brief Pushes a new frame into the element.
      */
     virtual void push(Frame<Payload>&& frame) = 0;
+
+    /**
+     * @brief Pushes a batch of frames into the element, moving them out of `frames`.
+     *        By default, frames are pushed one at a time; elements override it to forward
+     *        the whole batch at once.
+     */
+    virtual void push_batch(std::span<Frame<Payload>> frames) {
+        for (auto& frame : frames) {
+            push(std::move(frame));
+        }
+    }
+
+    /**
+     * @brief Signals the end of stream: no frame follows. The element forwards its pending frames,
+     *        if any, then propagates the end of stream to the following elements. It returns once
+     *        every frame has reached its sink.
+     */
+    virtual void finish() {}
+
+    /**
+     * @brief Appends the metrics of the element and of the following ones to `metrics`.
+     *        Nothing is appended when the instrumentation is disabled.
+     */
+    virtual void collect(PipelineMetrics& /*metrics*/) const {}
 };
 
+namespace impl {
+
+/**
+ * @brief Returns whether a source implementation that produced no frame reached the end of
+ *        stream. Implementations that do not define `end_of_stream` never do.
+ */
+template <typename SourceImpl>
+bool end_of_stream(const SourceImpl& impl) {
+    if constexpr (requires { impl.end_of_stream(); }) {
+        return impl.end_of_stream();
+    } else {
+        return false;
+    }
+}
+
+/**
+ * @brief Whether a filter implementation defines a `process` function, in any of the forms accepted
+ *        by `process_payload`. Implementations that only define `process_batch` process single
+ *        frames as batches of one.
+ */
+template <typename FilterImpl, typename In = typename FilterImpl::InputPayload,
+          typename Out = typename FilterImpl::OutputPayload>
+inline constexpr bool processes_frames =
+        requires(FilterImpl& impl, Frame<In>&& input) { impl.process(std::move(input)); }
+        || requires(FilterImpl& impl, In& data) { impl.process(data); }
+        || (frame_batch<In> && frame_batch<Out>
+            && requires(FilterImpl& impl, const In& input, Out& output) {
+                   impl.process(input, output);
+               });
+
+/**
+ * @brief Processes a frame through a filter implementation, calling the form of `process` it
+ *        defines:
+ *        - `process(Frame<InputPayload>&&)`, returning `std::optional<Frame<OutputPayload>>`;
+ *        - `process(InputPayload&)`, modifying the data object in place, which is copied first if
+ *          shared (see MutFrame), _e.g._, the columns of a FrameBatch;
+ *        - `process(const InputPayload&, OutputPayload&)`, writing a new data object created with
+ *          the size of the input, only if both payload types are FrameBatch types.
+ */
+template <typename FilterImpl, typename In = typename FilterImpl::InputPayload,
+          typename Out = typename FilterImpl::OutputPayload>
+std::optional<Frame<Out>> process_payload(FilterImpl& impl, Frame<In>&& input) {
+    if constexpr (requires { impl.process(std::move(input)); }) {
+        return impl.process(std::move(input));
+    } else if constexpr (requires(In& data) { impl.process(data); }) {
+        auto data = MutFrame<In>::from(std::move(input));
+        impl.process(*data);
+        return data.into_immutable();
+    } else {
+        static_assert(processes_frames<FilterImpl, In, Out>,
+                      "The filter implementation defines no process function");
+        auto output = MutFrame<Out>::make(input->size());
+        output->resize(input->size());
+        impl.process(*input, *output);
+        return output.into_immutable();
+    }
+}
+
+/**
+ * @brief Same as `process_payload`, but also carrying the header of the input frame over to the
+ *        output one (see `carry_header`).
+ */
+template <typename FilterImpl, typename In = typename FilterImpl::InputPayload,
+          typename Out = typename FilterImpl::OutputPayload>
+std::optional<Frame<Out>> process_frame(FilterImpl& impl, Frame<In>&& input) {
+    if constexpr (FRAME_HEADER_STORED) {
+        const auto header = input.header();
+        auto output = process_payload(impl, std::move(input));
+        if (output.has_value()) {
+            carry_header(*output, header);
+        }
+        return output;
+    } else {
+        return process_payload(impl, std::move(input));
+    }
+}
+
+/**
+ * @brief Lets a filter implementation flush its state at the end of stream, forwarding the frame
+ *        returned by its optional `finish` function, if any.
+ */
+template <typename FilterImpl, typename Forward>
+void finish_filter(FilterImpl& impl, Forward&& forward) {
+    if constexpr (requires { impl.finish(); }) {
+        auto output = impl.finish();
+        if (output.has_value()) {
+            forward(std::move(*output));
+        }
+    }
+}
+
+/**
+ * @brief Lets a sink implementation flush its state at the end of stream, calling its optional
+ *        `finish` function.
+ */
+template <typename SinkImpl>
+void finish_sink(SinkImpl& impl) {
+    if constexpr (requires { impl.finish(); }) {
+        impl.finish();
+    }
+}
+
+} // namespace impl
+
 } // namespace dpipe
 
 #endif // DPIPE_ELEMENTS_INTERFACES_H_
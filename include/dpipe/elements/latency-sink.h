@@ -0,0 +1,154 @@
+#ifndef DPIPE_ELEMENTS_LATENCY_SINK_H_
+#define DPIPE_ELEMENTS_LATENCY_SINK_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include <dpipe/frame-header.h>
+#include <dpipe/frame.h>
+#include <dpipe/metrics.h>
+
+namespace dpipe {
+
+/**
+ * @brief A snapshot of a LatencyMonitor.
+ */
+struct LatencyReport {
+    /// @brief Number of frames received.
+    uint64_t frames{};
+    /// @brief Number of frames received without a header stamped by a source, which are not
+    ///        measured.
+    uint64_t unstamped{};
+    /// @brief Time elapsed between the creation of frames and their reception.
+    HistogramSnapshot latency;
+    /// @brief Median of `latency`.
+    std::chrono::nanoseconds p50{};
+    /// @brief 99th percentile of `latency`.
+    std::chrono::nanoseconds p99{};
+    /// @brief 99.9th percentile of `latency`.
+    std::chrono::nanoseconds p999{};
+    /// @brief Number of runs of consecutive sequence numbers never received before a later one.
+    uint64_t gaps{};
+    /// @brief Number of sequence numbers skipped by the gaps.
+    uint64_t missing{};
+    /// @brief Number of frames received after a frame with a higher sequence number, _e.g._,
+    ///        reordered by a ParallelFilter, or received twice.
+    uint64_t late{};
+};
+
+/**
+ * @brief Measures the end-to-end latency of the frames of a single source, and detects the frames
+ *        lost on the way, from their headers (see FrameHeader).
+ *
+ * It is meant to be written by a single thread at a time, typically through a LatencySink, and
+ * read by any thread.
+ */
+class LatencyMonitor {
+public:
+    using Clock = FrameHeader::Clock;
+
+    /**
+     * @brief Records the reception of a frame with the given header.
+     *        Frames sharing the sequence number of the previous one (_e.g._, the frames scattered
+     *        from the same batch) are measured, but not counted as late.
+     */
+    void record(const FrameHeader& header, Clock::time_point now) {
+        add(frames_, 1);
+        if (!header.is_stamped()) {
+            add(unstamped_, 1);
+            return;
+        }
+        const auto age = std::chrono::duration_cast<std::chrono::nanoseconds>(now - header.created);
+        latency_.record(static_cast<uint64_t>(std::max<int64_t>(age.count(), 0)));
+        if (header.sequence >= next_sequence_) {
+            if (header.sequence > next_sequence_) {
+                add(gaps_, 1);
+                add(missing_, header.sequence - next_sequence_);
+            }
+            next_sequence_ = header.sequence + 1;
+        } else if (header.sequence + 1 < next_sequence_) {
+            add(late_, 1);
+        }
+    }
+
+    /**
+     * @brief Returns a snapshot of the measurements.
+     */
+    LatencyReport report() const {
+        LatencyReport report;
+        report.frames = frames_.load(std::memory_order_relaxed);
+        report.unstamped = unstamped_.load(std::memory_order_relaxed);
+        report.latency = latency_.snapshot();
+        report.p50 = report.latency.percentile(0.5);
+        report.p99 = report.latency.percentile(0.99);
+        report.p999 = report.latency.percentile(0.999);
+        report.gaps = gaps_.load(std::memory_order_relaxed);
+        report.missing = missing_.load(std::memory_order_relaxed);
+        report.late = late_.load(std::memory_order_relaxed);
+        return report;
+    }
+
+private:
+    // Counters have a single writer, so a plain load and store is enough.
+    static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    LatencyHistogram latency_;
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> unstamped_{0};
+    std::atomic<uint64_t> gaps_{0};
+    std::atomic<uint64_t> missing_{0};
+    std::atomic<uint64_t> late_{0};
+    // Only accessed by the writer.
+    uint64_t next_sequence_{0};
+};
+
+/**
+ * @brief A sink implementation feeding the headers of incoming frames to a LatencyMonitor, _e.g._,
+ *        on an arm of a Splitter, next to the actual sink. It requires frame headers to be enabled
+ *        (see `DPIPE_ENABLE_FRAME_HEADERS`).
+ *
+ * @tparam T The payload type.
+ */
+template <typename T>
+class LatencySink {
+public:
+    // Dependent on T, so that it only fails when the sink is used.
+    static_assert(FRAME_HEADERS_ENABLED && sizeof(T) > 0,
+                  "LatencySink requires DPIPE_ENABLE_FRAME_HEADERS");
+
+    using InputPayload = T;
+    using InputFrame = Frame<InputPayload>;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param monitor The monitor recording the measurements, which must outlive the sink.
+     */
+    explicit LatencySink(LatencyMonitor& monitor)
+            : monitor_{monitor} {}
+
+    void consume(InputFrame&& frame) {
+        monitor_.get().record(frame.header(), LatencyMonitor::Clock::now());
+    }
+
+    void consume_batch(std::span<InputFrame> frames) {
+        // The frames of a batch are received at once.
+        const auto now = LatencyMonitor::Clock::now();
+        for (const auto& frame : frames) {
+            monitor_.get().record(frame.header(), now);
+        }
+    }
+
+private:
+    std::reference_wrapper<LatencyMonitor> monitor_;
+};
+
+} // namespace dpipe
+
+#endif // DPIPE_ELEMENTS_LATENCY_SINK_H_
@@ -0,0 +1,549 @@
+#ifndef DPIPE_ELEMENTS_MERGER_H_
+#define DPIPE_ELEMENTS_MERGER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include <dpipe/elements/interfaces.h>
+#include <dpipe/frame.h>
+#include <dpipe/metrics.h>
+#include <dpipe/utils/hardware.h>
+#include <dpipe/utils/mpsc-queue.h>
+#include <dpipe/utils/wait-strategy.h>
+
+namespace dpipe {
+
+/**
+ * @brief The order in which a Merger forwards the frames of its inputs.
+ */
+enum class MergePolicy {
+    /// Forward frames in the order they have been pushed, regardless of their input.
+    ArrivalOrder,
+    /// Take one frame from every input in turn, so that a busy input cannot starve the others.
+    RoundRobin,
+    /// Forward the frame with the lowest timestamp among the first frame of every input, waiting
+    /// for every input to have one, but no longer than the maximum wait.
+    Timestamp,
+};
+
+/**
+ * @brief Run-time configuration of a Merger.
+ */
+struct MergerOptions {
+    /// @brief The order in which frames are forwarded.
+    MergePolicy policy{MergePolicy::ArrivalOrder};
+    /// @brief Number of slots of the queue shared by all inputs, rounded up to a power of two.
+    ///        With the round-robin and timestamp policies, it also bounds the number of frames
+    ///        taken out of the queue and held back by the consumer thread.
+    std::size_t capacity{1024};
+    /// @brief How the consumer thread waits for frames.
+    WaitStrategy wait_strategy{WaitStrategy::SpinPark};
+    /// @brief Number of checks of the queue before yielding or parking the consumer thread.
+    std::size_t spin_budget{256};
+    /// @brief Maximum number of frames forwarded as a single batch.
+    std::size_t max_batch{32};
+    /// @brief How long a frame may be held back waiting for a frame from every input
+    ///        (timestamp policy only).
+    std::chrono::microseconds max_wait{1000};
+};
+
+template <typename Payload_>
+class MergerInput;
+
+/**
+ * @brief A fan-in element, merging the frames pushed into several inputs into a single arm.
+ *
+ * Each input is the last element of its own pipeline, so that multiple sources, each on its own
+ * thread, feed a shared segment. Inputs push frames into a lock-free multi-producer/single-consumer
+ * queue; a single consumer thread forwards them to the arm according to the merge policy, blocking
+ * the inputs when the queue is full.
+ *
+ * The merger is a handle: it is kept alive by its inputs, so that it can be dropped once they have
+ * been created.
+ *
+ * @tparam Payload_ The data type handled by the merger.
+ */
+template <typename Payload_>
+class Merger {
+public:
+    using Payload = Payload_;
+
+    /**
+     * @brief Returns the key of the timestamp policy, as a duration since any epoch.
+     *        If not set, frames are timestamped when pushed into their input.
+     */
+    using TimestampOf = std::function<std::chrono::nanoseconds(const Payload&)>;
+
+    /**
+     * @brief Constructor. Typically not used directly, but through `make_merger` builder function.
+     *
+     * @param inputs       Number of inputs.
+     * @param next         The arm the frames are forwarded to.
+     * @param options      Run-time configuration.
+     * @param timestamp_of Key of the timestamp policy.
+     */
+    Merger(std::size_t inputs, std::unique_ptr<Next<Payload>>&& next,
+           const MergerOptions& options = {}, TimestampOf timestamp_of = {})
+            : shared_{std::make_shared<Shared>(inputs, std::move(next), options,
+                                               std::move(timestamp_of))} {
+        assert(shared_->next);
+        assert(inputs > 0);
+        shared_->thread = std::jthread{[shared = shared_.get()](std::stop_token token) {
+            Consumer{*shared}.run(token);
+        }};
+    }
+
+    ~Merger() = default;
+
+    Merger(const Merger& other) = delete;
+    Merger& operator=(const Merger& other) = delete;
+
+    Merger(Merger&& other) = default;
+    Merger& operator=(Merger&& other) = default;
+
+    /**
+     * @brief Creates the element feeding the given input, to end a pipeline or an arm with.
+     *        Every input must be created at most once.
+     */
+    std::unique_ptr<MergerInput<Payload>> input(std::size_t index) const {
+        assert(shared_);
+        assert(index < shared_->inputs);
+        return std::unique_ptr<MergerInput<Payload>>{new MergerInput<Payload>{shared_, index}};
+    }
+
+    /**
+     * @brief Returns the number of inputs.
+     */
+    std::size_t inputs() const {
+        assert(shared_);
+        return shared_->inputs;
+    }
+
+    /**
+     * @brief Returns a snapshot of the metrics of the merger and of the elements of its arm.
+     *        Pipelines feeding the merger do not report them, since they share them.
+     */
+    PipelineMetrics metrics() const {
+        assert(shared_);
+        PipelineMetrics metrics;
+        shared_->metrics.collect(metrics, "Merger");
+        if constexpr (METRICS_ENABLED) {
+            // The depth recorded by the consumer misses the frames pushed since.
+            metrics.back().queue_depth = shared_->queue.size();
+        }
+        shared_->next->collect(metrics);
+        return metrics;
+    }
+
+private:
+    friend class MergerInput<Payload>;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Item {
+        // An empty frame marks the end of stream of the input.
+        std::optional<Frame<Payload>> frame;
+        std::size_t input;
+        std::chrono::nanoseconds timestamp;
+    };
+
+    // State shared between the inputs and the consumer thread.
+    struct Shared {
+        Shared(std::size_t inputs, std::unique_ptr<Next<Payload>>&& next,
+               const MergerOptions& options, TimestampOf&& timestamp_of)
+                : inputs{inputs}
+                , next{std::move(next)}
+                , queue{options.capacity}
+                , policy{options.policy}
+                , max_batch{options.max_batch < 1 ? 1 : options.max_batch}
+                , max_wait{options.max_wait}
+                , timestamp_of{std::move(timestamp_of)}
+                , not_empty{options.wait_strategy, options.spin_budget}
+                , finished{std::make_unique<std::atomic<bool>[]>(inputs)} {}
+
+        ~Shared() {
+            // The thread must be stopped before the arm it forwards frames to is destroyed.
+            thread = {};
+        }
+
+        // Enqueues an item, blocking while the queue is full. It may be called by any input.
+        void enqueue(Item&& item) {
+            if (queue.try_push_back(std::move(item))) {
+                return;
+            }
+            // Frames of the current batch may not have been notified yet.
+            not_empty.notify();
+            blocked.fetch_add(1);
+            // Pairs with the fence in `Consumer::release_room`: either the consumer sees this
+            // input blocked, or this input sees the room it made.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (true) {
+                const auto epoch = room.load(std::memory_order_acquire);
+                if (queue.try_push_back(std::move(item))) {
+                    break;
+                }
+                room.wait(epoch, std::memory_order_acquire);
+            }
+            blocked.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        const std::size_t inputs;
+        const std::unique_ptr<Next<Payload>> next;
+        MpscQueue<Item> queue;
+        const MergePolicy policy;
+        const std::size_t max_batch;
+        const std::chrono::microseconds max_wait;
+        const TimestampOf timestamp_of;
+        Waiter not_empty;
+        // Number of inputs blocked on a full queue, and the counter they wait on.
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> blocked{0};
+        std::atomic<uint32_t> room{0};
+        // Set by the consumer when the end of stream of an input has been handled.
+        const std::unique_ptr<std::atomic<bool>[]> finished;
+        // Only updated by the consumer.
+        [[no_unique_address]] impl::ElementMetrics<> metrics;
+        std::jthread thread;
+    };
+
+    // State of the consumer thread.
+    class Consumer {
+    public:
+        explicit Consumer(Shared& shared)
+                : shared_{shared}
+                , pending_(shared.inputs)
+                , ended_(shared.inputs, false) {
+            batch_.reserve(shared.max_batch);
+        }
+
+        void run(const std::stop_token& token) {
+            std::optional<Item> item;
+            auto ready = [&] {
+                item = shared_.queue.try_pop_front();
+                return item.has_value();
+            };
+            while (wait(ready, token)) {
+                const auto begin = shared_.metrics.now();
+                std::size_t popped = 0;
+                if (item.has_value()) {
+                    receive(std::move(*item));
+                    item.reset();
+                    popped += 1;
+                }
+                // Arrival order forwards frames as they come, while the other policies hold them
+                // back, so that the frames of every input are there to choose from.
+                auto more = [&] {
+                    return shared_.policy == MergePolicy::ArrivalOrder
+                                   ? popped < shared_.max_batch
+                                   : held_ < shared_.queue.capacity();
+                };
+                while (more() && ready()) {
+                    receive(std::move(*item));
+                    item.reset();
+                    popped += 1;
+                }
+                if (popped > 0) {
+                    release_room();
+                }
+                merge();
+                flush();
+                shared_.metrics.queue_depth(shared_.queue.size() + held_);
+                shared_.metrics.busy(begin);
+            }
+        }
+
+    private:
+        static constexpr std::chrono::microseconds POLL_PERIOD{50};
+
+        struct Held {
+            Item item;
+            Clock::time_point received;
+        };
+
+        // Waits for the next item or, when frames are held back by the timestamp policy, for the
+        // deadline of the oldest one.
+        template <typename Predicate>
+        bool wait(Predicate& ready, const std::stop_token& token) {
+            if (held_ == 0 || shared_.policy != MergePolicy::Timestamp) {
+                if (held_ > 0) {
+                    // More frames to forward in turn.
+                    return !token.stop_requested();
+                }
+                return shared_.not_empty.wait(ready, token);
+            }
+            // Items are polled for, since a parked thread cannot be woken up by the deadline.
+            const auto deadline = oldest_received() + shared_.max_wait;
+            while (!token.stop_requested()) {
+                if (ready()) {
+                    return true;
+                }
+                const auto now = Clock::now();
+                if (now >= deadline) {
+                    return true;
+                }
+                std::this_thread::sleep_for(std::min<Clock::duration>(deadline - now, POLL_PERIOD));
+            }
+            return false;
+        }
+
+        void receive(Item&& item) {
+            if (item.frame.has_value()) {
+                shared_.metrics.frames_in();
+            }
+            if (shared_.policy == MergePolicy::ArrivalOrder) {
+                if (item.frame.has_value()) {
+                    resume(item.input);
+                    forward(std::move(*item.frame));
+                } else {
+                    end_input(item.input);
+                }
+                return;
+            }
+            pending_[item.input].push_back(Held{std::move(item), Clock::now()});
+            held_ += 1;
+        }
+
+        // Wakes up the inputs blocked on a full queue, if any.
+        void release_room() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (shared_.blocked.load(std::memory_order_relaxed) > 0) {
+                shared_.room.fetch_add(1, std::memory_order_release);
+                shared_.room.notify_all();
+            }
+        }
+
+        // Forwards the frames held back, as allowed by the policy.
+        void merge() {
+            switch (shared_.policy) {
+                case MergePolicy::RoundRobin:
+                    merge_round_robin();
+                    break;
+                case MergePolicy::Timestamp:
+                    merge_by_timestamp();
+                    break;
+                case MergePolicy::ArrivalOrder:
+                    break;
+            }
+        }
+
+        void merge_round_robin() {
+            std::size_t forwarded = 0;
+            std::size_t skipped = 0;
+            while (forwarded < shared_.max_batch && skipped < shared_.inputs) {
+                const auto input = turn_;
+                turn_ = (turn_ + 1) % shared_.inputs;
+                end_inputs(input);
+                if (pending_[input].empty()) {
+                    skipped += 1;
+                    continue;
+                }
+                take(input);
+                forwarded += 1;
+                skipped = 0;
+            }
+        }
+
+        void merge_by_timestamp() {
+            for (std::size_t forwarded = 0; forwarded < shared_.max_batch; ++forwarded) {
+                std::optional<std::size_t> first;
+                bool complete = true;
+                for (std::size_t input = 0; input < shared_.inputs; ++input) {
+                    end_inputs(input);
+                    if (pending_[input].empty()) {
+                        complete = complete && ended_[input];
+                        continue;
+                    }
+                    if (!first.has_value()
+                        || pending_[input].front().item.timestamp
+                                   < pending_[*first].front().item.timestamp) {
+                        first = input;
+                    }
+                }
+                if (!first.has_value()) {
+                    return;
+                }
+                if (!complete && Clock::now() < oldest_received() + shared_.max_wait) {
+                    return;
+                }
+                take(*first);
+            }
+        }
+
+        // Handles the end of stream markers at the front of the frames held for the input.
+        void end_inputs(std::size_t input) {
+            auto& pending = pending_[input];
+            while (!pending.empty() && !pending.front().item.frame.has_value()) {
+                pending.pop_front();
+                held_ -= 1;
+                end_input(input);
+            }
+        }
+
+        void take(std::size_t input) {
+            auto& pending = pending_[input];
+            auto frame = std::move(*pending.front().item.frame);
+            pending.pop_front();
+            held_ -= 1;
+            resume(input);
+            forward(std::move(frame));
+        }
+
+        Clock::time_point oldest_received() const {
+            auto oldest = Clock::time_point::max();
+            for (const auto& pending : pending_) {
+                if (!pending.empty()) {
+                    oldest = std::min(oldest, pending.front().received);
+                }
+            }
+            return oldest;
+        }
+
+        // A frame following the end of stream of its input starts a new stream.
+        void resume(std::size_t input) {
+            if (ended_[input]) {
+                ended_[input] = false;
+                ended_count_ -= 1;
+            }
+        }
+
+        // The end of stream is propagated once every input has reached it. The input is
+        // acknowledged once its frames have been forwarded.
+        void end_input(std::size_t input) {
+            flush();
+            if (!ended_[input]) {
+                ended_[input] = true;
+                ended_count_ += 1;
+            }
+            if (ended_count_ == shared_.inputs) {
+                shared_.next->finish();
+                std::fill(ended_.begin(), ended_.end(), false);
+                ended_count_ = 0;
+            }
+            shared_.finished[input].store(true, std::memory_order_release);
+            shared_.finished[input].notify_all();
+        }
+
+        void forward(Frame<Payload>&& frame) {
+            batch_.push_back(std::move(frame));
+            if (batch_.size() >= shared_.max_batch) {
+                flush();
+            }
+        }
+
+        void flush() {
+            if (batch_.empty()) {
+                return;
+            }
+            shared_.metrics.frames_out(batch_.size());
+            if (batch_.size() == 1) {
+                shared_.next->push(std::move(batch_.front()));
+            } else {
+                shared_.next->push_batch(batch_);
+            }
+            batch_.clear();
+        }
+
+        Shared& shared_;
+        // Frames and end of stream markers held back, per input (round-robin and timestamp).
+        std::vector<std::deque<Held>> pending_;
+        std::size_t held_{0};
+        // Inputs that reached the end of the current stream.
+        std::vector<bool> ended_;
+        std::size_t ended_count_{0};
+        // Next input to take a frame from (round-robin).
+        std::size_t turn_{0};
+        std::vector<Frame<Payload>> batch_;
+    };
+
+    std::shared_ptr<Shared> shared_;
+};
+
+/**
+ * @brief An input of a Merger, pushing frames into the queue shared by all inputs.
+ *        Created through `Merger::input`.
+ *
+ * @tparam InputPayload_ The input data type.
+ */
+template <typename InputPayload_>
+class MergerInput : public Next<InputPayload_> {
+public:
+    using InputPayload = InputPayload_;
+    using OutputPayload = InputPayload;
+
+    ~MergerInput() = default;
+
+    MergerInput(const MergerInput& other) = delete;
+    MergerInput& operator=(const MergerInput& other) = delete;
+
+    MergerInput(MergerInput&& other) = default;
+    MergerInput& operator=(MergerInput&& other) = default;
+
+    void push(Frame<InputPayload>&& input) override {
+        assert(shared_);
+        enqueue(std::move(input));
+        shared_->not_empty.notify();
+    }
+
+    void push_batch(std::span<Frame<InputPayload>> inputs) override {
+        assert(shared_);
+        for (auto& input : inputs) {
+            enqueue(std::move(input));
+        }
+        shared_->not_empty.notify();
+    }
+
+    /**
+     * @brief Waits for the frames of the input to be forwarded. The last input to reach the end
+     *        of stream also waits for the end of stream to reach every sink of the arm.
+     */
+    void finish() override {
+        assert(shared_);
+        auto& shared = *shared_;
+        shared.enqueue(Item{std::nullopt, index_, {}});
+        shared.not_empty.notify();
+        shared.finished[index_].wait(false, std::memory_order_acquire);
+        // Ready for the next stream.
+        shared.finished[index_].store(false, std::memory_order_relaxed);
+    }
+
+private:
+    friend class Merger<InputPayload>;
+
+    using Shared = typename Merger<InputPayload>::Shared;
+    using Item = typename Merger<InputPayload>::Item;
+
+    MergerInput(std::shared_ptr<Shared> shared, std::size_t index)
+            : shared_{std::move(shared)}
+            , index_{index} {}
+
+    void enqueue(Frame<InputPayload>&& input) {
+        impl::share_frame(input);
+        auto& shared = *shared_;
+        std::chrono::nanoseconds timestamp{};
+        if (shared.policy == MergePolicy::Timestamp) {
+            timestamp = shared.timestamp_of ? shared.timestamp_of(*input)
+                                            : std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                      std::chrono::steady_clock::now()
+                                                              .time_since_epoch());
+        }
+        shared.enqueue(Item{std::move(input), index_, timestamp});
+    }
+
+    std::shared_ptr<Shared> shared_;
+    std::size_t index_;
+};
+
+} // namespace dpipe
+
+#endif // DPIPE_ELEMENTS_MERGER_H_
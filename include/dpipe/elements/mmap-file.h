@@ -0,0 +1,336 @@
+#ifndef DPIPE_ELEMENTS_MMAP_FILE_H_
+#define DPIPE_ELEMENTS_MMAP_FILE_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <dpipe/frame.h>
+
+namespace dpipe {
+
+namespace impl {
+
+/**
+ * @brief A memory mapping, unmapped on destruction.
+ */
+class FileMapping {
+public:
+    FileMapping(void* data, std::size_t size)
+            : data_{data}
+            , size_{size} {}
+
+    ~FileMapping() {
+        ::munmap(data_, size_);
+    }
+
+    FileMapping(const FileMapping& other) = delete;
+    FileMapping& operator=(const FileMapping& other) = delete;
+
+    FileMapping(FileMapping&& other) = delete;
+    FileMapping& operator=(FileMapping&& other) = delete;
+
+    std::byte* data() const {
+        return static_cast<std::byte*>(data_);
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+private:
+    void* data_;
+    std::size_t size_;
+};
+
+} // namespace impl
+
+/**
+ * @brief Run-time configuration of a MmapFileSource.
+ */
+struct MmapSourceOptions {
+    /// @brief Whether the whole file is read into the page cache and mapped upfront
+    ///        (`MAP_POPULATE`, Linux only), so that producing a frame never waits for a page fault.
+    bool populate{false};
+    /// @brief Whether the kernel is advised that records are read in order (`MADV_SEQUENTIAL`),
+    ///        so that it reads ahead more aggressively and reclaims the pages already read first.
+    bool sequential{true};
+    /// @brief Number of bytes to skip at the beginning of the file, _e.g._, a header.
+    ///        It must be a multiple of the alignment of the payload type.
+    std::size_t offset{0};
+};
+
+/**
+ * @brief A source implementation replaying a file of fixed-size records, which it maps into
+ *        memory, so that every frame points directly into the mapping instead of holding a copy.
+ *
+ * The mapping is kept alive as long as any frame points into it, even after the source is gone.
+ * It is private: payloads modified through a MutFrame are copied first, and never written back
+ * to the file. A trailing partial record is ignored.
+ *
+ * @tparam T The payload type, _i.e._, the record type. It must be trivially copyable.
+ */
+template <typename T>
+class MmapFileSource {
+public:
+    static_assert(std::is_trivially_copyable_v<T>, "records must be trivially copyable");
+
+    using OutputPayload = T;
+    using OutputFrame = Frame<OutputPayload>;
+
+    /**
+     * @brief Constructor. If the file cannot be mapped, the source is at the end of stream right
+     *        away, and `is_open` returns `false`.
+     *
+     * @param path    Path of the file.
+     * @param options Mapping options.
+     */
+    explicit MmapFileSource(const std::string& path, const MmapSourceOptions& options = {}) {
+        assert(options.offset % alignof(T) == 0);
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        struct stat status {};
+        if (::fstat(fd, &status) == 0 && status.st_size > 0) {
+            map(fd, static_cast<std::size_t>(status.st_size), options);
+        }
+        // The mapping outlives the file descriptor.
+        ::close(fd);
+    }
+
+    /**
+     * @brief Returns whether the file has been mapped.
+     */
+    bool is_open() const {
+        return mapping_ != nullptr;
+    }
+
+    /**
+     * @brief Returns the number of records in the file.
+     */
+    std::size_t size() const {
+        return count_;
+    }
+
+    std::optional<OutputFrame> produce() {
+        if (next_ >= count_) {
+            return {};
+        }
+        auto frame = OutputFrame::alias(mapping_, records_ + next_);
+        next_ += 1;
+        return frame;
+    }
+
+    bool end_of_stream() const {
+        return next_ >= count_;
+    }
+
+private:
+    void map(int fd, std::size_t size, const MmapSourceOptions& options) {
+        int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+        if (options.populate) {
+            flags |= MAP_POPULATE;
+        }
+#endif
+        // Mapped read-only first, as populating a writable private mapping would copy every page.
+        void* data = ::mmap(nullptr, size, PROT_READ, flags, fd, 0);
+        if (data == MAP_FAILED) {
+            return;
+        }
+        mapping_ = std::make_shared<impl::FileMapping>(data, size);
+        // Pages are copied on write only, e.g., by a MutFrame holding the last frame.
+        ::mprotect(data, size, PROT_READ | PROT_WRITE);
+        if (options.sequential) {
+            ::madvise(data, size, MADV_SEQUENTIAL);
+        }
+        if (size > options.offset) {
+            count_ = (size - options.offset) / sizeof(T);
+        }
+        records_ = reinterpret_cast<T*>(mapping_->data() + options.offset);
+    }
+
+    std::shared_ptr<impl::FileMapping> mapping_;
+    T* records_{};
+    std::size_t count_{};
+    std::size_t next_{};
+};
+
+/**
+ * @brief Run-time configuration of a MmapFileSink.
+ */
+struct MmapSinkOptions {
+    /// @brief Number of records the file is grown to when the first one is written. The file
+    ///        doubles in size whenever full, then it is truncated to the records written at the
+    ///        end of stream.
+    std::size_t initial_capacity{4096};
+    /// @brief Whether records are appended to the ones already in the file, rather than
+    ///        replacing them.
+    bool append{false};
+};
+
+/**
+ * @brief A sink implementation writing the payloads of incoming frames, as fixed-size records,
+ *        into a file that it maps into memory and grows as needed.
+ *
+ * Records reach the page cache as soon as they are consumed, and the file is truncated to the
+ * records written at the end of stream, or on destruction. Frames consumed while the file cannot
+ * be opened or grown are discarded.
+ *
+ * @tparam T The payload type, _i.e._, the record type. It must be trivially copyable.
+ */
+template <typename T>
+class MmapFileSink {
+public:
+    static_assert(std::is_trivially_copyable_v<T>, "records must be trivially copyable");
+
+    using InputPayload = T;
+    using InputFrame = Frame<InputPayload>;
+
+    /**
+     * @brief Constructor. If the file cannot be opened, `is_open` returns `false`.
+     *
+     * @param path    Path of the file, created if missing.
+     * @param options Writing options.
+     */
+    explicit MmapFileSink(const std::string& path, const MmapSinkOptions& options = {})
+            : initial_capacity_{std::max<std::size_t>(options.initial_capacity, 1)} {
+        const int flags = O_RDWR | O_CREAT | O_CLOEXEC | (options.append ? 0 : O_TRUNC);
+        fd_ = ::open(path.c_str(), flags, 0644);
+        struct stat status {};
+        if (fd_ >= 0 && options.append && ::fstat(fd_, &status) == 0) {
+            size_ = static_cast<std::size_t>(status.st_size) / sizeof(T);
+        }
+    }
+
+    ~MmapFileSink() {
+        close();
+    }
+
+    MmapFileSink(const MmapFileSink& other) = delete;
+    MmapFileSink& operator=(const MmapFileSink& other) = delete;
+
+    MmapFileSink(MmapFileSink&& other) noexcept
+            : initial_capacity_{other.initial_capacity_}
+            , fd_{std::exchange(other.fd_, -1)}
+            , data_{std::exchange(other.data_, nullptr)}
+            , capacity_{std::exchange(other.capacity_, 0)}
+            , size_{std::exchange(other.size_, 0)} {}
+
+    MmapFileSink& operator=(MmapFileSink&& other) noexcept {
+        if (this != &other) {
+            close();
+            initial_capacity_ = other.initial_capacity_;
+            fd_ = std::exchange(other.fd_, -1);
+            data_ = std::exchange(other.data_, nullptr);
+            capacity_ = std::exchange(other.capacity_, 0);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Returns whether the file has been opened.
+     */
+    bool is_open() const {
+        return fd_ >= 0;
+    }
+
+    /**
+     * @brief Returns the number of records in the file.
+     */
+    std::size_t size() const {
+        return size_;
+    }
+
+    void consume(InputFrame&& frame) {
+        if (reserve(size_ + 1)) {
+            data_[size_] = *frame;
+            size_ += 1;
+        }
+    }
+
+    void consume_batch(std::span<InputFrame> frames) {
+        if (!reserve(size_ + frames.size())) {
+            return;
+        }
+        for (const auto& frame : frames) {
+            data_[size_] = *frame;
+            size_ += 1;
+        }
+    }
+
+    /**
+     * @brief Unmaps the file and truncates it to the records written. Frames consumed afterwards
+     *        map it again.
+     */
+    void finish() {
+        unmap();
+    }
+
+private:
+    // Grows the file and its mapping to hold at least the given number of records.
+    bool reserve(std::size_t records) {
+        if (fd_ < 0) {
+            return false;
+        }
+        if (data_ != nullptr && records <= capacity_) {
+            return true;
+        }
+        const auto capacity = std::max({records, capacity_ * 2, initial_capacity_});
+        unmap();
+        const auto bytes = capacity * sizeof(T);
+        if (::ftruncate(fd_, static_cast<off_t>(bytes)) != 0) {
+            return false;
+        }
+        void* data = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        data_ = static_cast<T*>(data);
+        capacity_ = capacity;
+        return true;
+    }
+
+    void unmap() {
+        if (data_ != nullptr) {
+            ::munmap(data_, capacity_ * sizeof(T));
+            data_ = nullptr;
+            capacity_ = 0;
+        }
+        if (fd_ >= 0) {
+            [[maybe_unused]] const int result =
+                    ::ftruncate(fd_, static_cast<off_t>(size_ * sizeof(T)));
+        }
+    }
+
+    void close() {
+        unmap();
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    std::size_t initial_capacity_;
+    int fd_{-1};
+    T* data_{};
+    std::size_t capacity_{};
+    std::size_t size_{};
+};
+
+} // namespace dpipe
+
+#endif // DPIPE_ELEMENTS_MMAP_FILE_H_
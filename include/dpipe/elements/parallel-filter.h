@@ -0,0 +1,282 @@
+#ifndef DPIPE_ELEMENTS_PARALLEL_FILTER_H_
+#define DPIPE_ELEMENTS_PARALLEL_FILTER_H_
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include <dpipe/elements/interfaces.h>
+#include <dpipe/frame.h>
+#include <dpipe/metrics.h>
+#include <dpipe/utils/spsc-queue.h>
+#include <dpipe/utils/wait-strategy.h>
+
+namespace dpipe {
+
+/**
+ * @brief Run-time configuration of a ParallelFilter.
+ */
+struct ParallelOptions {
+    /// @brief Number of worker threads, each one running its own filter implementation.
+    std::size_t threads{2};
+    /// @brief Whether output frames keep the order of input frames.
+    ///        If not, frames are forwarded as soon as any worker is done with them.
+    bool ordered{true};
+    /// @brief Capacity of the input and output queues of each worker.
+    ///        In ordered mode, output queues make up the reorder buffer.
+    std::size_t capacity{64};
+    /// @brief How threads wait for frames or for room in the queues.
+    WaitStrategy wait_strategy{WaitStrategy::SpinPark};
+    /// @brief Number of checks before yielding or parking a waiting thread.
+    std::size_t spin_budget{256};
+};
+
+/**
+ * @brief A filter that runs multiple instances of a user-defined filter implementation on as many
+ *        worker threads.
+ *
+ * Input frames are dispatched to the workers, while output frames are forwarded to the next
+ * element by an internally-spawned collector thread.
+ * In ordered mode, frames are dispatched round-robin and collected in the same order, so that the
+ * output sequence matches the input sequence (frames discarded by a worker leave a gap that the
+ * collector skips). In unordered mode, frames are dispatched to any worker with room in its queue
+ * and collected from any worker with output available.
+ *
+ * @tparam Impl_ User-defined filter implementation (see Filter). It must define a `process`
+ *               function: implementations only defining `process_batch` are not supported.
+ */
+template <typename Impl_>
+class ParallelFilter : public Next<typename Impl_::InputPayload> {
+public:
+    // Workers keep one output slot per input frame, which a batch may not fill.
+    static_assert(impl::processes_frames<Impl_>,
+                  "ParallelFilter requires a filter implementation defining a process function, "
+                  "not only process_batch");
+
+    using Impl = Impl_;
+    using InputPayload = typename Impl::InputPayload;
+    using OutputPayload = typename Impl::OutputPayload;
+
+    /**
+     * @brief Constructor. Typically not used directly, but through `make_arm` or `make_pipe`
+     *        builder functions.
+     *
+     * @param next    The next element.
+     * @param factory A callable creating a filter implementation for every worker.
+     * @param options Run-time configuration.
+     */
+    template <typename Factory>
+    ParallelFilter(std::unique_ptr<Next<OutputPayload>>&& next, Factory& factory,
+                   const ParallelOptions& options = {})
+            : next_{std::move(next)}
+            , shared_{std::make_shared<Shared>(options)} {
+        assert(next_);
+        const auto threads = options.threads < 1 ? 1 : options.threads;
+        for (std::size_t i = 0; i < threads; ++i) {
+            shared_->workers.push_back(std::make_unique<Worker>(options, factory()));
+        }
+        start();
+    }
+
+    ~ParallelFilter() = default;
+
+    ParallelFilter(const ParallelFilter& other) = delete;
+    ParallelFilter& operator=(const ParallelFilter& other) = delete;
+
+    ParallelFilter(ParallelFilter&& other) = default;
+    ParallelFilter& operator=(ParallelFilter&& other) = default;
+
+    void push(Frame<InputPayload>&& input) override {
+        assert(shared_);
+        impl::share_frame(input);
+        dispatched_ += 1;
+        auto& workers = shared_->workers;
+        if (shared_->ordered) {
+            auto& worker = *workers[next_worker_];
+            next_worker_ = (next_worker_ + 1) % workers.size();
+            if (!worker.inputs.try_push_back(std::move(input))) {
+                worker.not_empty.notify();
+                auto pushed = [&] { return worker.inputs.try_push_back(std::move(input)); };
+                shared_->has_room.wait(pushed, std::stop_token{});
+            }
+            worker.not_empty.notify();
+            return;
+        }
+        auto pushed = [&] {
+            for (std::size_t i = 0; i < workers.size(); ++i) {
+                auto& worker = *workers[next_worker_];
+                next_worker_ = (next_worker_ + 1) % workers.size();
+                if (worker.inputs.try_push_back(std::move(input))) {
+                    worker.not_empty.notify();
+                    return true;
+                }
+            }
+            return false;
+        };
+        shared_->has_room.wait(pushed, std::stop_token{});
+    }
+
+    /**
+     * @brief Waits for the workers and the collector to be done with every dispatched frame, then
+     *        lets every filter implementation flush its state before propagating the end of stream.
+     */
+    void finish() override {
+        assert(shared_);
+        // The end of stream is rare, so a simple polling is enough.
+        while (shared_->completed.load(std::memory_order_acquire) < dispatched_) {
+            std::this_thread::yield();
+        }
+        // Worker and collector threads are idle, so their state can be accessed.
+        assert(next_);
+        for (auto& worker : shared_->workers) {
+            impl::finish_filter(worker->impl, [this](Frame<OutputPayload>&& output) {
+                next_->push(std::move(output));
+            });
+        }
+        next_->finish();
+    }
+
+    /**
+     * @brief Appends the metrics of every worker, then those of the following elements.
+     */
+    void collect(PipelineMetrics& metrics) const override {
+        assert(shared_);
+        for (const auto& worker : shared_->workers) {
+            worker->metrics.collect(metrics, "ParallelFilter");
+        }
+        assert(next_);
+        next_->collect(metrics);
+    }
+
+private:
+    // A worker thread, with its own filter implementation and queues.
+    struct Worker {
+        Worker(const ParallelOptions& options, Impl&& impl)
+                : inputs{options.capacity}
+                , outputs{options.capacity}
+                , impl{std::move(impl)}
+                , not_empty{options.wait_strategy, options.spin_budget}
+                , not_full{options.wait_strategy, options.spin_budget} {}
+
+        SpscQueue<Frame<InputPayload>> inputs;
+        // In ordered mode, discarded frames are kept as empty options.
+        SpscQueue<std::optional<Frame<OutputPayload>>> outputs;
+        Impl impl;
+        Waiter not_empty;
+        Waiter not_full;
+        // Updated by the worker thread only.
+        [[no_unique_address]] impl::ElementMetrics<> metrics;
+        std::jthread thread;
+    };
+
+    // State shared between the producer and the internally-spawned threads.
+    struct Shared {
+        explicit Shared(const ParallelOptions& options)
+                : ordered{options.ordered}
+                , has_room{options.wait_strategy, options.spin_budget}
+                , has_output{options.wait_strategy, options.spin_budget} {}
+
+        ~Shared() {
+            // Workers must be stopped before the collector, which may be waiting on them.
+            for (auto& worker : workers) {
+                worker->thread = {};
+            }
+            collector = {};
+        }
+
+        const bool ordered;
+        std::vector<std::unique_ptr<Worker>> workers;
+        // Number of dispatched frames either forwarded or discarded.
+        std::atomic<uint64_t> completed{0};
+        Waiter has_room;
+        Waiter has_output;
+        std::jthread collector;
+    };
+
+    void start() {
+        for (auto& worker : shared_->workers) {
+            worker->thread = std::jthread{[&worker = *worker, shared = shared_.get()](
+                                                  std::stop_token token) {
+                run_worker(worker, *shared, token);
+            }};
+        }
+        shared_->collector = std::jthread{[next = next_, shared = shared_.get()](
+                                                  std::stop_token token) {
+            run_collector(*next, *shared, token);
+        }};
+    }
+
+    static void run_worker(Worker& worker, Shared& shared, const std::stop_token& token) {
+        std::optional<Frame<InputPayload>> input;
+        auto ready = [&] {
+            input = worker.inputs.try_pop_front();
+            return input.has_value();
+        };
+        while (worker.not_empty.wait(ready, token)) {
+            shared.has_room.notify();
+            worker.metrics.frames_in();
+            const auto begin = worker.metrics.now();
+            auto output = impl::process_frame(worker.impl, std::move(*input));
+            worker.metrics.latency(begin);
+            worker.metrics.busy(begin);
+            if (output.has_value()) {
+                worker.metrics.frames_out();
+            } else {
+                worker.metrics.frames_dropped();
+                if (!shared.ordered) {
+                    shared.completed.fetch_add(1, std::memory_order_release);
+                    continue;
+                }
+            }
+            auto pushed = [&] { return worker.outputs.try_push_back(std::move(output)); };
+            if (!worker.not_full.wait(pushed, token)) {
+                return;
+            }
+            shared.has_output.notify();
+        }
+    }
+
+    static void run_collector(Next<OutputPayload>& next, Shared& shared,
+                              const std::stop_token& token) {
+        auto& workers = shared.workers;
+        std::size_t cursor = 0;
+        std::optional<std::optional<Frame<OutputPayload>>> output;
+        auto ready = [&] {
+            // In ordered mode, only the worker at the cursor is looked at.
+            const auto candidates = shared.ordered ? 1 : workers.size();
+            for (std::size_t i = 0; i < candidates; ++i) {
+                auto& worker = *workers[(cursor + i) % workers.size()];
+                output = worker.outputs.try_pop_front();
+                if (output.has_value()) {
+                    cursor = (cursor + i + 1) % workers.size();
+                    worker.not_full.notify();
+                    return true;
+                }
+            }
+            return false;
+        };
+        while (shared.has_output.wait(ready, token)) {
+            if (output->has_value()) {
+                next.push(std::move(**output));
+            }
+            shared.completed.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    // The reference to `Next` is stored as a shared pointer to allow its use in
+    // the internally-spawned threads. Though, it is not meant to be shared outside of this class.
+    std::shared_ptr<Next<OutputPayload>> next_;
+    std::shared_ptr<Shared> shared_;
+    std::size_t next_worker_{0};
+    uint64_t dispatched_{0};
+};
+
+} // namespace dpipe
+
+#endif // DPIPE_ELEMENTS_PARALLEL_FILTER_H_
@@ -1,14 +1,43 @@
 #ifndef DPIPE_ELEMENTS_PIPELINE_H_
 #define DPIPE_ELEMENTS_PIPELINE_H_
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstddef>
 #include <memory>
 #include <thread>
+#include <utility>
 
 #include <dpipe/elements/interfaces.h>
+#include <dpipe/metrics.h>
+#include <dpipe/utils/executor.h>
+#include <dpipe/utils/thread-options.h>
 
 namespace dpipe {
 
+/**
+ * @brief Run-time configuration of a Pipeline.
+ */
+struct PipelineOptions {
+    /// @brief Number of consecutive idle polls of the source, each one followed by a yield, before
+    ///        the pipeline starts sleeping between polls.
+    std::size_t idle_spins{64};
+    /// @brief First sleep between idle polls. It doubles at every further idle poll.
+    std::chrono::microseconds idle_min_sleep{10};
+    /// @brief Maximum sleep between idle polls.
+    std::chrono::microseconds idle_max_sleep{1000};
+    /// @brief Executor running the source as a series of tasks. If not set, the pipeline spawns
+    ///        its own thread. Instead of sleeping between idle polls, the task of an idle source
+    ///        is posted again for the time the sleep would have elapsed (see `Executor::post_at`),
+    ///        so that no thread of the executor is held meanwhile.
+    std::shared_ptr<Executor> executor{};
+    /// @brief Options of the thread spawned by the pipeline, if any. Frames produced by a source
+    ///        pinned to a NUMA node are allocated on that node.
+    ThreadOptions thread{};
+};
+
 /**
  * @brief The pipeline, _i.e._, the object that makes the data flow happen.
  */
@@ -23,40 +52,284 @@ public:
         assert(entry_);
     }
 
-    ~Pipeline() = default;
+    ~Pipeline() {
+        stop();
+    }
 
     Pipeline(const Pipeline& other) = delete;
     Pipeline& operator=(const Pipeline& other) = delete;
 
     Pipeline(Pipeline&& other) = default;
-    Pipeline& operator=(Pipeline&& other) = default;
+    Pipeline& operator=(Pipeline&& other) {
+        if (this != &other) {
+            stop();
+            entry_ = std::move(other.entry_);
+            thread_ = std::move(other.thread_);
+            executor_ = std::move(other.executor_);
+            task_ = std::move(other.task_);
+            control_ = std::move(other.control_);
+            detached_ = std::exchange(other.detached_, false);
+        }
+        return *this;
+    }
 
     /**
-     * @brief Starts the data flow.
+     * @brief Starts the data flow, which runs until the source reaches the end of stream or the
+     *        pipeline is stopped.
      *        It is safe to start multiple times, though data processing is stopped and restarted at
      *        every call.
      */
-    void start() {
+    void start(const PipelineOptions& options = {}) {
         assert(entry_);
-        thread_ = std::jthread{[entry = entry_](std::stop_token token) {
+        stop();
+        control_ = std::make_shared<Control>(options);
+        detached_ = entry_->start([control = control_] {
+            control->finished.store(true);
+            control->finished.notify_all();
+        });
+        if (detached_) {
+            // The source runs on its own, _e.g._, on an event loop.
+            return;
+        }
+        if (options.executor) {
+            // Tasks only refer to the executor, so that the pipeline is the one keeping it alive.
+            executor_ = options.executor;
+            task_ = std::make_shared<Task>(entry_, control_, *executor_);
+            Task::schedule(task_);
+            return;
+        }
+        thread_ = std::jthread{[entry = entry_, control = control_,
+                                thread = options.thread](std::stop_token token) {
+            apply_thread_options(thread);
             while (!token.stop_requested()) {
-                entry->push();
+                const auto status = step(*entry, *control);
+                if (status == SourceStatus::EndOfStream) {
+                    break;
+                }
+                if (status == SourceStatus::Idle) {
+                    const auto backoff = control->idle();
+                    if (backoff.count() == 0) {
+                        std::this_thread::yield();
+                    } else {
+                        std::this_thread::sleep_for(backoff);
+                    }
+                }
             }
         }};
     }
 
+    /**
+     * @brief Starts the data flow, running the source as a series of tasks on an executor instead
+     *        of a dedicated thread.
+     *        It is safe to start multiple times, though data processing is stopped and restarted at
+     *        every call.
+     */
+    void start(std::shared_ptr<Executor> executor) {
+        assert(executor);
+        start(PipelineOptions{.executor = std::move(executor)});
+    }
+
     /**
      * @brief Stops the data flow. The call blocks.
+     *        Frames still queued in decouplers are not waited for (see `drain`).
      */
     void stop() {
+        // A moved-from pipeline has no entry left.
+        if (std::exchange(detached_, false) && entry_) {
+            entry_->stop(false);
+        }
         thread_ = {};
+        if (task_) {
+            task_->stop_requested.store(true);
+            Task::wake(task_);
+            task_->done.wait(false);
+            task_.reset();
+        }
+        executor_.reset();
+        control_.reset();
+    }
+
+    /**
+     * @brief Waits for the source to reach the end of stream and for every queued frame to reach
+     *        its sink, then stops the data flow. It returns immediately if the data flow is not
+     *        running.
+     */
+    void wait() {
+        if (control_) {
+            control_->finished.wait(false);
+        }
+        stop();
+    }
+
+    /**
+     * @brief Stops the source, as if it reached the end of stream, then waits for every queued
+     *        frame to reach its sink.
+     *        If the data flow is not running, the end of stream is propagated from the calling
+     *        thread.
+     */
+    void drain() {
+        if (!control_) {
+            assert(entry_);
+            entry_->finish();
+            return;
+        }
+        if (detached_) {
+            entry_->stop(true);
+        }
+        control_->drain_requested.store(true);
+        if (task_) {
+            Task::wake(task_);
+        }
+        wait();
+    }
+
+    /**
+     * @brief Returns a snapshot of the metrics of all the elements, in depth-first order from the
+     *        source. It can be called while the data flow is running.
+     *        The result is empty unless `DPIPE_ENABLE_METRICS` is defined to 1.
+     */
+    PipelineMetrics metrics() const {
+        assert(entry_);
+        PipelineMetrics metrics;
+        entry_->collect(metrics);
+        return metrics;
     }
 
 private:
+    // State of a run of the data flow, shared with the thread or tasks running the source.
+    struct Control {
+        explicit Control(const PipelineOptions& options)
+                : idle_spins{options.idle_spins}
+                , idle_min_sleep{options.idle_min_sleep}
+                , idle_max_sleep{options.idle_max_sleep}
+                , idle_sleep{options.idle_min_sleep} {}
+
+        // Called after every poll of the source that produced no frame. Returns how long to wait
+        // before polling it again, zero meaning only a yield.
+        std::chrono::microseconds idle() {
+            if (idle_polls < idle_spins) {
+                idle_polls += 1;
+                return {};
+            }
+            const auto backoff = idle_sleep;
+            idle_sleep = std::min(idle_sleep * 2, idle_max_sleep);
+            return backoff;
+        }
+
+        void busy() {
+            idle_polls = 0;
+            idle_sleep = idle_min_sleep;
+        }
+
+        const std::size_t idle_spins;
+        const std::chrono::microseconds idle_min_sleep;
+        const std::chrono::microseconds idle_max_sleep;
+        // Only accessed by the thread or task running the source.
+        std::size_t idle_polls{0};
+        std::chrono::microseconds idle_sleep;
+        std::atomic<bool> drain_requested{false};
+        std::atomic<bool> finished{false};
+    };
+
+    // Polls the source once, leaving the backoff to the caller if idle. The end of stream, either
+    // reached or requested by `drain`, is propagated before returning.
+    static SourceStatus step(Entry& entry, Control& control) {
+        if (!control.drain_requested.load(std::memory_order_relaxed)) {
+            const auto status = entry.push();
+            switch (status) {
+                case SourceStatus::Produced:
+                    control.busy();
+                    return status;
+                case SourceStatus::Idle:
+                    return status;
+                case SourceStatus::EndOfStream:
+                    break;
+            }
+        }
+        entry.finish();
+        control.finished.store(true);
+        control.finished.notify_all();
+        return SourceStatus::EndOfStream;
+    }
+
+    // The source running on an executor. Each task pushes a few frames, then reschedules itself.
+    struct Task {
+        Task(std::shared_ptr<Entry> entry, std::shared_ptr<Control> control, Executor& executor)
+                : entry{std::move(entry)}
+                , control{std::move(control)}
+                , executor{executor} {}
+
+        static void schedule(const std::shared_ptr<Task>& task) {
+            task->executor.post([task] { run(task); });
+        }
+
+        static void run(const std::shared_ptr<Task>& task) {
+            static constexpr int PUSHES_PER_TASK = 64;
+            for (int i = 0; i < PUSHES_PER_TASK; ++i) {
+                const auto status = task->stop_requested.load(std::memory_order_relaxed)
+                                            ? SourceStatus::EndOfStream
+                                            : step(*task->entry, *task->control);
+                if (status == SourceStatus::EndOfStream) {
+                    task->done.store(true);
+                    task->done.notify_all();
+                    return;
+                }
+                if (status == SourceStatus::Idle) {
+                    const auto backoff = task->control->idle();
+                    if (backoff.count() > 0) {
+                        sleep(task, backoff);
+                        return;
+                    }
+                    // Let other tasks run before polling again.
+                    break;
+                }
+            }
+            schedule(task);
+        }
+
+        // Runs the task again once the backoff has elapsed, or once woken up, whichever is first.
+        static void sleep(const std::shared_ptr<Task>& task, std::chrono::microseconds backoff) {
+            task->sleeping.store(true);
+            // Pairs with `wake`: either it sees the task sleeping, or the task sees the request.
+            if (task->stop_requested.load() || task->control->drain_requested.load()) {
+                wake(task);
+                return;
+            }
+            // The timer does not keep the pipeline alive, as it may fire long after it stopped.
+            task->executor.post_at(Executor::Clock::now() + backoff,
+                                   [weak = std::weak_ptr<Task>{task}] {
+                                       const auto task = weak.lock();
+                                       if (task && task->sleeping.exchange(false)) {
+                                           run(task);
+                                       }
+                                   });
+        }
+
+        // Runs a sleeping task right away, _e.g._, to stop it.
+        static void wake(const std::shared_ptr<Task>& task) {
+            if (task->sleeping.exchange(false)) {
+                schedule(task);
+            }
+        }
+
+        const std::shared_ptr<Entry> entry;
+        const std::shared_ptr<Control> control;
+        Executor& executor;
+        // Set while waiting for the backoff of an idle source, cleared by whoever runs it next.
+        std::atomic<bool> sleeping{false};
+        std::atomic<bool> stop_requested{false};
+        std::atomic<bool> done{false};
+    };
+
     // The reference to `Entry` is stored as a shared pointer to allow its use in
     // the internally-spawned thread. Though, it is not meant to be shared outside of this class.
     std::shared_ptr<Entry> entry_;
     std::jthread thread_;
+    std::shared_ptr<Executor> executor_;
+    std::shared_ptr<Task> task_;
+    std::shared_ptr<Control> control_;
+    // Whether the source has been started on its own, rather than polled.
+    bool detached_{false};
 };
 
 } // namespace dpipe
@@ -0,0 +1,577 @@
+#ifndef DPIPE_ELEMENTS_SHARED_MEMORY_H_
+#define DPIPE_ELEMENTS_SHARED_MEMORY_H_
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
+#include <dpipe/frame.h>
+#include <dpipe/utils/hardware.h>
+
+namespace dpipe {
+
+namespace impl {
+
+using ShmClock = std::chrono::steady_clock;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free &&
+                      std::atomic<uint64_t>::is_always_lock_free,
+              "shared-memory rings need address-free atomics");
+
+/**
+ * @brief A word two processes wait on and notify each other through, with a flag telling whether
+ *        the waiting one is parked, so that notifications only cost a system call when it is.
+ */
+struct ShmWaitWord {
+    std::atomic<uint32_t> epoch{0};
+    std::atomic<uint32_t> parked{0};
+};
+
+// Blocks until the epoch differs from the expected one, the timeout expires or a spurious wakeup.
+inline void futex_wait(std::atomic<uint32_t>& word, uint32_t expected,
+                       std::chrono::nanoseconds timeout) {
+#if defined(__linux__)
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+    timespec relative{};
+    relative.tv_sec = static_cast<time_t>(seconds.count());
+    relative.tv_nsec = static_cast<long>((timeout - seconds).count());
+    // Not FUTEX_WAIT_PRIVATE: the word is shared with another process.
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &relative,
+              nullptr, 0);
+#else
+    // Without futexes, the waiting process polls the word.
+    if (word.load(std::memory_order_acquire) == expected) {
+        std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(
+                timeout, std::chrono::microseconds{50}));
+    }
+#endif
+}
+
+inline void futex_wake(std::atomic<uint32_t>& word) {
+#if defined(__linux__)
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#else
+    static_cast<void>(word);
+#endif
+}
+
+/**
+ * @brief Waits until `ready()` returns `true`, spinning first, then parking on the word,
+ *        or until the deadline.
+ *
+ * @return Whether the condition holds.
+ */
+template <typename Predicate>
+bool shm_wait(ShmWaitWord& word, Predicate&& ready, std::size_t spin_budget,
+              ShmClock::time_point deadline) {
+    for (std::size_t spins = 0; spins < spin_budget; ++spins) {
+        if (ready()) {
+            return true;
+        }
+        cpu_relax();
+    }
+    for (auto now = ShmClock::now(); now < deadline; now = ShmClock::now()) {
+        const auto epoch = word.epoch.load(std::memory_order_acquire);
+        word.parked.store(1, std::memory_order_relaxed);
+        // Pairs with the fence in `shm_notify`: either this process sees the condition,
+        // or the other one sees it parked.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ready()) {
+            word.parked.store(0, std::memory_order_relaxed);
+            return true;
+        }
+        futex_wait(word.epoch, epoch, deadline - now);
+        word.parked.store(0, std::memory_order_relaxed);
+    }
+    return ready();
+}
+
+/**
+ * @brief Wakes up the process waiting on the word, if parked.
+ *        It must be called after making its condition true.
+ */
+inline void shm_notify(ShmWaitWord& word) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (word.parked.load(std::memory_order_relaxed) != 0) {
+        word.epoch.fetch_add(1, std::memory_order_release);
+        futex_wake(word.epoch);
+    }
+}
+
+// Returns whether a process has exited. Unknown processes (0) are deemed alive.
+inline bool process_exited(int32_t pid) {
+    return pid != 0 && ::kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH;
+}
+
+/**
+ * @brief The header of a shared-memory ring, followed by its slots.
+ *
+ * Each side owns its index and the word it is woken up through, on a cache line of its own.
+ */
+struct ShmRingHeader {
+    static constexpr uint32_t MAGIC = 0x64706970; // "dpip"
+
+    struct alignas(CACHE_LINE_SIZE) Side {
+        std::atomic<uint64_t> index{0};
+        std::atomic<int32_t> pid{0};
+        // Set once the side is done: the end of stream for the producer, detaching for the
+        // consumer.
+        std::atomic<uint32_t> closed{0};
+        ShmWaitWord wakeup{};
+    };
+
+    // Written last by the producer, once the header is initialized.
+    std::atomic<uint32_t> magic{0};
+    uint32_t record_size{};
+    uint32_t record_alignment{};
+    uint64_t capacity{};
+    Side producer{};
+    Side consumer{};
+};
+
+/**
+ * @brief A shared-memory object mapped into the address space of the process, unmapped on
+ *        destruction.
+ */
+class ShmSegment {
+public:
+    ShmSegment(void* data, std::size_t size)
+            : data_{data}
+            , size_{size} {}
+
+    ~ShmSegment() {
+        ::munmap(data_, size_);
+    }
+
+    ShmSegment(const ShmSegment& other) = delete;
+    ShmSegment& operator=(const ShmSegment& other) = delete;
+
+    ShmSegment(ShmSegment&& other) = delete;
+    ShmSegment& operator=(ShmSegment&& other) = delete;
+
+    ShmRingHeader& header() const {
+        return *static_cast<ShmRingHeader*>(data_);
+    }
+
+    template <typename T>
+    T* slots() const {
+        return reinterpret_cast<T*>(static_cast<std::byte*>(data_) + slots_offset<T>());
+    }
+
+    template <typename T>
+    static constexpr std::size_t slots_offset() {
+        constexpr auto alignment = std::max(alignof(T), CACHE_LINE_SIZE);
+        return (sizeof(ShmRingHeader) + alignment - 1) / alignment * alignment;
+    }
+
+private:
+    void* data_;
+    std::size_t size_;
+};
+
+// POSIX requires names of shared-memory objects to begin with a slash.
+inline std::string shm_object_name(const std::string& name) {
+    return name.starts_with('/') ? name : "/" + name;
+}
+
+} // namespace impl
+
+/**
+ * @brief Run-time configuration of a ShmSink.
+ */
+struct ShmSinkOptions {
+    /// @brief Number of records the ring holds. It is rounded up to the next power of two.
+    std::size_t capacity{1024};
+    /// @brief Number of checks before parking, while the ring is full.
+    std::size_t spin_budget{256};
+};
+
+/**
+ * @brief A sink implementation writing the payloads of incoming frames into a named
+ *        shared-memory ring, read by a ShmSource in another process, so that a pipeline is split
+ *        across processes, _e.g._, for crash containment.
+ *
+ * The sink creates the ring, replacing any stale one with the same name. Frames cross the
+ * process boundary with a single copy into the ring, and without any system call, unless the
+ * other process is parked waiting for them (on a futex, on Linux). The sink blocks while the ring
+ * is full, until the source frees a slot, detaches or exits. Frames consumed while the ring cannot
+ * be created, while it is full before any source attached, or once the source is gone, are
+ * discarded.
+ * The end of stream is forwarded to the source. The name is removed once a source attaches,
+ * or when the sink is destroyed.
+ *
+ * @tparam T The payload type. It must be trivially copyable.
+ */
+template <typename T>
+class ShmSink {
+public:
+    static_assert(std::is_trivially_copyable_v<T>, "payloads must be trivially copyable");
+
+    using InputPayload = T;
+    using InputFrame = Frame<InputPayload>;
+
+    /**
+     * @brief Constructor. If the ring cannot be created, `is_open` returns `false`.
+     *
+     * @param name    Name of the shared-memory object, _e.g._, "/camera-0".
+     * @param options Ring options.
+     */
+    explicit ShmSink(const std::string& name, const ShmSinkOptions& options = {})
+            : name_{impl::shm_object_name(name)}
+            , spin_budget_{options.spin_budget} {
+        const auto capacity = std::bit_ceil(std::max<std::size_t>(options.capacity, 2));
+        const auto size = impl::ShmSegment::slots_offset<T>() + capacity * sizeof(T);
+        ::shm_unlink(name_.c_str());
+        const int fd = ::shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0) {
+            return;
+        }
+        void* data = MAP_FAILED;
+        if (::ftruncate(fd, static_cast<off_t>(size)) == 0) {
+            data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            ::shm_unlink(name_.c_str());
+            return;
+        }
+        segment_ = std::make_unique<impl::ShmSegment>(data, size);
+        auto* header = new (data) impl::ShmRingHeader{};
+        header->record_size = sizeof(T);
+        header->record_alignment = alignof(T);
+        header->capacity = capacity;
+        header->producer.pid.store(static_cast<int32_t>(::getpid()), std::memory_order_relaxed);
+        header->magic.store(impl::ShmRingHeader::MAGIC, std::memory_order_release);
+        slots_ = segment_->slots<T>();
+        mask_ = capacity - 1;
+    }
+
+    ~ShmSink() {
+        if (segment_) {
+            finish();
+            ::shm_unlink(name_.c_str());
+        }
+    }
+
+    ShmSink(const ShmSink& other) = delete;
+    ShmSink& operator=(const ShmSink& other) = delete;
+
+    ShmSink(ShmSink&& other) noexcept = default;
+    ShmSink& operator=(ShmSink&& other) = delete;
+
+    /**
+     * @brief Returns whether the ring has been created.
+     */
+    bool is_open() const {
+        return segment_ != nullptr;
+    }
+
+    /**
+     * @brief Returns whether a source has attached to the ring.
+     */
+    bool is_attached() const {
+        return segment_ && segment_->header().consumer.pid.load(std::memory_order_relaxed) != 0;
+    }
+
+    /**
+     * @brief Returns the number of frames discarded because no source was there to free slots.
+     */
+    std::size_t discarded() const {
+        return discarded_;
+    }
+
+    void consume(InputFrame&& frame) {
+        write(std::span<InputFrame>{&frame, 1});
+    }
+
+    void consume_batch(std::span<InputFrame> frames) {
+        write(frames);
+    }
+
+    /**
+     * @brief Forwards the end of stream to the source.
+     */
+    void finish() {
+        if (!segment_) {
+            return;
+        }
+        auto& header = segment_->header();
+        header.producer.closed.store(1, std::memory_order_release);
+        impl::shm_notify(header.consumer.wakeup);
+    }
+
+private:
+    // Copies the payloads into the ring, publishing as many as fit at once.
+    void write(std::span<InputFrame> frames) {
+        if (!segment_) {
+            discarded_ += frames.size();
+            return;
+        }
+        auto& header = segment_->header();
+        auto tail = header.producer.index.load(std::memory_order_relaxed);
+        while (!frames.empty()) {
+            if (!wait_for_space(tail)) {
+                discarded_ += frames.size();
+                return;
+            }
+            const auto count = std::min<std::size_t>(frames.size(), mask_ + 1 - (tail - head_));
+            for (std::size_t i = 0; i < count; ++i) {
+                slots_[(tail + i) & mask_] = *frames[i];
+            }
+            tail += count;
+            header.producer.index.store(tail, std::memory_order_release);
+            impl::shm_notify(header.consumer.wakeup);
+            frames = frames.subspan(count);
+        }
+    }
+
+    // Waits for a free slot. Returns `false` if the source is gone, or has not attached yet.
+    bool wait_for_space(uint64_t tail) {
+        if (tail - head_ <= mask_) {
+            return true;
+        }
+        if (!is_attached()) {
+            // Nothing frees slots meanwhile, and the pipeline could not be stopped.
+            return false;
+        }
+        auto& header = segment_->header();
+        const auto closed = [&] {
+            return header.consumer.closed.load(std::memory_order_acquire) != 0;
+        };
+        const auto has_space = [&] {
+            head_ = header.consumer.index.load(std::memory_order_acquire);
+            return tail - head_ <= mask_ || closed();
+        };
+        // The source is checked for liveness at every timeout, in case it crashed.
+        while (!impl::shm_wait(header.producer.wakeup, has_space, spin_budget_,
+                               impl::ShmClock::now() + std::chrono::milliseconds{100})) {
+            if (impl::process_exited(header.consumer.pid.load(std::memory_order_relaxed))) {
+                header.consumer.closed.store(1, std::memory_order_release);
+            }
+        }
+        return !closed();
+    }
+
+    std::string name_;
+    std::size_t spin_budget_;
+    std::unique_ptr<impl::ShmSegment> segment_{};
+    T* slots_{};
+    uint64_t mask_{};
+    // Cached copy of the consumer index.
+    uint64_t head_{0};
+    std::size_t discarded_{0};
+};
+
+/**
+ * @brief Run-time configuration of a ShmSource.
+ */
+struct ShmSourceOptions {
+    /// @brief Number of checks before parking, while the ring is empty.
+    std::size_t spin_budget{256};
+    /// @brief Maximum time `produce` waits for a frame before returning none, so that the
+    ///        pipeline can be stopped while the sink is idle.
+    std::chrono::microseconds idle_timeout{10000};
+};
+
+/**
+ * @brief A source implementation reading the frames written by a ShmSink in another process into
+ *        a named shared-memory ring.
+ *
+ * Frames point directly into the ring, without any copy, and each slot is handed back to the sink
+ * once the last frame referring to it is released; frames may be released in any order, but
+ * holding any of them for long stalls the sink once the ring is full. Frames modified through a
+ * MutFrame are modified in place, if unique.
+ * The source is idle until the sink has created the ring, and reaches the end of stream once every
+ * frame written before the sink reached it, or exited, has been produced.
+ *
+ * @tparam T The payload type. It must be trivially copyable and match the one of the sink.
+ */
+template <typename T>
+class ShmSource {
+public:
+    static_assert(std::is_trivially_copyable_v<T>, "payloads must be trivially copyable");
+
+    using OutputPayload = T;
+    using OutputFrame = Frame<OutputPayload>;
+
+    /**
+     * @brief Constructor. The source attaches to the ring, if already created by the sink,
+     *        otherwise it tries again whenever it is polled.
+     *
+     * @param name    Name of the shared-memory object, the same given to the sink.
+     * @param options Reading options.
+     */
+    explicit ShmSource(const std::string& name, const ShmSourceOptions& options = {})
+            : name_{impl::shm_object_name(name)}
+            , options_{options} {
+        attach();
+    }
+
+    ~ShmSource() {
+        if (leases_) {
+            // Frames still alive keep the ring mapped, but the sink stops writing into it.
+            auto& header = leases_->segment->header();
+            header.consumer.closed.store(1, std::memory_order_release);
+            impl::shm_notify(header.producer.wakeup);
+        }
+    }
+
+    ShmSource(const ShmSource& other) = delete;
+    ShmSource& operator=(const ShmSource& other) = delete;
+
+    ShmSource(ShmSource&& other) noexcept = default;
+    ShmSource& operator=(ShmSource&& other) = delete;
+
+    /**
+     * @brief Returns whether the source has attached to the ring.
+     */
+    bool is_open() const {
+        return leases_ != nullptr;
+    }
+
+    std::optional<OutputFrame> produce() {
+        if (!leases_ && !attach()) {
+            return {};
+        }
+        auto& header = leases_->segment->header();
+        const auto has_frames = [&] {
+            tail_ = header.producer.index.load(std::memory_order_acquire);
+            return next_ != tail_ || header.producer.closed.load(std::memory_order_acquire);
+        };
+        if (next_ == tail_ &&
+            !impl::shm_wait(header.consumer.wakeup, has_frames, options_.spin_budget,
+                            impl::ShmClock::now() + options_.idle_timeout)) {
+            if (impl::process_exited(header.producer.pid.load(std::memory_order_relaxed))) {
+                producer_exited_ = true;
+            }
+            return {};
+        }
+        if (next_ == tail_) {
+            return {};
+        }
+        auto* record = leases_->segment->template slots<T>() + (next_ & leases_->mask);
+        auto frame = OutputFrame::adopt(record, Release{leases_, next_});
+        next_ += 1;
+        return frame;
+    }
+
+    bool end_of_stream() const {
+        if (!leases_) {
+            return false;
+        }
+        const auto& producer = leases_->segment->header().producer;
+        // The index is read after the flag, so that no frame written before it is missed.
+        const bool closed = producer.closed.load(std::memory_order_acquire) != 0;
+        return (closed || producer_exited_) &&
+               next_ == producer.index.load(std::memory_order_acquire);
+    }
+
+private:
+    // State shared by the source and the frames it produced, handing slots back to the sink
+    // in order, whatever the order frames are released in.
+    struct Leases {
+        std::shared_ptr<impl::ShmSegment> segment;
+        uint64_t mask;
+        std::mutex mutex{};
+        std::vector<bool> released{};
+        uint64_t head{0};
+
+        void release(uint64_t index) {
+            std::lock_guard<std::mutex> lock{mutex};
+            released[index & mask] = true;
+            const auto previous = head;
+            while (released[head & mask]) {
+                released[head & mask] = false;
+                head += 1;
+            }
+            if (head != previous) {
+                auto& header = segment->header();
+                header.consumer.index.store(head, std::memory_order_release);
+                impl::shm_notify(header.producer.wakeup);
+            }
+        }
+    };
+
+    // Hands the slot of a frame back once the last reference to it is dropped.
+    struct Release {
+        std::shared_ptr<Leases> leases;
+        uint64_t index;
+
+        void operator()(T* /*record*/) const {
+            leases->release(index);
+        }
+    };
+
+    // Maps the ring, once created and initialized by the sink.
+    bool attach() {
+        const int fd = ::shm_open(name_.c_str(), O_RDWR, 0600);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat status {};
+        void* data = MAP_FAILED;
+        const auto size = static_cast<std::size_t>(::fstat(fd, &status) == 0 ? status.st_size : 0);
+        if (size >= impl::ShmSegment::slots_offset<T>()) {
+            data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        auto segment = std::make_shared<impl::ShmSegment>(data, size);
+        auto& header = segment->header();
+        if (header.magic.load(std::memory_order_acquire) != impl::ShmRingHeader::MAGIC) {
+            return false;
+        }
+        if (header.record_size != sizeof(T) || header.record_alignment != alignof(T) ||
+            size < impl::ShmSegment::slots_offset<T>() + header.capacity * sizeof(T)) {
+            return false;
+        }
+        // Later sources cannot attach to the same ring.
+        ::shm_unlink(name_.c_str());
+        header.consumer.pid.store(static_cast<int32_t>(::getpid()), std::memory_order_relaxed);
+        const auto capacity = static_cast<std::size_t>(header.capacity);
+        leases_ = std::make_shared<Leases>(std::move(segment), capacity - 1);
+        leases_->released.resize(capacity, false);
+        return true;
+    }
+
+    std::string name_;
+    ShmSourceOptions options_;
+    std::shared_ptr<Leases> leases_{};
+    // Index of the next frame to produce, and cached copy of the producer index.
+    uint64_t next_{0};
+    uint64_t tail_{0};
+    bool producer_exited_{false};
+};
+
+} // namespace dpipe
+
+#endif // DPIPE_ELEMENTS_SHARED_MEMORY_H_
@@ -0,0 +1,182 @@
+#ifndef DPIPE_ELEMENTS_SHEDDING_H_
+#define DPIPE_ELEMENTS_SHEDDING_H_
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <dpipe/elements/decoupler.h>
+#include <dpipe/frame-header.h>
+#include <dpipe/frame.h>
+
+namespace dpipe {
+
+/**
+ * @brief A shedding policy discarding the frames older than a budget, measured from their creation
+ *        by the source, so that the same budget set at several points of a pipeline acts as an
+ *        end-to-end deadline. It requires frame headers to be enabled (see
+ *        `DPIPE_ENABLE_FRAME_HEADERS`): frames without a stamped header are never discarded.
+ */
+class DeadlineShedding {
+public:
+    template <typename Rep, typename Period>
+    explicit DeadlineShedding(std::chrono::duration<Rep, Period> budget)
+            : budget_{budget} {
+        // Dependent on the budget type, so that it only fails when the policy is used, rather
+        // than wherever this header is included.
+        static_assert(FRAME_HEADERS_ENABLED && sizeof(Rep) > 0,
+                      "DeadlineShedding requires DPIPE_ENABLE_FRAME_HEADERS");
+    }
+
+    bool shed(const FrameHeader& header, FrameHeader::Clock::time_point now) {
+        return header.is_stamped() && now - header.created > budget_;
+    }
+
+private:
+    std::chrono::nanoseconds budget_;
+};
+
+/**
+ * @brief A shedding policy discarding frames while the queue of a Decoupler holds more than a
+ *        threshold of frames, _e.g._, the decoupler right before the shedding filter.
+ */
+class QueueDepthShedding {
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param counters  The counters of the decoupler (see `DecouplerOptions::counters`).
+     * @param threshold Maximum number of frames left in the queue without shedding.
+     */
+    QueueDepthShedding(std::shared_ptr<const DecouplerCounters> counters, std::size_t threshold)
+            : counters_{std::move(counters)}
+            , threshold_{threshold} {
+        assert(counters_);
+    }
+
+    bool shed(const FrameHeader& /*header*/, FrameHeader::Clock::time_point /*now*/) {
+        return counters_->queue_depth.load(std::memory_order_relaxed) > threshold_;
+    }
+
+private:
+    std::shared_ptr<const DecouplerCounters> counters_;
+    std::size_t threshold_;
+};
+
+/**
+ * @brief A shedding policy discarding only one frame out of `n` while another policy would discard
+ *        them all, so that the load decreases gradually under pressure.
+ *
+ * @tparam Pressure The policy telling whether the pipeline is under pressure.
+ */
+template <typename Pressure>
+class EveryNthShedding {
+public:
+    EveryNthShedding(Pressure pressure, std::size_t n)
+            : pressure_{std::move(pressure)}
+            , n_{n} {
+        assert(n_ > 0);
+    }
+
+    bool shed(const FrameHeader& header, FrameHeader::Clock::time_point now) {
+        if (!pressure_.shed(header, now)) {
+            // Counted again from the start of the next period of pressure.
+            count_ = 0;
+            return false;
+        }
+        count_ += 1;
+        if (count_ < n_) {
+            return false;
+        }
+        count_ = 0;
+        return true;
+    }
+
+private:
+    Pressure pressure_;
+    std::size_t n_;
+    std::size_t count_{0};
+};
+
+/**
+ * @brief Counters updated by a Shedder.
+ */
+struct SheddingCounters {
+    /// @brief Number of frames discarded by the shedding policy.
+    std::atomic<uint64_t> shed{0};
+};
+
+/**
+ * @brief A filter implementation discarding the frames its policy tells to shed, _e.g._, right
+ *        before an expensive filter, so that stale work is dropped rather than delaying the
+ *        following frames. The other frames are forwarded untouched.
+ *
+ * @tparam T      The payload type.
+ * @tparam Policy A class defining a `shed` function, taking a `const FrameHeader&` and the current
+ *                time, and returning whether the frame is to be discarded, _e.g._,
+ *                DeadlineShedding, QueueDepthShedding or EveryNthShedding.
+ */
+template <typename T, typename Policy>
+class Shedder {
+public:
+    using InputPayload = T;
+    using OutputPayload = T;
+    static constexpr const char* TRACE_NAME = "Shedder";
+
+    /**
+     * @brief Constructor.
+     *
+     * @param policy   The shedding policy.
+     * @param counters Counters to be updated by the shedder, so that the application can read
+     *                 them. If not set, the shedder uses its own counters.
+     */
+    explicit Shedder(Policy policy, std::shared_ptr<SheddingCounters> counters = {})
+            : policy_{std::move(policy)}
+            , counters_{counters ? std::move(counters) : std::make_shared<SheddingCounters>()} {}
+
+    std::optional<Frame<T>> process(Frame<T>&& frame) {
+        if (policy_.shed(frame.header(), FrameHeader::Clock::now())) {
+            counters_->shed.fetch_add(1, std::memory_order_relaxed);
+            return {};
+        }
+        return frame;
+    }
+
+    void process_batch(std::span<Frame<T>> frames, std::vector<Frame<T>>& outputs) {
+        // The frames of a batch are checked at once.
+        const auto now = FrameHeader::Clock::now();
+        uint64_t shed = 0;
+        for (auto& frame : frames) {
+            if (policy_.shed(frame.header(), now)) {
+                shed += 1;
+            } else {
+                outputs.push_back(std::move(frame));
+            }
+        }
+        if (shed > 0) {
+            counters_->shed.fetch_add(shed, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Returns the counters updated while applying the policy.
+     */
+    const SheddingCounters& counters() const {
+        return *counters_;
+    }
+
+private:
+    Policy policy_;
+    std::shared_ptr<SheddingCounters> counters_;
+};
+
+} // namespace dpipe
+
+#endif // DPIPE_ELEMENTS_SHEDDING_H_
@@ -1,8 +1,9 @@
 #ifndef DPIPE_ELEMENTS_SINK_H_
 #define DPIPE_ELEMENTS_SINK_H_
 
-#include <dpipe/elements/interfaces.h>
-#include <dpipe/frame.h>
+#include <utility>
+
+#include <dpipe/elements/static.h>
 
 namespace dpipe {
 
@@ -12,9 +13,14 @@ namespace dpipe {
  * @tparam Impl_ User-defined sink implementation.
  *               It must define `InputPayload` type, as well as a `consume`
  *               function taking `Frame<InputPayload>` and returning `void`.
+ *               It may also define a `consume_batch` function taking
+ *               `std::span<Frame<InputPayload>>`; otherwise, batches are consumed by calling
+ *               `consume` on each frame.
+ *               It may also define a `finish` function taking no input and returning `void`,
+ *               called at the end of stream.
  */
 template <typename Impl_>
-class Sink : public Next<typename Impl_::InputPayload> {
+class Sink : public StaticArm<impl::StaticSink<Impl_>> {
 public:
     using Impl = Impl_;
     using InputPayload = typename Impl::InputPayload;
@@ -25,22 +31,7 @@ public:
      */
     template <typename... Args>
     explicit Sink(Args&&... args)
-            : impl_{std::forward<Args>(args)...} {}
-
-    ~Sink() = default;
-
-    Sink(const Sink& other) = delete;
-    Sink& operator=(const Sink& other) = delete;
-
-    Sink(Sink&& other) = default;
-    Sink& operator=(Sink&& other) = default;
-
-    void push(Frame<InputPayload>&& input) override {
-        impl_.consume(std::move(input));
-    }
-
-private:
-    Impl impl_;
+            : StaticArm<impl::StaticSink<Impl>>{std::in_place, std::forward<Args>(args)...} {}
 };
 
 } // namespace dpipe
@@ -1,10 +1,11 @@
 #ifndef DPIPE_ELEMENTS_SOURCE_H_
 #define DPIPE_ELEMENTS_SOURCE_H_
 
-#include <cassert>
 #include <memory>
+#include <utility>
 
 #include <dpipe/elements/interfaces.h>
+#include <dpipe/elements/static.h>
 
 namespace dpipe {
 
@@ -14,9 +15,12 @@ namespace dpipe {
  * @tparam Impl_ User-defined source implementation.
  *               It must define `OutputPayload` type, as well as a `produce`
  *               function taking no input and returning `std::optional<Frame<OutputPayload>>`.
+ *               When no frame is returned, the source is deemed idle, unless it also defines an
+ *               `end_of_stream` function returning `true`, in which case the end of stream is
+ *               propagated through the pipeline.
  */
 template <typename Impl_>
-class Source : public Entry {
+class Source : public StaticSource<Impl_, impl::DynamicLink<typename Impl_::OutputPayload>> {
 public:
     using Impl = Impl_;
     using OutputPayload = typename Impl::OutputPayload;
@@ -27,30 +31,9 @@ public:
      */
     template <typename... Args>
     explicit Source(std::unique_ptr<Next<OutputPayload>>&& next, Args&&... args)
-            : next_{std::move(next)}
-            , impl_{std::forward<Args>(args)...} {
-        assert(next_);
-    }
-
-    ~Source() = default;
-
-    Source(const Source& other) = delete;
-    Source& operator=(const Source& other) = delete;
-
-    Source(Source&& other) = default;
-    Source& operator=(Source&& other) = default;
-
-    void push() override {
-        auto output = impl_.produce();
-        if (output.has_value()) {
-            assert(next_);
-            next_->push(std::move(*output));
-        }
-    }
-
-private:
-    std::unique_ptr<Next<OutputPayload>> next_;
-    Impl impl_;
+            : StaticSource<Impl, impl::DynamicLink<OutputPayload>>{
+                      std::in_place, impl::DynamicLink<OutputPayload>{std::move(next)},
+                      std::forward<Args>(args)...} {}
 };
 
 } // namespace dpipe
@@ -2,11 +2,14 @@
 #define DPIPE_ELEMENTS_SPLITTER_H_
 
 #include <cassert>
+#include <cstddef>
 #include <memory>
+#include <span>
 #include <vector>
 
 #include <dpipe/elements/interfaces.h>
 #include <dpipe/frame.h>
+#include <dpipe/metrics.h>
 
 namespace dpipe {
 
@@ -45,14 +48,52 @@ public:
     Splitter& operator=(Splitter&& other) = default;
 
     void push(Frame<InputPayload>&& input) override {
+        metrics_.frames_in();
+        metrics_.frames_out(nexts_.size());
+        // Every arm but the last gets a copy, the last one gets the original frame, so that it
+        // holds the only reference once the other arms are done with theirs.
+        for (std::size_t i = 0; i + 1 < nexts_.size(); ++i) {
+            assert(nexts_[i]);
+            nexts_[i]->push(Frame<InputPayload>{input});
+        }
+        assert(nexts_.back());
+        nexts_.back()->push(std::move(input));
+    }
+
+    void push_batch(std::span<Frame<InputPayload>> inputs) override {
+        metrics_.frames_in(inputs.size());
+        metrics_.frames_out(inputs.size() * nexts_.size());
+        // Every arm but the last gets a copy, the last one gets the original frames.
+        for (std::size_t i = 0; i + 1 < nexts_.size(); ++i) {
+            assert(nexts_[i]);
+            copies_.assign(inputs.begin(), inputs.end());
+            nexts_[i]->push_batch(copies_);
+            copies_.clear();
+        }
+        assert(nexts_.back());
+        nexts_.back()->push_batch(inputs);
+    }
+
+    void finish() override {
+        for (const auto& next : nexts_) {
+            assert(next);
+            next->finish();
+        }
+    }
+
+    void collect(PipelineMetrics& metrics) const override {
+        metrics_.collect(metrics, "Splitter");
         for (const auto& next : nexts_) {
             assert(next);
-            next->push(Frame<InputPayload>{input});
+            next->collect(metrics);
         }
     }
 
 private:
     std::vector<std::unique_ptr<Next<InputPayload>>> nexts_;
+    // Reused across batches, so that its storage is allocated only once.
+    std::vector<Frame<InputPayload>> copies_;
+    [[no_unique_address]] impl::ElementMetrics<> metrics_;
 };
 
 } // namespace dpipe
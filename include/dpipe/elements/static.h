@@ -0,0 +1,336 @@
+#ifndef DPIPE_ELEMENTS_STATIC_H_
+#define DPIPE_ELEMENTS_STATIC_H_
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <dpipe/elements/interfaces.h>
+#include <dpipe/frame-header.h>
+#include <dpipe/frame.h>
+#include <dpipe/metrics.h>
+#include <dpipe/tracing.h>
+
+namespace dpipe {
+
+namespace impl {
+
+/**
+ * @brief The end of a static chain that consumes frames with a user-defined sink implementation.
+ */
+template <typename SinkImpl>
+class StaticSink {
+public:
+    using Payload = typename SinkImpl::InputPayload;
+
+    explicit StaticSink(SinkImpl&& impl)
+            : impl_{std::move(impl)} {}
+
+    /**
+     * @brief Constructs the implementation in place from the given arguments.
+     */
+    template <typename... Args>
+    explicit StaticSink(std::in_place_t, Args&&... args)
+            : impl_{std::forward<Args>(args)...} {}
+
+    void push(Frame<Payload>&& input) {
+        metrics_.frames_in();
+        const auto begin = metrics_.now();
+        const auto trace_begin = tracer_.now();
+        const auto trace_frame = tracer_.id(input);
+        impl_.consume(std::move(input));
+        tracer_.span(trace_name<SinkImpl>("Sink"), trace_frame, trace_begin);
+        metrics_.latency(begin);
+    }
+
+    void push_batch(std::span<Frame<Payload>> inputs) {
+        metrics_.frames_in(inputs.size());
+        const auto begin = metrics_.now();
+        const auto trace_begin = tracer_.now();
+        const auto trace_frame = tracer_.id(inputs);
+        if constexpr (requires { impl_.consume_batch(inputs); }) {
+            impl_.consume_batch(inputs);
+        } else {
+            for (auto& input : inputs) {
+                impl_.consume(std::move(input));
+            }
+        }
+        tracer_.span(trace_name<SinkImpl>("Sink"), trace_frame, trace_begin, inputs.size());
+        metrics_.latency(begin, inputs.size());
+    }
+
+    void finish() {
+        finish_sink(impl_);
+    }
+
+    void collect(PipelineMetrics& metrics) const {
+        metrics_.collect(metrics, "Sink");
+    }
+
+private:
+    SinkImpl impl_;
+    [[no_unique_address]] ElementMetrics<> metrics_;
+    [[no_unique_address]] ElementTracer<> tracer_;
+};
+
+/**
+ * @brief The end of a static chain that forwards frames to a type-erased element,
+ *        _e.g._, a Decoupler or a Splitter.
+ */
+template <typename T>
+class DynamicLink {
+public:
+    using Payload = T;
+
+    explicit DynamicLink(std::unique_ptr<Next<T>>&& next)
+            : next_{std::move(next)} {
+        assert(next_);
+    }
+
+    void push(Frame<Payload>&& input) {
+        next_->push(std::move(input));
+    }
+
+    void push_batch(std::span<Frame<Payload>> inputs) {
+        next_->push_batch(inputs);
+    }
+
+    void finish() {
+        next_->finish();
+    }
+
+    void collect(PipelineMetrics& metrics) const {
+        next_->collect(metrics);
+    }
+
+private:
+    std::unique_ptr<Next<T>> next_;
+};
+
+/**
+ * @brief A user-defined filter implementation statically linked to the rest of the chain.
+ */
+template <typename FilterImpl, typename Tail>
+class StaticFilter {
+public:
+    using Payload = typename FilterImpl::InputPayload;
+    using OutputPayload = typename FilterImpl::OutputPayload;
+
+    StaticFilter(FilterImpl&& impl, Tail&& tail)
+            : impl_{std::move(impl)}
+            , tail_{std::move(tail)} {}
+
+    /**
+     * @brief Constructs the implementation in place from the given arguments.
+     */
+    template <typename... Args>
+    StaticFilter(std::in_place_t, Tail&& tail, Args&&... args)
+            : impl_{std::forward<Args>(args)...}
+            , tail_{std::move(tail)} {}
+
+    void push(Frame<Payload>&& input) {
+        if constexpr (!processes_frames<FilterImpl>) {
+            // The implementation only processes batches.
+            push_batch(std::span{&input, 1});
+        } else {
+            metrics_.frames_in();
+            const auto begin = metrics_.now();
+            const auto trace_begin = tracer_.now();
+            const auto trace_frame = tracer_.id(input);
+            auto output = process_frame(impl_, std::move(input));
+            tracer_.span(trace_name<FilterImpl>("Filter"), trace_frame, trace_begin);
+            metrics_.latency(begin);
+            if (output.has_value()) {
+                metrics_.frames_out();
+                confiner_.confine(*output);
+                tail_.push(std::move(*output));
+            } else {
+                metrics_.frames_dropped();
+            }
+        }
+    }
+
+    void push_batch(std::span<Frame<Payload>> inputs) {
+        metrics_.frames_in(inputs.size());
+        const auto begin = metrics_.now();
+        const auto trace_begin = tracer_.now();
+        const auto trace_frame = tracer_.id(inputs);
+        if constexpr (requires { impl_.process_batch(inputs, outputs_); }) {
+            if constexpr (FRAME_HEADER_STORED) {
+                // Copied, as the input frames may be moved into the implementation.
+                input_headers_.clear();
+                for (const auto& input : inputs) {
+                    input_headers_.push_back(input.header());
+                }
+                impl_.process_batch(inputs, outputs_);
+                carry_headers(std::span{outputs_}, std::span<const FrameHeader>{input_headers_});
+            } else {
+                impl_.process_batch(inputs, outputs_);
+            }
+        } else {
+            for (auto& input : inputs) {
+                auto output = process_frame(impl_, std::move(input));
+                if (output.has_value()) {
+                    outputs_.push_back(std::move(*output));
+                }
+            }
+        }
+        tracer_.span(trace_name<FilterImpl>("Filter"), trace_frame, trace_begin, inputs.size());
+        metrics_.latency(begin, inputs.size());
+        metrics_.frames_out(outputs_.size());
+        metrics_.frames_dropped(inputs.size() - std::min(inputs.size(), outputs_.size()));
+        if (!outputs_.empty()) {
+            confiner_.confine(std::span{outputs_});
+            tail_.push_batch(outputs_);
+            outputs_.clear();
+        }
+    }
+
+    void finish() {
+        finish_filter(impl_, [this](Frame<OutputPayload>&& output) {
+            metrics_.frames_out();
+            tail_.push(std::move(output));
+        });
+        tail_.finish();
+    }
+
+    void collect(PipelineMetrics& metrics) const {
+        metrics_.collect(metrics, "Filter");
+        tail_.collect(metrics);
+    }
+
+private:
+    FilterImpl impl_;
+    Tail tail_;
+    // Reused across batches, so that their storage is allocated only once.
+    std::vector<Frame<OutputPayload>> outputs_;
+    std::vector<FrameHeader> input_headers_;
+    [[no_unique_address]] ElementMetrics<> metrics_;
+    [[no_unique_address]] ElementTracer<> tracer_;
+    [[no_unique_address]] FrameConfiner<> confiner_;
+};
+
+} // namespace impl
+
+/**
+ * @brief An arm whose elements are composed at compile-time into a single object, so that frames
+ *        flow through them without virtual calls. Only pushing into the arm is a virtual call.
+ *        Filter and Sink are arms of a single element as well. Frames are confined to the thread
+ *        pushing them, if enabled (see `DPIPE_ENABLE_CONFINED_FRAMES`).
+ *
+ * @tparam Chain A static chain of elements, as created by `make_static_arm` or `make_static_pipe`
+ *               builder functions.
+ */
+template <typename Chain>
+class StaticArm : public Next<typename Chain::Payload> {
+public:
+    using InputPayload = typename Chain::Payload;
+
+    /**
+     * @brief Constructor. Typically not used directly, but through `make_static_arm` or
+     *        `make_static_pipe` builder functions.
+     */
+    explicit StaticArm(Chain&& chain)
+            : chain_{std::move(chain)} {}
+
+    /**
+     * @brief Constructs the chain in place from the given arguments.
+     */
+    template <typename... Args>
+    explicit StaticArm(std::in_place_t, Args&&... args)
+            : chain_{std::in_place, std::forward<Args>(args)...} {}
+
+    void push(Frame<InputPayload>&& input) override {
+        confiner_.confine(input);
+        chain_.push(std::move(input));
+    }
+
+    void push_batch(std::span<Frame<InputPayload>> inputs) override {
+        confiner_.confine(inputs);
+        chain_.push_batch(inputs);
+    }
+
+    void finish() override {
+        chain_.finish();
+    }
+
+    void collect(PipelineMetrics& metrics) const override {
+        chain_.collect(metrics);
+    }
+
+private:
+    Chain chain_;
+    [[no_unique_address]] impl::FrameConfiner<> confiner_;
+};
+
+/**
+ * @brief A source statically linked to the rest of its synchronous segment.
+ *        Source is one linked to a type-erased element.
+ *
+ * @tparam Impl_ User-defined source implementation (see Source).
+ * @tparam Chain A static chain of elements, as created by `make_static_pipe` builder function.
+ */
+template <typename Impl_, typename Chain>
+class StaticSource : public Entry {
+public:
+    using Impl = Impl_;
+    using OutputPayload = typename Impl::OutputPayload;
+
+    /**
+     * @brief Constructor. Typically not used directly, but through `make_static_pipe` builder
+     *        function.
+     */
+    StaticSource(Chain&& chain, Impl&& impl)
+            : chain_{std::move(chain)}
+            , impl_{std::move(impl)} {}
+
+    /**
+     * @brief Constructs the implementation in place from the given arguments.
+     */
+    template <typename... Args>
+    StaticSource(std::in_place_t, Chain&& chain, Args&&... args)
+            : chain_{std::move(chain)}
+            , impl_{std::forward<Args>(args)...} {}
+
+    SourceStatus push() override {
+        const auto begin = metrics_.now();
+        const auto trace_begin = tracer_.now();
+        auto output = impl_.produce();
+        if (!output.has_value()) {
+            return impl::end_of_stream(impl_) ? SourceStatus::EndOfStream : SourceStatus::Idle;
+        }
+        stamper_.stamp(*output);
+        tracer_.span(impl::trace_name<Impl>("Source"), tracer_.id(*output), trace_begin);
+        metrics_.latency(begin);
+        metrics_.frames_out();
+        confiner_.confine(*output);
+        chain_.push(std::move(*output));
+        // The calling thread is deemed idle while no frame is produced.
+        metrics_.busy(begin);
+        return SourceStatus::Produced;
+    }
+
+    void finish() override {
+        chain_.finish();
+    }
+
+    void collect(PipelineMetrics& metrics) const override {
+        metrics_.collect(metrics, "Source");
+        chain_.collect(metrics);
+    }
+
+private:
+    Chain chain_;
+    Impl impl_;
+    [[no_unique_address]] impl::ElementMetrics<> metrics_;
+    [[no_unique_address]] impl::ElementTracer<> tracer_;
+    [[no_unique_address]] impl::FrameStamper<> stamper_;
+    [[no_unique_address]] impl::FrameConfiner<> confiner_;
+};
+
+} // namespace dpipe
+
+#endif // DPIPE_ELEMENTS_STATIC_H_
@@ -0,0 +1,345 @@
+#ifndef DPIPE_FRAME_BATCH_H_
+#define DPIPE_FRAME_BATCH_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <dpipe/utils/hardware.h>
+
+namespace dpipe {
+
+namespace impl {
+
+/**
+ * @brief The members of a payload type stored in a column each, as a tuple of pointers to data
+ *        members. Payload types opt in by defining a `COLUMNS` static member.
+ */
+template <typename T>
+constexpr auto columns_of() {
+    if constexpr (requires { T::COLUMNS; }) {
+        return T::COLUMNS;
+    } else {
+        return std::tuple<>{};
+    }
+}
+
+template <typename MemberPointer>
+struct MemberOf;
+
+template <typename T, typename U>
+struct MemberOf<U T::*> {
+    using Type = U;
+};
+
+/**
+ * @brief A fixed-capacity array of trivially-copyable values, aligned and padded to a whole number
+ *        of cache lines.
+ */
+template <typename U>
+class AlignedColumn {
+public:
+    static_assert(std::is_trivially_copyable_v<U>, "columns must be trivially copyable");
+
+    AlignedColumn() = default;
+
+    explicit AlignedColumn(std::size_t capacity)
+            : data_{allocate(capacity)} {}
+
+    U* data() const {
+        return data_.get();
+    }
+
+    // The capacity is rounded up, so that the padding can be read and written as well.
+    static std::size_t padded(std::size_t capacity) {
+        const auto bytes = (capacity * sizeof(U) + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+        return bytes / sizeof(U);
+    }
+
+private:
+    struct Delete {
+        void operator()(U* data) const {
+            ::operator delete[](data, std::align_val_t{CACHE_LINE_SIZE});
+        }
+    };
+
+    static U* allocate(std::size_t capacity) {
+        if (capacity == 0) {
+            return nullptr;
+        }
+        const auto size = padded(capacity);
+        auto* data = static_cast<U*>(
+                ::operator new[](size * sizeof(U), std::align_val_t{CACHE_LINE_SIZE}));
+        std::uninitialized_value_construct_n(data, size);
+        return data;
+    }
+
+    std::unique_ptr<U[], Delete> data_;
+};
+
+} // namespace impl
+
+/**
+ * @brief A batch of payloads stored in a struct-of-arrays layout, to be passed as a single frame,
+ *        so that filters can run vectorised loops across payloads.
+ *
+ * Payload types listing some of their data members in a `COLUMNS` static member, as a tuple of
+ * pointers to data members, have each of them stored in its own column; members not listed are
+ * not stored. Any other trivially-copyable payload type is stored whole, in a single column.
+ * Every column is aligned to a cache line and padded to a whole number of cache lines.
+ *
+ * @code
+ * struct Sample {
+ *     uint16_t raw;
+ *     float gain;
+ *     static constexpr auto COLUMNS = std::tuple{&Sample::raw, &Sample::gain};
+ * };
+ * FrameBatch<Sample> batch{64};
+ * auto raws = batch.column<&Sample::raw>(); // std::span<uint16_t>
+ * @endcode
+ *
+ * @tparam T The payload type.
+ */
+template <typename T>
+class FrameBatch {
+public:
+    /// @brief Type of the payloads in the batch.
+    using Inner = T;
+
+    /// @brief Alignment in bytes of every column.
+    static constexpr std::size_t ALIGNMENT = CACHE_LINE_SIZE;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param capacity Maximum number of payloads in the batch.
+     */
+    explicit FrameBatch(std::size_t capacity = 0)
+            : capacity_{capacity}
+            , columns_{make_columns(capacity, std::make_index_sequence<COLUMN_COUNT>{})} {}
+
+    ~FrameBatch() = default;
+
+    FrameBatch(const FrameBatch& other)
+            : FrameBatch(other.capacity_) {
+        size_ = other.size_;
+        for_each_column([&]<std::size_t I>() {
+            std::copy_n(other.template data<I>(), size_, data<I>());
+        });
+    }
+
+    FrameBatch& operator=(const FrameBatch& other) {
+        if (this != &other) {
+            *this = FrameBatch{other};
+        }
+        return *this;
+    }
+
+    FrameBatch(FrameBatch&& other) noexcept = default;
+    FrameBatch& operator=(FrameBatch&& other) noexcept = default;
+
+    /**
+     * @brief Returns the number of payloads in the batch.
+     */
+    std::size_t size() const {
+        return size_;
+    }
+
+    /**
+     * @brief Returns the maximum number of payloads in the batch.
+     */
+    std::size_t capacity() const {
+        return capacity_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    bool full() const {
+        return size_ == capacity_;
+    }
+
+    /**
+     * @brief Sets the number of payloads, up to the capacity. New payloads have their columns
+     *        value-initialized.
+     */
+    void resize(std::size_t size) {
+        assert(size <= capacity_);
+        for_each_column([&]<std::size_t I>() {
+            using U = ColumnType<I>;
+            std::fill(data<I>() + std::min(size_, size), data<I>() + size, U{});
+        });
+        size_ = size;
+    }
+
+    void clear() {
+        size_ = 0;
+    }
+
+    /**
+     * @brief Scatters a payload into the columns, after the last one.
+     */
+    void push_back(const T& payload) {
+        assert(size_ < capacity_);
+        store(size_, payload);
+        size_ += 1;
+    }
+
+    /**
+     * @brief Gathers the payload at the given position from the columns.
+     */
+    T operator[](std::size_t index) const {
+        assert(index < size_);
+        if constexpr (WHOLE) {
+            return data<0>()[index];
+        } else {
+            T payload{};
+            for_each_column([&]<std::size_t I>() {
+                payload.*std::get<I>(COLUMNS) = data<I>()[index];
+            });
+            return payload;
+        }
+    }
+
+    /**
+     * @brief Overwrites the payload at the given position.
+     */
+    void set(std::size_t index, const T& payload) {
+        assert(index < size_);
+        store(index, payload);
+    }
+
+    /**
+     * @brief Returns the column of the given data member, _e.g._, `column<&T::member>()`.
+     */
+    template <auto Member>
+    auto column() const {
+        static_assert(index_of<Member>() < COLUMN_COUNT, "not a column of the payload type");
+        return column_at<index_of<Member>()>();
+    }
+
+    template <auto Member>
+    auto column() {
+        static_assert(index_of<Member>() < COLUMN_COUNT, "not a column of the payload type");
+        return column_at<index_of<Member>()>();
+    }
+
+    /**
+     * @brief Returns the column at the given position in `COLUMNS`, or the only column of payloads
+     *        stored whole.
+     */
+    template <std::size_t I>
+    auto column_at() const {
+        return std::span<const ColumnType<I>>{data<I>(), size_};
+    }
+
+    template <std::size_t I>
+    auto column_at() {
+        return std::span<ColumnType<I>>{data<I>(), size_};
+    }
+
+private:
+    static constexpr auto COLUMNS = impl::columns_of<T>();
+    // Payloads without columns are stored whole.
+    static constexpr bool WHOLE = std::tuple_size_v<decltype(COLUMNS)> == 0;
+    static constexpr std::size_t COLUMN_COUNT = WHOLE ? 1 : std::tuple_size_v<decltype(COLUMNS)>;
+
+    template <std::size_t I>
+    struct Column {
+        using Type = typename impl::MemberOf<
+                std::remove_cvref_t<std::tuple_element_t<I, decltype(COLUMNS)>>>::Type;
+    };
+
+    struct Whole {
+        using Type = T;
+    };
+
+    template <std::size_t I>
+    using ColumnType = typename std::conditional_t<WHOLE, Whole, Column<I>>::Type;
+
+    template <typename Sequence>
+    struct Storage;
+
+    template <std::size_t... Is>
+    struct Storage<std::index_sequence<Is...>> {
+        using Type = std::tuple<impl::AlignedColumn<ColumnType<Is>>...>;
+    };
+
+    using Columns = typename Storage<std::make_index_sequence<COLUMN_COUNT>>::Type;
+
+    template <std::size_t... Is>
+    static Columns make_columns(std::size_t capacity, std::index_sequence<Is...>) {
+        return Columns{impl::AlignedColumn<ColumnType<Is>>{capacity}...};
+    }
+
+    template <auto Member>
+    static constexpr std::size_t index_of() {
+        std::size_t index = COLUMN_COUNT;
+        [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+            ((index = same_member(std::get<Is>(COLUMNS), Member) ? Is : index), ...);
+        }(std::make_index_sequence<std::tuple_size_v<decltype(COLUMNS)>>{});
+        return index;
+    }
+
+    template <typename A, typename B>
+    static constexpr bool same_member(A a, B b) {
+        if constexpr (std::is_same_v<A, B>) {
+            return a == b;
+        } else {
+            return false;
+        }
+    }
+
+    template <typename Function>
+    static void for_each_column(Function&& function) {
+        [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+            (function.template operator()<Is>(), ...);
+        }(std::make_index_sequence<COLUMN_COUNT>{});
+    }
+
+    template <std::size_t I>
+    auto* data() const {
+        return std::get<I>(columns_).data();
+    }
+
+    void store(std::size_t index, const T& payload) {
+        if constexpr (WHOLE) {
+            data<0>()[index] = payload;
+        } else {
+            for_each_column([&]<std::size_t I>() {
+                data<I>()[index] = payload.*std::get<I>(COLUMNS);
+            });
+        }
+    }
+
+    std::size_t capacity_{};
+    std::size_t size_{};
+    Columns columns_;
+};
+
+namespace impl {
+
+template <typename T>
+struct IsFrameBatch : std::false_type {};
+
+template <typename T>
+struct IsFrameBatch<FrameBatch<T>> : std::true_type {};
+
+} // namespace impl
+
+/**
+ * @brief Satisfied by the FrameBatch types, whatever their payload type.
+ */
+template <typename T>
+concept frame_batch = impl::IsFrameBatch<T>::value;
+
+} // namespace dpipe
+
+#endif // DPIPE_FRAME_BATCH_H_
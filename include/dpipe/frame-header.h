@@ -0,0 +1,212 @@
+#ifndef DPIPE_FRAME_HEADER_H_
+#define DPIPE_FRAME_HEADER_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/**
+ * @brief Define to 1 to make every frame carry a FrameHeader, stamped by sources and carried over
+ *        by filters. When disabled (the default), frames hold no header, and every header read is
+ *        blank, except for the source and the sequence number if tracing is compiled in (see
+ *        `DPIPE_ENABLE_TRACING`). It must have the same value in every translation unit.
+ */
+#ifndef DPIPE_ENABLE_FRAME_HEADERS
+#define DPIPE_ENABLE_FRAME_HEADERS 0
+#endif
+
+/**
+ * @brief Define to the maximum number of filters whose output time is recorded in a FrameHeader.
+ *        When 0 (the default), no hop is recorded. It must have the same value in every
+ *        translation unit.
+ */
+#ifndef DPIPE_FRAME_HEADER_HOPS
+#define DPIPE_FRAME_HEADER_HOPS 0
+#endif
+
+// See tracing.h, which traces frames by the sequence number of their header.
+#ifndef DPIPE_ENABLE_TRACING
+#define DPIPE_ENABLE_TRACING 0
+#endif
+
+namespace dpipe {
+
+/// @brief Whether frames carry a FrameHeader.
+inline constexpr bool FRAME_HEADERS_ENABLED = DPIPE_ENABLE_FRAME_HEADERS != 0;
+
+/**
+ * @brief Metadata of a frame, held by the frame itself rather than by its data object, so that
+ *        copies of a frame (_e.g._, by a Splitter) carry their own, and data objects are left
+ *        untouched.
+ */
+struct FrameHeader {
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief Maximum number of hops recorded (see `DPIPE_FRAME_HEADER_HOPS`).
+    static constexpr std::size_t MAX_HOPS = DPIPE_FRAME_HEADER_HOPS;
+
+    /// @brief Position of the frame in the stream of its source, starting from 0.
+    uint64_t sequence{0};
+    /// @brief Time the frame has been produced by its source, or the epoch if not stamped.
+    Clock::time_point created{};
+    /// @brief Times the frame has left the filters it went through, in order. Only the first
+    ///        `hop_count` ones are set.
+    std::array<Clock::time_point, MAX_HOPS> hops{};
+    /// @brief Number of hops recorded, at most `MAX_HOPS`.
+    uint32_t hop_count{0};
+    /// @brief Identifier of the source that stamped the frame, unique within the process and
+    ///        starting from 1, or 0 if not stamped by a source.
+    uint32_t source{0};
+
+    /**
+     * @brief Returns whether the header has been stamped, either by a source or by the
+     *        implementation of an element.
+     */
+    bool is_stamped() const {
+        return source != 0 || created != Clock::time_point{};
+    }
+
+    /**
+     * @brief Records a hop, unless `MAX_HOPS` are already recorded.
+     */
+    void add_hop(Clock::time_point time) {
+        if constexpr (MAX_HOPS > 0) {
+            if (hop_count < MAX_HOPS) {
+                hops[hop_count] = time;
+                hop_count += 1;
+            }
+        }
+    }
+};
+
+namespace impl {
+
+/// @brief Whether frames hold a header: either frame headers are enabled, or tracing is compiled
+///        in, in which case only the source and the sequence number are set, to identify frames in
+///        traces.
+inline constexpr bool FRAME_HEADER_STORED = FRAME_HEADERS_ENABLED || DPIPE_ENABLE_TRACING != 0;
+
+/**
+ * @brief Storage of the header of a frame. Client code does not need to use it.
+ *
+ * When frames hold no header, the class is empty and is meant to be declared as a
+ * `[[no_unique_address]]` member, and reads return a blank header.
+ */
+template <bool Enabled = FRAME_HEADER_STORED>
+class FrameHeaderField {
+public:
+    const FrameHeader& get() const {
+        return header_;
+    }
+
+    void set(const FrameHeader& header) {
+        header_ = header;
+    }
+
+private:
+    FrameHeader header_;
+};
+
+template <>
+class FrameHeaderField<false> {
+public:
+    const FrameHeader& get() const {
+        return BLANK;
+    }
+
+    void set(const FrameHeader&) {}
+
+private:
+    static constexpr FrameHeader BLANK{};
+};
+
+/**
+ * @brief Stamps the frames produced by a source, unless its implementation already did.
+ *        Client code does not need to use it.
+ *
+ * When frames hold no header, the class is empty and is meant to be declared as a
+ * `[[no_unique_address]]` member. When they only hold one for tracing, the creation time is not
+ * set.
+ */
+template <bool Enabled = FRAME_HEADER_STORED>
+class FrameStamper {
+public:
+    FrameStamper()
+            : source_{next_source()} {}
+
+    template <typename Frame>
+    void stamp(Frame& frame) {
+        if (frame.header().is_stamped()) {
+            return;
+        }
+        FrameHeader header;
+        header.sequence = next_sequence_;
+        header.source = source_;
+        if constexpr (FRAME_HEADERS_ENABLED) {
+            header.created = FrameHeader::Clock::now();
+        }
+        next_sequence_ += 1;
+        frame.set_header(header);
+    }
+
+private:
+    static uint32_t next_source() {
+        static std::atomic<uint32_t> next{1};
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint32_t source_;
+    uint64_t next_sequence_{0};
+};
+
+template <>
+class FrameStamper<false> {
+public:
+    template <typename Frame>
+    void stamp(Frame&) {}
+};
+
+/**
+ * @brief Carries the header of the input frame of a filter over to its output frame, unless the
+ *        filter implementation stamped the latter itself, and records a hop.
+ */
+template <typename Frame>
+void carry_header(Frame& output, const FrameHeader& input) {
+    if constexpr (FRAME_HEADER_STORED) {
+        if (!output.header().is_stamped()) {
+            output.set_header(input);
+        }
+        if constexpr (FRAME_HEADERS_ENABLED && FrameHeader::MAX_HOPS > 0) {
+            auto header = output.header();
+            header.add_hop(FrameHeader::Clock::now());
+            output.set_header(header);
+        }
+    }
+}
+
+/**
+ * @brief Same as `carry_header`, for the output frames of a batch: each one takes the header of the
+ *        input frame at the same position if there are as many input and output frames, or the
+ *        header of the first input frame otherwise.
+ */
+template <typename Frame>
+void carry_headers(std::span<Frame> outputs, std::span<const FrameHeader> inputs) {
+    if constexpr (FRAME_HEADER_STORED) {
+        if (inputs.empty()) {
+            return;
+        }
+        const bool matching = outputs.size() == inputs.size();
+        for (std::size_t i = 0; i < outputs.size(); ++i) {
+            carry_header(outputs[i], inputs[matching ? i : 0]);
+        }
+    }
+}
+
+} // namespace impl
+
+} // namespace dpipe
+
+#endif // DPIPE_FRAME_HEADER_H_
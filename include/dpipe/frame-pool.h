@@ -0,0 +1,193 @@
+#ifndef DPIPE_FRAME_POOL_H_
+#define DPIPE_FRAME_POOL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+
+namespace dpipe {
+
+/**
+ * @brief A snapshot of the statistics of a FramePool.
+ */
+struct FramePoolStats {
+    /// @brief Number of frames allocated reusing recycled storage.
+    uint64_t hits{};
+    /// @brief Number of frames that required allocating new storage.
+    uint64_t misses{};
+    /// @brief Number of frames currently alive.
+    std::size_t in_flight{};
+    /// @brief Maximum number of frames alive at the same time.
+    std::size_t high_water{};
+
+    /**
+     * @brief Returns the ratio of allocations served with recycled storage.
+     */
+    double hit_rate() const {
+        const auto total = hits + misses;
+        return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+    }
+};
+
+namespace impl {
+
+/**
+ * @brief Recycles fixed-size memory blocks, whatever the thread releasing them.
+ *        Freed blocks are kept in an intrusive list, so that recycling never allocates.
+ */
+class PoolStorage {
+public:
+    PoolStorage() = default;
+
+    ~PoolStorage() {
+        while (free_ != nullptr) {
+            auto* next = free_->next;
+            ::operator delete(free_, std::align_val_t{alignment_});
+            free_ = next;
+        }
+    }
+
+    PoolStorage(const PoolStorage& other) = delete;
+    PoolStorage& operator=(const PoolStorage& other) = delete;
+
+    PoolStorage(PoolStorage&& other) = delete;
+    PoolStorage& operator=(PoolStorage&& other) = delete;
+
+    void* allocate(std::size_t size, std::size_t alignment) {
+        std::unique_lock<std::mutex> lock{mutex_};
+        if (block_size_ == 0) {
+            // The first allocation decides the block size of the pool.
+            block_size_ = std::max(size, sizeof(FreeBlock));
+            alignment_ = std::max(alignment, alignof(FreeBlock));
+        }
+        if (size > block_size_ || alignment > alignment_) {
+            // Not a block of this pool: it does not count.
+            lock.unlock();
+            return ::operator new(size, std::align_val_t{alignment});
+        }
+        stats_.in_flight += 1;
+        stats_.high_water = std::max(stats_.high_water, stats_.in_flight);
+        if (free_ != nullptr) {
+            auto* block = free_;
+            free_ = block->next;
+            stats_.hits += 1;
+            return block;
+        }
+        stats_.misses += 1;
+        const auto block_size = block_size_;
+        const auto block_alignment = alignment_;
+        lock.unlock();
+        return ::operator new(block_size, std::align_val_t{block_alignment});
+    }
+
+    void deallocate(void* ptr, std::size_t size, std::size_t alignment) {
+        std::unique_lock<std::mutex> lock{mutex_};
+        if (size > block_size_ || alignment > alignment_) {
+            lock.unlock();
+            ::operator delete(ptr, std::align_val_t{alignment});
+            return;
+        }
+        stats_.in_flight -= 1;
+        free_ = new (ptr) FreeBlock{free_};
+    }
+
+    FramePoolStats stats() const {
+        std::lock_guard<std::mutex> lock{mutex_};
+        return stats_;
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    mutable std::mutex mutex_;
+    FreeBlock* free_{nullptr};
+    std::size_t block_size_{0};
+    std::size_t alignment_{0};
+    FramePoolStats stats_{};
+};
+
+/**
+ * @brief A standard allocator drawing memory from a PoolStorage.
+ *        It keeps the storage alive, so that frames can outlive their pool.
+ */
+template <typename U>
+class PoolAllocator {
+public:
+    using value_type = U;
+
+    explicit PoolAllocator(std::shared_ptr<PoolStorage> storage)
+            : storage_{std::move(storage)} {}
+
+    template <typename V>
+    PoolAllocator(const PoolAllocator<V>& other)
+            : storage_{other.storage_} {}
+
+    U* allocate(std::size_t n) {
+        return static_cast<U*>(storage_->allocate(n * sizeof(U), alignof(U)));
+    }
+
+    void deallocate(U* ptr, std::size_t n) {
+        storage_->deallocate(ptr, n * sizeof(U), alignof(U));
+    }
+
+    template <typename V>
+    bool operator==(const PoolAllocator<V>& other) const {
+        return storage_ == other.storage_;
+    }
+
+private:
+    template <typename V>
+    friend class PoolAllocator;
+
+    std::shared_ptr<PoolStorage> storage_;
+};
+
+} // namespace impl
+
+/**
+ * @brief A pool of frames, recycling the storage of frames that are no longer referenced.
+ *
+ * Each pooled frame gets a single block holding both the reference count and the data object.
+ * When the last reference to a frame is dropped, from whatever thread, its block goes back to the
+ * pool and is reused by the next `Frame::make` or `MutFrame::make` call taking the pool.
+ * Thus, once the pool has grown to the number of frames in flight, no further memory is allocated.
+ *
+ * Copies of a FramePool share the same underlying storage.
+ *
+ * @tparam T Data object type of the frames allocated by the pool.
+ */
+template <typename T>
+class FramePool {
+public:
+    using Inner = T;
+
+    FramePool()
+            : storage_{std::make_shared<impl::PoolStorage>()} {}
+
+    /**
+     * @brief Returns a snapshot of the pool statistics.
+     */
+    FramePoolStats stats() const {
+        return storage_->stats();
+    }
+
+    /**
+     * @brief Returns an allocator drawing memory from the pool.
+     *        Client code does not need to use it directly.
+     */
+    impl::PoolAllocator<T> allocator() const {
+        return impl::PoolAllocator<T>{storage_};
+    }
+
+private:
+    std::shared_ptr<impl::PoolStorage> storage_;
+};
+
+} // namespace dpipe
+
+#endif // DPIPE_FRAME_POOL_H_
@@ -1,10 +1,271 @@
 #ifndef DPIPE_FRAME_H_
 #define DPIPE_FRAME_H_
 
+#include <atomic>
+#include <cstddef>
 #include <memory>
+#include <new>
+#include <span>
+#include <utility>
+
+#include <dpipe/frame-header.h>
+#include <dpipe/frame-pool.h>
+
+/**
+ * @brief Define to 1 to count the references to frames with plain loads and stores rather than
+ *        atomic read-modify-write operations, while they stay within the synchronous segment of
+ *        a pipeline (_e.g._, one built by `make_static_pipe`). Elements handing frames over to
+ *        other threads (Decoupler, ParallelFilter, AsyncFilter, BroadcastSplitter and Merger)
+ *        switch them back to atomic counting. When enabled, user-defined implementations must not
+ *        hand frames over to other threads themselves. It must have the same value in every
+ *        translation unit.
+ */
+#ifndef DPIPE_ENABLE_CONFINED_FRAMES
+#define DPIPE_ENABLE_CONFINED_FRAMES 0
+#endif
 
 namespace dpipe {
 
+/// @brief Whether frames are confined to the synchronous segments they flow through.
+inline constexpr bool CONFINED_FRAMES_ENABLED = DPIPE_ENABLE_CONFINED_FRAMES != 0;
+
+template <typename T>
+class Frame;
+
+namespace impl {
+
+/**
+ * @brief The reference count shared by the copies of a frame, which also owns its data object.
+ *
+ * The count is atomic, unless the frame is confined to a thread (see
+ * `DPIPE_ENABLE_CONFINED_FRAMES`): it is then updated with relaxed loads and stores, which cost
+ * no more than plain ones, and no cache line bounces between cores.
+ */
+class FrameControl {
+public:
+    FrameControl() = default;
+
+    FrameControl(const FrameControl& other) = delete;
+    FrameControl& operator=(const FrameControl& other) = delete;
+
+    FrameControl(FrameControl&& other) = delete;
+    FrameControl& operator=(FrameControl&& other) = delete;
+
+    void acquire() {
+        if (CONFINED_FRAMES_ENABLED && confined_) {
+            count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        } else {
+            count_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void release() {
+        if (CONFINED_FRAMES_ENABLED && confined_) {
+            const auto count = count_.load(std::memory_order_relaxed) - 1;
+            if (count == 0) {
+                destroy();
+                return;
+            }
+            count_.store(count, std::memory_order_relaxed);
+        } else if (count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            destroy();
+        }
+    }
+
+    bool is_unique() const {
+        // Synchronizes with the release of the other references, so that their accesses to the
+        // data object happen before any later access through this one.
+        return count_.load(std::memory_order_acquire) == 1 && is_owner_unique();
+    }
+
+    // Only called on a unique frame, so that no other thread reads the flag meanwhile.
+    void confine() {
+        confined_ = true;
+    }
+
+    // Only called by the thread the frame is confined to, if any, before handing it over.
+    void share() {
+        if (confined_) {
+            confined_ = false;
+        }
+    }
+
+protected:
+    ~FrameControl() = default;
+
+    // Destroys the data object and frees this.
+    virtual void destroy() = 0;
+
+    // Whether nothing but the frame refers to the owner of the data object, if any.
+    virtual bool is_owner_unique() const {
+        return true;
+    }
+
+private:
+    std::atomic<std::size_t> count_{1};
+    bool confined_{false};
+};
+
+/**
+ * @brief A data object allocated along with its reference count, in a single block.
+ */
+template <typename T, typename Alloc>
+class InplaceFrameControl final : public FrameControl {
+public:
+    using BlockAlloc =
+            typename std::allocator_traits<Alloc>::template rebind_alloc<InplaceFrameControl>;
+
+    template <typename... Args>
+    static InplaceFrameControl* make(const Alloc& alloc, Args&&... args) {
+        BlockAlloc block_alloc{alloc};
+        // Gives the block back if the data object cannot be constructed.
+        auto deallocate = [&](InplaceFrameControl* block) { block_alloc.deallocate(block, 1); };
+        std::unique_ptr<InplaceFrameControl, decltype(deallocate)> block{block_alloc.allocate(1),
+                                                                         deallocate};
+        ::new (static_cast<void*>(block.get()))
+                InplaceFrameControl(block_alloc, std::forward<Args>(args)...);
+        return block.release();
+    }
+
+    T* data() {
+        return &data_;
+    }
+
+private:
+    template <typename... Args>
+    explicit InplaceFrameControl(const BlockAlloc& alloc, Args&&... args)
+            : alloc_{alloc}
+            , data_(std::forward<Args>(args)...) {}
+
+    ~InplaceFrameControl() = default;
+
+    void destroy() override {
+        BlockAlloc alloc{std::move(alloc_)};
+        this->~InplaceFrameControl();
+        alloc.deallocate(this, 1);
+    }
+
+    [[no_unique_address]] BlockAlloc alloc_;
+    T data_;
+};
+
+/**
+ * @brief A data object allocated outside the frame, given back to its owner through a releaser.
+ */
+template <typename T, typename Releaser>
+class AdoptedFrameControl final : public FrameControl {
+public:
+    explicit AdoptedFrameControl(std::unique_ptr<T, Releaser>&& data)
+            : data_{std::move(data)} {}
+
+private:
+    ~AdoptedFrameControl() = default;
+
+    void destroy() override {
+        delete this;
+    }
+
+    std::unique_ptr<T, Releaser> data_;
+};
+
+/**
+ * @brief A data object kept alive by a shared owner.
+ */
+template <typename Owner>
+class AliasFrameControl final : public FrameControl {
+public:
+    explicit AliasFrameControl(std::shared_ptr<Owner>&& owner)
+            : owner_{std::move(owner)} {}
+
+private:
+    ~AliasFrameControl() = default;
+
+    void destroy() override {
+        delete this;
+    }
+
+    bool is_owner_unique() const override {
+        if (owner_.use_count() != 1) {
+            return false;
+        }
+        // Same as for the count of the frame, for the references to the owner.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+    }
+
+    std::shared_ptr<Owner> owner_;
+};
+
+/**
+ * @brief Switches the reference counting of frames. Client code does not need to use it.
+ */
+struct FrameOwnership {
+    /**
+     * @brief Confines the frame to the calling thread, if it holds the only reference to its
+     *        data object.
+     */
+    template <typename T>
+    static void confine(Frame<T>& frame) {
+        if (frame.is_unique()) {
+            frame.control_->confine();
+        }
+    }
+
+    /**
+     * @brief Makes the frame safe to hand over to another thread.
+     */
+    template <typename T>
+    static void share(Frame<T>& frame) {
+        if (frame.control_ != nullptr) {
+            frame.control_->share();
+        }
+    }
+};
+
+/**
+ * @brief Confines the frames pushed through a synchronous segment, if enabled (see
+ *        `DPIPE_ENABLE_CONFINED_FRAMES`). Meant to be declared as a `[[no_unique_address]]`
+ *        member.
+ */
+template <bool Enabled = CONFINED_FRAMES_ENABLED>
+class FrameConfiner {
+public:
+    template <typename T>
+    void confine(Frame<T>& frame) const {
+        FrameOwnership::confine(frame);
+    }
+
+    template <typename T>
+    void confine(std::span<Frame<T>> frames) const {
+        for (auto& frame : frames) {
+            FrameOwnership::confine(frame);
+        }
+    }
+};
+
+template <>
+class FrameConfiner<false> {
+public:
+    template <typename T>
+    void confine(Frame<T>&) const {}
+
+    template <typename T>
+    void confine(std::span<Frame<T>>) const {}
+};
+
+/**
+ * @brief Makes the frame safe to hand over to another thread. Elements handing frames over to
+ *        other threads call it on every frame, before making it visible to them.
+ */
+template <typename T>
+void share_frame(Frame<T>& frame) {
+    if constexpr (CONFINED_FRAMES_ENABLED) {
+        FrameOwnership::share(frame);
+    }
+}
+
+} // namespace impl
+
 /**
  * @brief A box that holds a reference-counted pointer to a data object
  *        and prevents write-access to it, except for MutFrame.
@@ -40,21 +301,148 @@ public:
      */
     template <typename... Args>
     static Frame<T> make(Args&&... args) {
-        return Frame<T>(std::make_shared<T>(std::forward<Args>(args)...));
+        using Control = impl::InplaceFrameControl<T, std::allocator<T>>;
+        auto* control = Control::make(std::allocator<T>{}, std::forward<Args>(args)...);
+        return Frame<T>(control->data(), control);
+    }
+
+    /**
+     * @brief Creates a new data object, drawing memory from a pool, and wraps it into a Frame.
+     *        The memory goes back to the pool when the last reference to the frame is dropped.
+     */
+    template <typename... Args>
+    static Frame<T> make(FramePool<T>& pool, Args&&... args) {
+        using Control = impl::InplaceFrameControl<T, impl::PoolAllocator<T>>;
+        auto* control = Control::make(pool.allocator(), std::forward<Args>(args)...);
+        return Frame<T>(control->data(), control);
+    }
+
+    /**
+     * @brief Wraps a data object allocated outside the frame, _e.g._, a buffer of a capture
+     *        library, without copying it. The releaser is called with the pointer when the last
+     *        reference to the frame is dropped (or right away, if the frame cannot be allocated),
+     *        to give the data object back to its owner.
+     *
+     * @tparam Releaser A move-constructible callable taking a `T*`.
+     */
+    template <typename Releaser>
+    static Frame<T> adopt(T* data, Releaser releaser) {
+        // Released by the unique pointer if the control cannot be allocated.
+        std::unique_ptr<T, Releaser> owned{data, std::move(releaser)};
+        return Frame<T>(data, new impl::AdoptedFrameControl<T, Releaser>{std::move(owned)});
+    }
+
+    /**
+     * @brief Wraps a data object owned by another object, _e.g._, a record of a memory-mapped
+     *        file, without copying it. The owner is kept alive as long as any frame refers to it.
+     *        The data object is deemed shared, and thus copied by MutFrame, while the owner is
+     *        referred to by anything else.
+     */
+    template <typename Owner>
+    static Frame<T> alias(std::shared_ptr<Owner> owner, T* data) {
+        return Frame<T>(data, new impl::AliasFrameControl<Owner>{std::move(owner)});
+    }
+
+    /**
+     * @brief Creates a view of a part of the data object of another frame, _e.g._, one plane of a
+     *        multi-plane image or one field of a large struct, without copying it. The view shares
+     *        the ownership of the whole data object, which is kept alive as long as either frame
+     *        refers to it.
+     *
+     * @param parent The frame holding the data object.
+     * @param part   A subobject of the data object of the parent, or an object it owns.
+     */
+    template <typename Parent>
+    static Frame<T> view_of(const Frame<Parent>& parent, const T& part) {
+        parent.control_->acquire();
+        Frame<T> view(const_cast<T*>(&part), parent.control_);
+        view.header_ = parent.header_;
+        return view;
+    }
+
+    /**
+     * @brief Same as above, but taking over the reference of the parent, so that the view is
+     *        unique if the parent was, and can be modified in place by a MutFrame.
+     */
+    template <typename Parent>
+    static Frame<T> view_of(Frame<Parent>&& parent, const T& part) {
+        Frame<T> view(const_cast<T*>(&part), std::exchange(parent.control_, nullptr));
+        parent.data_ = nullptr;
+        view.header_ = parent.header_;
+        return view;
+    }
+
+    ~Frame() {
+        if (control_ != nullptr) {
+            control_->release();
+        }
+    }
+
+    Frame(const Frame<T>& other)
+            : data_{other.data_}
+            , control_{other.control_}
+            , header_{other.header_} {
+        if (control_ != nullptr) {
+            control_->acquire();
+        }
+    }
+
+    Frame& operator=(const Frame<T>& other) {
+        if (this != &other) {
+            *this = Frame<T>{other};
+        }
+        return *this;
+    }
+
+    Frame(Frame<T>&& other) noexcept
+            : data_{std::exchange(other.data_, nullptr)}
+            , control_{std::exchange(other.control_, nullptr)}
+            , header_{other.header_} {}
+
+    Frame& operator=(Frame<T>&& other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(control_, other.control_);
+        header_ = other.header_;
+        return *this;
     }
 
     /**
      * @brief Returns a const reference to the inner data object.
      */
     const T& operator*() const {
-        return *ptr_;
+        return *data_;
     }
 
     /**
      * @brief Returns a const pointer to the inner data object.
      */
     const T* operator->() const {
-        return ptr_.operator->();
+        return data_;
+    }
+
+    /**
+     * @brief Returns the header of the frame, which is blank unless `DPIPE_ENABLE_FRAME_HEADERS`
+     *        is defined to 1 (see FrameHeader), except for its sequence number when tracing is
+     *        compiled in.
+     */
+    const FrameHeader& header() const {
+        return header_.get();
+    }
+
+    /**
+     * @brief Replaces the header of the frame, _e.g._, to carry over the one of the frame it has
+     *        been created from. It does nothing unless frames hold a header.
+     */
+    void set_header(const FrameHeader& header) {
+        header_.set(header);
+    }
+
+    /**
+     * @brief Returns whether this Frame holds the only reference to the inner data object.
+     *        If so, no other thread can acquire a new reference, so the result is stable.
+     */
+    bool is_unique() const {
+        return control_ != nullptr && control_->is_unique();
     }
 
     /**
@@ -63,14 +451,22 @@ public:
      *        _i.e._, its friends.
      */
     T& inner(AccessKey) {
-        return *ptr_;
+        return *data_;
     }
 
 private:
-    explicit Frame(std::shared_ptr<T>&& ptr)
-            : ptr_{ptr} {}
+    template <typename U>
+    friend class Frame;
+
+    friend struct impl::FrameOwnership;
+
+    Frame(T* data, impl::FrameControl* control)
+            : data_{data}
+            , control_{control} {}
 
-    std::shared_ptr<T> ptr_;
+    T* data_;
+    impl::FrameControl* control_;
+    [[no_unique_address]] impl::FrameHeaderField<> header_;
 };
 
 } // namespace dpipe
@@ -0,0 +1,302 @@
+#ifndef DPIPE_METRICS_H_
+#define DPIPE_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Define to 1 to enable the instrumentation of pipeline elements.
+ *        When disabled (the default), the instrumentation compiles to nothing.
+ *        It must have the same value in every translation unit.
+ */
+#ifndef DPIPE_ENABLE_METRICS
+#define DPIPE_ENABLE_METRICS 0
+#endif
+
+namespace dpipe {
+
+/// @brief Whether the instrumentation of pipeline elements is enabled.
+inline constexpr bool METRICS_ENABLED = DPIPE_ENABLE_METRICS != 0;
+
+/**
+ * @brief A snapshot of a LatencyHistogram.
+ */
+struct HistogramSnapshot {
+    /// @brief Number of samples in every bucket.
+    std::vector<uint64_t> counts;
+    /// @brief Total number of samples.
+    uint64_t count{};
+    /// @brief Sum of all samples.
+    std::chrono::nanoseconds sum{};
+
+    /**
+     * @brief Returns the average of all samples.
+     */
+    std::chrono::nanoseconds mean() const {
+        return count == 0 ? std::chrono::nanoseconds{} : std::chrono::nanoseconds(sum / count);
+    }
+
+    /**
+     * @brief Returns the value below which the given ratio of samples falls (_e.g._, 0.99 for the
+     *        99th percentile), rounded up to the end of its bucket.
+     */
+    std::chrono::nanoseconds percentile(double ratio) const;
+};
+
+/**
+ * @brief A log-linear histogram of durations, with a constant relative error of 12.5%.
+ *
+ * Every power-of-two range is split in 8 equal buckets, so that recording a sample only takes a
+ * few bit operations and a counter update. It is meant to be written by a single thread at a time
+ * and read by any thread.
+ */
+class LatencyHistogram {
+public:
+    static constexpr std::size_t SUB_BUCKET_BITS = 3;
+    static constexpr std::size_t SUB_BUCKETS = std::size_t{1} << SUB_BUCKET_BITS;
+    static constexpr std::size_t BUCKETS = SUB_BUCKETS * (64 - SUB_BUCKET_BITS + 1);
+
+    /**
+     * @brief Records `count` samples of the given duration, in nanoseconds.
+     */
+    void record(uint64_t nanoseconds, uint64_t count = 1) {
+        add(counts_[bucket_of(nanoseconds)], count);
+        add(count_, count);
+        add(sum_, nanoseconds * count);
+    }
+
+    /**
+     * @brief Returns a snapshot of the histogram.
+     */
+    HistogramSnapshot snapshot() const {
+        HistogramSnapshot snapshot;
+        snapshot.counts.reserve(BUCKETS);
+        for (const auto& count : counts_) {
+            snapshot.counts.push_back(count.load(std::memory_order_relaxed));
+        }
+        snapshot.count = count_.load(std::memory_order_relaxed);
+        snapshot.sum = std::chrono::nanoseconds(sum_.load(std::memory_order_relaxed));
+        return snapshot;
+    }
+
+    /**
+     * @brief Returns the index of the bucket holding the given value.
+     */
+    static std::size_t bucket_of(uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return value;
+        }
+        const auto exponent = static_cast<std::size_t>(std::bit_width(value)) - 1;
+        const auto shift = exponent - SUB_BUCKET_BITS;
+        const auto sub_bucket = static_cast<std::size_t>(value >> shift) & (SUB_BUCKETS - 1);
+        return (shift + 1) * SUB_BUCKETS + sub_bucket;
+    }
+
+    /**
+     * @brief Returns the smallest value held by the given bucket.
+     */
+    static uint64_t lower_bound_of(std::size_t bucket) {
+        if (bucket < SUB_BUCKETS) {
+            return bucket;
+        }
+        const auto shift = bucket / SUB_BUCKETS - 1;
+        const auto sub_bucket = bucket % SUB_BUCKETS;
+        return (uint64_t{SUB_BUCKETS} + sub_bucket) << shift;
+    }
+
+private:
+    // Counters have a single writer, so a plain load and store is enough.
+    static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint64_t>, BUCKETS> counts_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+};
+
+inline std::chrono::nanoseconds HistogramSnapshot::percentile(double ratio) const {
+    if (count == 0) {
+        return {};
+    }
+    const auto target = static_cast<uint64_t>(ratio * static_cast<double>(count));
+    uint64_t cumulated = 0;
+    for (std::size_t bucket = 0; bucket < counts.size(); ++bucket) {
+        cumulated += counts[bucket];
+        if (cumulated > target || cumulated == count) {
+            const auto end = bucket + 1 < LatencyHistogram::BUCKETS
+                                     ? LatencyHistogram::lower_bound_of(bucket + 1) - 1
+                                     : UINT64_MAX;
+            return std::chrono::nanoseconds(end);
+        }
+    }
+    return {};
+}
+
+/**
+ * @brief A snapshot of the metrics of a pipeline element.
+ */
+struct ElementMetricsSnapshot {
+    /// @brief The kind of element (_e.g._, "Filter").
+    std::string kind;
+    /// @brief Number of frames received.
+    uint64_t frames_in{};
+    /// @brief Number of frames forwarded to the next element(s).
+    uint64_t frames_out{};
+    /// @brief Number of frames discarded.
+    uint64_t frames_dropped{};
+    /// @brief Time spent in the user-defined implementation (`produce`, `process` or `consume`).
+    HistogramSnapshot latency;
+    /// @brief Number of queued frames (decouplers only).
+    std::size_t queue_depth{};
+    /// @brief Maximum number of queued frames (decouplers only).
+    std::size_t peak_queue_depth{};
+    /// @brief Ratio of time the thread owned by the element has been busy, if any.
+    std::optional<double> utilization;
+};
+
+/**
+ * @brief The metrics of all the elements of a pipeline, in depth-first order from the source.
+ */
+using PipelineMetrics = std::vector<ElementMetricsSnapshot>;
+
+namespace impl {
+
+/**
+ * @brief Instrumentation of a single pipeline element. Client code does not need to use it.
+ *
+ * All the functions are no-ops when the instrumentation is disabled, in which case the class is
+ * empty and is meant to be declared as a `[[no_unique_address]]` member.
+ * Otherwise, counters are kept out of line, so that elements stay small and movable.
+ */
+template <bool Enabled = METRICS_ENABLED>
+class ElementMetrics {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void frames_in(uint64_t count = 1) {
+        add(state_->frames_in, count);
+    }
+
+    void frames_out(uint64_t count = 1) {
+        add(state_->frames_out, count);
+    }
+
+    void frames_dropped(uint64_t count = 1) {
+        add(state_->frames_dropped, count);
+    }
+
+    Clock::time_point now() const {
+        return Clock::now();
+    }
+
+    /**
+     * @brief Records the time elapsed since `begin`, spread over `count` frames.
+     */
+    void latency(Clock::time_point begin, uint64_t count = 1) {
+        if (count == 0) {
+            return;
+        }
+        state_->latency.record(elapsed_since(begin) / count, count);
+    }
+
+    void queue_depth(std::size_t depth) {
+        state_->queue_depth.store(depth, std::memory_order_relaxed);
+        if (depth > state_->peak_queue_depth.load(std::memory_order_relaxed)) {
+            state_->peak_queue_depth.store(depth, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Records the time elapsed since `begin` as time the owned thread has been busy.
+     *        Utilization is measured from the beginning of the first busy period.
+     */
+    void busy(Clock::time_point begin) {
+        if (state_->started.load(std::memory_order_relaxed) == 0) {
+            state_->started.store(begin.time_since_epoch().count(), std::memory_order_relaxed);
+        }
+        add(state_->busy_ns, elapsed_since(begin));
+    }
+
+    /**
+     * @brief Appends a snapshot of the metrics to `metrics`.
+     */
+    void collect(PipelineMetrics& metrics, const char* kind) const {
+        ElementMetricsSnapshot snapshot;
+        snapshot.kind = kind;
+        snapshot.frames_in = state_->frames_in.load(std::memory_order_relaxed);
+        snapshot.frames_out = state_->frames_out.load(std::memory_order_relaxed);
+        snapshot.frames_dropped = state_->frames_dropped.load(std::memory_order_relaxed);
+        snapshot.latency = state_->latency.snapshot();
+        snapshot.queue_depth = state_->queue_depth.load(std::memory_order_relaxed);
+        snapshot.peak_queue_depth = state_->peak_queue_depth.load(std::memory_order_relaxed);
+        const auto started = state_->started.load(std::memory_order_relaxed);
+        if (started != 0) {
+            const auto wall = now().time_since_epoch() - Clock::duration{started};
+            const auto busy = std::chrono::nanoseconds(
+                    state_->busy_ns.load(std::memory_order_relaxed));
+            if (wall.count() > 0) {
+                snapshot.utilization = std::chrono::duration<double>(busy).count()
+                                     / std::chrono::duration<double>(wall).count();
+            }
+        }
+        metrics.push_back(std::move(snapshot));
+    }
+
+private:
+    struct State {
+        std::atomic<uint64_t> frames_in{0};
+        std::atomic<uint64_t> frames_out{0};
+        std::atomic<uint64_t> frames_dropped{0};
+        LatencyHistogram latency;
+        std::atomic<std::size_t> queue_depth{0};
+        std::atomic<std::size_t> peak_queue_depth{0};
+        std::atomic<Clock::rep> started{0};
+        std::atomic<uint64_t> busy_ns{0};
+    };
+
+    // Counters have a single writer, so a plain load and store is enough.
+    static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    uint64_t elapsed_since(Clock::time_point begin) const {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now() - begin);
+        return static_cast<uint64_t>(elapsed.count());
+    }
+
+    std::unique_ptr<State> state_{std::make_unique<State>()};
+};
+
+template <>
+class ElementMetrics<false> {
+public:
+    struct Clock {
+        struct time_point {};
+    };
+
+    void frames_in(uint64_t = 1) {}
+    void frames_out(uint64_t = 1) {}
+    void frames_dropped(uint64_t = 1) {}
+    Clock::time_point now() const {
+        return {};
+    }
+    void latency(Clock::time_point, uint64_t = 1) {}
+    void queue_depth(std::size_t) {}
+    void busy(Clock::time_point) {}
+    void collect(PipelineMetrics&, const char*) const {}
+};
+
+} // namespace impl
+
+} // namespace dpipe
+
+#endif // DPIPE_METRICS_H_
@@ -24,6 +24,50 @@ public:
         return MutFrame<T>{Frame<T>::make(std::forward<Args>(args)...)};
     }
 
+    /**
+     * @brief Creates a new data object, drawing memory from a pool, and wraps it into a MutFrame.
+     */
+    template <typename... Args>
+    static MutFrame<T> make(FramePool<T>& pool, Args&&... args) {
+        return MutFrame<T>{Frame<T>::make(pool, std::forward<Args>(args)...)};
+    }
+
+    /**
+     * @brief Wraps a data object allocated outside the frame into a MutFrame, without copying it
+     *        (see `Frame::adopt`). The caller must not access the data object any more, until the
+     *        releaser is called.
+     */
+    template <typename Releaser>
+    static MutFrame<T> adopt(T* data, Releaser releaser) {
+        return MutFrame<T>{Frame<T>::adopt(data, std::move(releaser))};
+    }
+
+    /**
+     * @brief Consumes a Frame creating a MutFrame (copy-on-write).
+     *        If the Frame holds the only reference, the data object is reused in place;
+     *        otherwise (_e.g._, after a Splitter), it is deep-copied into a new data object.
+     */
+    static MutFrame<T> from(Frame<T>&& frame) {
+        if (frame.is_unique()) {
+            return MutFrame<T>{std::move(frame)};
+        }
+        auto copy = make(*frame);
+        copy.set_header(frame.header());
+        return copy;
+    }
+
+    /**
+     * @brief Same as above, but drawing memory from a pool if a deep copy is needed.
+     */
+    static MutFrame<T> from(Frame<T>&& frame, FramePool<T>& pool) {
+        if (frame.is_unique()) {
+            return MutFrame<T>{std::move(frame)};
+        }
+        auto copy = make(pool, *frame);
+        copy.set_header(frame.header());
+        return copy;
+    }
+
     ~MutFrame() = default;
 
     // We do not want multiple mutable references to the same frame.
@@ -61,6 +105,20 @@ public:
         return &frame_.inner(FrameAccessKey{});
     }
 
+    /**
+     * @brief Returns the header of the frame (see `Frame::header`).
+     */
+    const FrameHeader& header() const {
+        return frame_.header();
+    }
+
+    /**
+     * @brief Replaces the header of the frame (see `Frame::set_header`).
+     */
+    void set_header(const FrameHeader& header) {
+        frame_.set_header(header);
+    }
+
     /**
      * @brief Consumes the MutFrame creating a Frame, making the
      *        inner data object immutable.
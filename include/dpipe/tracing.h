@@ -0,0 +1,468 @@
+#ifndef DPIPE_TRACING_H_
+#define DPIPE_TRACING_H_
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+#include <dpipe/frame.h>
+
+/**
+ * @brief Define to 1 to compile the tracing of pipeline elements in, to be enabled at run time
+ *        with `enable_tracing`. When not defined (the default), tracing compiles to nothing.
+ *        It must have the same value in every translation unit.
+ */
+#ifndef DPIPE_ENABLE_TRACING
+#define DPIPE_ENABLE_TRACING 0
+#endif
+
+namespace dpipe {
+
+/// @brief Whether the tracing of pipeline elements is compiled in.
+inline constexpr bool TRACING_ENABLED = DPIPE_ENABLE_TRACING != 0;
+
+/**
+ * @brief An event recorded by a pipeline element while tracing.
+ */
+struct TraceEvent {
+    using Clock = std::chrono::steady_clock;
+
+    enum class Phase : char {
+        /// The implementation of an element (`produce`, `process` or `consume`) ran.
+        Span = 'X',
+        /// The frame entered a queue, _e.g._, of a decoupler.
+        QueueBegin = 'b',
+        /// The frame left the queue, or was discarded by it.
+        QueueEnd = 'e',
+    };
+
+    /// @brief Kind of element, _e.g._, "Filter", or the `TRACE_NAME` of its implementation.
+    const char* name{};
+    Phase phase{Phase::Span};
+    /// @brief Identifier of the frame, made of the source and the sequence number of its header
+    ///        (see `trace_id`), or the one of the first frame of a batch. Filters carry it over
+    ///        to their output frames.
+    uint64_t frame{};
+    /// @brief Number of frames, greater than one for batches.
+    uint32_t count{1};
+    /// @brief Identifier of the thread, in the order threads recorded their first event.
+    uint32_t thread{};
+    Clock::time_point begin{};
+    /// @brief Duration of the span, zero for queue events.
+    std::chrono::nanoseconds duration{};
+};
+
+/**
+ * @brief A thread that recorded trace events.
+ */
+struct TraceThread {
+    uint32_t id{};
+    /// @brief Name of the thread, when it recorded its first event (see ThreadOptions), if any.
+    std::string name;
+};
+
+namespace impl {
+
+/**
+ * @brief A ring buffer of the latest trace events recorded by a thread, which is the only writer.
+ *        Events can be read by any thread at any time: those overwritten while being read are
+ *        skipped.
+ */
+class TraceBuffer {
+public:
+    TraceBuffer(std::size_t capacity, uint32_t thread, std::string name)
+            // One more record, which the writer may be overwriting while the others are read.
+            : capacity_{std::bit_ceil(capacity + 1)}
+            , records_{std::make_unique<Record[]>(capacity_)}
+            , thread_{thread, std::move(name)} {}
+
+    void write(const char* name, TraceEvent::Phase phase, uint64_t frame, uint32_t count,
+               TraceEvent::Clock::time_point begin, TraceEvent::Clock::time_point end) {
+        const auto head = head_.load(std::memory_order_relaxed);
+        auto& record = records_[head & (capacity_ - 1)];
+        // Pairs with the acquire fence of `read`: a reader seeing any of the stores below also
+        // sees the previous head, and thus skips the record being overwritten.
+        std::atomic_thread_fence(std::memory_order_release);
+        record.name.store(name, std::memory_order_relaxed);
+        record.phase_count.store(static_cast<uint64_t>(phase) << 32 | count,
+                                 std::memory_order_relaxed);
+        record.frame.store(frame, std::memory_order_relaxed);
+        record.begin.store(begin.time_since_epoch().count(), std::memory_order_relaxed);
+        record.end.store(end.time_since_epoch().count(), std::memory_order_relaxed);
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Appends the events that began within the time window to `events`.
+     */
+    void read(std::vector<TraceEvent>& events, TraceEvent::Clock::time_point since,
+              TraceEvent::Clock::time_point until) const {
+        const auto head = head_.load(std::memory_order_acquire);
+        const auto oldest = head - std::min<uint64_t>(head, capacity_);
+        std::vector<TraceEvent> records;
+        records.reserve(static_cast<std::size_t>(head - oldest));
+        for (auto index = oldest; index < head; ++index) {
+            const auto& record = records_[index & (capacity_ - 1)];
+            const auto phase_count = record.phase_count.load(std::memory_order_relaxed);
+            const TraceEvent::Clock::time_point begin{
+                    TraceEvent::Clock::duration{record.begin.load(std::memory_order_relaxed)}};
+            const TraceEvent::Clock::time_point end{
+                    TraceEvent::Clock::duration{record.end.load(std::memory_order_relaxed)}};
+            TraceEvent event;
+            event.name = record.name.load(std::memory_order_relaxed);
+            event.phase = static_cast<TraceEvent::Phase>(phase_count >> 32);
+            event.frame = record.frame.load(std::memory_order_relaxed);
+            event.count = static_cast<uint32_t>(phase_count);
+            event.thread = thread_.id;
+            event.begin = begin;
+            event.duration = end - begin;
+            records.push_back(event);
+        }
+        // Records the writer has gone back to, including the one it may be writing, are skipped.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const auto next = head_.load(std::memory_order_relaxed) + 1;
+        const auto valid = next - std::min<uint64_t>(next, capacity_);
+        for (auto index = std::max(oldest, valid); index < head; ++index) {
+            const auto& event = records[static_cast<std::size_t>(index - oldest)];
+            if (event.begin >= since && event.begin <= until) {
+                events.push_back(event);
+            }
+        }
+    }
+
+    const TraceThread& thread() const {
+        return thread_;
+    }
+
+private:
+    // Fields are atomic so that concurrent reads are well-defined, but only the head orders them.
+    struct Record {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> phase_count{0};
+        std::atomic<uint64_t> frame{0};
+        std::atomic<TraceEvent::Clock::rep> begin{0};
+        std::atomic<TraceEvent::Clock::rep> end{0};
+    };
+
+    const std::size_t capacity_;
+    const std::unique_ptr<Record[]> records_;
+    const TraceThread thread_;
+    std::atomic<uint64_t> head_{0};
+};
+
+/// @brief Whether trace events are being recorded.
+inline std::atomic<bool> trace_enabled{false};
+
+/// @brief Incremented when the buffers are dropped, so that threads register new ones.
+inline std::atomic<uint64_t> trace_generation{0};
+
+/**
+ * @brief The buffers of every thread that recorded trace events.
+ */
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+    std::size_t capacity{16384};
+    uint32_t next_thread{0};
+};
+
+inline TraceRegistry& trace_registry() {
+    static TraceRegistry registry;
+    return registry;
+}
+
+inline std::string current_thread_name() {
+#if defined(__linux__)
+    char name[16] = {};
+    if (pthread_getname_np(pthread_self(), name, sizeof(name)) == 0) {
+        return name;
+    }
+#endif
+    return {};
+}
+
+// Registers a new buffer for the calling thread, which owns it along with the registry.
+inline TraceBuffer* register_trace_buffer(uint64_t& generation) {
+    thread_local std::shared_ptr<TraceBuffer> buffer;
+    auto& registry = trace_registry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    buffer = std::make_shared<TraceBuffer>(registry.capacity, registry.next_thread++,
+                                           current_thread_name());
+    registry.buffers.push_back(buffer);
+    generation = trace_generation.load(std::memory_order_relaxed);
+    return buffer.get();
+}
+
+/**
+ * @brief Returns the buffer of the calling thread, registering it on first use.
+ */
+inline TraceBuffer& trace_buffer() {
+    // Plain values, so that accessing them does not go through the initialization of the owner.
+    thread_local TraceBuffer* buffer = nullptr;
+    thread_local uint64_t generation = 0;
+    if (buffer == nullptr || generation != trace_generation.load(std::memory_order_acquire)) {
+        buffer = register_trace_buffer(generation);
+    }
+    return *buffer;
+}
+
+/**
+ * @brief Returns the identifier of a frame in trace events, assigned by its source: the
+ *        identifier of the source in the upper 24 bits, so that frames merged from several
+ *        sources are told apart, and the sequence number in the lower 40 bits.
+ */
+template <typename T>
+uint64_t trace_id(const Frame<T>& frame) {
+    static constexpr int SEQUENCE_BITS = 40;
+    const auto& header = frame.header();
+    return static_cast<uint64_t>(header.source) << SEQUENCE_BITS
+           | (header.sequence & ((uint64_t{1} << SEQUENCE_BITS) - 1));
+}
+
+/**
+ * @brief Returns the `TRACE_NAME` of an element implementation, if defined, or the kind of element.
+ */
+template <typename Impl>
+constexpr const char* trace_name(const char* kind) {
+    if constexpr (requires { Impl::TRACE_NAME; }) {
+        return Impl::TRACE_NAME;
+    } else {
+        return kind;
+    }
+}
+
+/**
+ * @brief Tracing of a single pipeline element. Client code does not need to use it.
+ *
+ * All the functions are no-ops when tracing is not compiled in, in which case the class is
+ * empty and is meant to be declared as a `[[no_unique_address]]` member. Otherwise, events are
+ * recorded only while tracing is enabled at run time, which costs a relaxed load when it is not.
+ */
+template <bool Enabled = TRACING_ENABLED>
+class ElementTracer {
+public:
+    using Clock = TraceEvent::Clock;
+
+    /**
+     * @brief Returns the current time if tracing is enabled, or the epoch otherwise.
+     */
+    Clock::time_point now() const {
+        if (!trace_enabled.load(std::memory_order_relaxed)) {
+            return {};
+        }
+        return Clock::now();
+    }
+
+    template <typename T>
+    uint64_t id(const Frame<T>& frame) const {
+        return trace_id(frame);
+    }
+
+    template <typename T>
+    uint64_t id(std::span<Frame<T>> frames) const {
+        return frames.empty() ? 0 : trace_id(frames.front());
+    }
+
+    /**
+     * @brief Records a span of the given frames from `begin` to now, unless tracing was not
+     *        enabled at `begin`.
+     */
+    void span(const char* name, uint64_t frame, Clock::time_point begin,
+              std::size_t count = 1) const {
+        if (begin == Clock::time_point{}) {
+            return;
+        }
+        trace_buffer().write(name, TraceEvent::Phase::Span, frame, static_cast<uint32_t>(count),
+                             begin, Clock::now());
+    }
+
+    /**
+     * @brief Records that a frame entered or left a queue.
+     */
+    void queue(const char* name, TraceEvent::Phase phase, uint64_t frame) const {
+        if (!trace_enabled.load(std::memory_order_relaxed)) {
+            return;
+        }
+        const auto now = Clock::now();
+        trace_buffer().write(name, phase, frame, 1, now, now);
+    }
+};
+
+template <>
+class ElementTracer<false> {
+public:
+    struct Clock {
+        struct time_point {};
+    };
+
+    Clock::time_point now() const {
+        return {};
+    }
+    template <typename T>
+    uint64_t id(const Frame<T>&) const {
+        return 0;
+    }
+    template <typename T>
+    uint64_t id(std::span<Frame<T>>) const {
+        return 0;
+    }
+    void span(const char*, uint64_t, Clock::time_point, std::size_t = 1) const {}
+    void queue(const char*, TraceEvent::Phase, uint64_t) const {}
+};
+
+// Writes a time point or a duration, in microseconds with a nanosecond resolution.
+inline void write_microseconds(std::ostream& out, std::chrono::nanoseconds value) {
+    const auto count = value.count();
+    const auto fraction = std::to_string(1000 + (count < 0 ? -count : count) % 1000);
+    out << (count < 0 ? "-" : "") << (count < 0 ? -count : count) / 1000 << '.'
+        << fraction.substr(1);
+}
+
+inline void write_json_string(std::ostream& out, std::string_view value) {
+    out << '"';
+    for (const char c : value) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) >= 0x20) {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace impl
+
+/**
+ * @brief Starts recording trace events, if tracing is compiled in (see `DPIPE_ENABLE_TRACING`).
+ *
+ * @param events_per_thread Minimum number of latest events kept by every thread (rounded up to a
+ *                          power of two, minus one). It only applies to
+ *                          threads recording their first event afterwards, or after
+ *                          `clear_trace`.
+ */
+inline void enable_tracing(std::size_t events_per_thread = 16384) {
+    {
+        auto& registry = impl::trace_registry();
+        std::lock_guard<std::mutex> lock{registry.mutex};
+        registry.capacity = events_per_thread;
+    }
+    impl::trace_enabled.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Stops recording trace events. The events already recorded are kept.
+ */
+inline void disable_tracing() {
+    impl::trace_enabled.store(false, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns whether trace events are being recorded.
+ */
+inline bool tracing_enabled() {
+    return TRACING_ENABLED && impl::trace_enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Drops every event recorded so far, as well as the buffers of exited threads.
+ */
+inline void clear_trace() {
+    auto& registry = impl::trace_registry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    registry.buffers.clear();
+    impl::trace_generation.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @brief Returns the recorded events that began within the time window, sorted by time, without
+ *        stopping the threads recording them.
+ */
+inline std::vector<TraceEvent> collect_trace(
+        TraceEvent::Clock::time_point since = TraceEvent::Clock::time_point::min(),
+        TraceEvent::Clock::time_point until = TraceEvent::Clock::time_point::max()) {
+    std::vector<TraceEvent> events;
+    auto& registry = impl::trace_registry();
+    {
+        std::lock_guard<std::mutex> lock{registry.mutex};
+        for (const auto& buffer : registry.buffers) {
+            buffer->read(events, since, until);
+        }
+    }
+    std::stable_sort(events.begin(), events.end(),
+                     [](const TraceEvent& a, const TraceEvent& b) { return a.begin < b.begin; });
+    return events;
+}
+
+/**
+ * @brief Returns the threads that recorded events.
+ */
+inline std::vector<TraceThread> trace_threads() {
+    std::vector<TraceThread> threads;
+    auto& registry = impl::trace_registry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    for (const auto& buffer : registry.buffers) {
+        threads.push_back(buffer->thread());
+    }
+    return threads;
+}
+
+/**
+ * @brief Writes the recorded events that began within the time window in the Chrome trace event
+ *        format (JSON), which `chrome://tracing` and the Perfetto UI open.
+ *
+ * Spans are complete events ("X") on the track of their thread, while the time a frame spent in a
+ * queue is an asynchronous event ("b" and "e") identified by the frame.
+ */
+inline void write_chrome_trace(
+        std::ostream& out,
+        TraceEvent::Clock::time_point since = TraceEvent::Clock::time_point::min(),
+        TraceEvent::Clock::time_point until = TraceEvent::Clock::time_point::max()) {
+    const auto events = collect_trace(since, until);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& thread : trace_threads()) {
+        if (thread.name.empty()) {
+            continue;
+        }
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+            << thread.id << ",\"args\":{\"name\":";
+        impl::write_json_string(out, thread.name);
+        out << "}}";
+        first = false;
+    }
+    for (const auto& event : events) {
+        out << (first ? "" : ",") << "\n{\"name\":";
+        impl::write_json_string(out, event.name);
+        out << ",\"cat\":\"dpipe\",\"ph\":\"" << static_cast<char>(event.phase)
+            << "\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":";
+        impl::write_microseconds(out, event.begin.time_since_epoch());
+        if (event.phase == TraceEvent::Phase::Span) {
+            out << ",\"dur\":";
+            impl::write_microseconds(out, event.duration);
+        } else {
+            out << ",\"id\":\"0x" << std::hex << event.frame << std::dec << '"';
+        }
+        out << ",\"args\":{\"frame\":\"0x" << std::hex << event.frame << std::dec
+            << "\",\"count\":" << event.count << "}}";
+        first = false;
+    }
+    out << "\n]}\n";
+}
+
+} // namespace dpipe
+
+#endif // DPIPE_TRACING_H_
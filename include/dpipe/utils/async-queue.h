@@ -1,10 +1,12 @@
 #ifndef DPIPE_UTILS_ASYNC_QUEUE_H_
 #define DPIPE_UTILS_ASYNC_QUEUE_H_
 
+#include <condition_variable>
+#include <cstddef>
 #include <deque>
+#include <limits>
 #include <mutex>
 #include <optional>
-#include <thread>
 
 namespace dpipe {
 
@@ -18,35 +20,118 @@ class AsyncQueue {
 public:
     using ElementType = T;
 
+    /**
+     * @brief Constructor.
+     *
+     * @param capacity Maximum number of elements held by the queue. Unbounded by default.
+     */
+    explicit AsyncQueue(std::size_t capacity = std::numeric_limits<std::size_t>::max())
+            : capacity_{capacity} {}
+
     std::optional<T> try_pop_front() {
         std::lock_guard<std::mutex> lock{mutex_};
         if (queue_.empty()) {
             return {};
         }
-        T element = queue_.front();
+        T element = std::move(queue_.front());
         queue_.pop_front();
         return element;
     }
 
     template <typename Duration>
     std::optional<T> try_pop_front_for(Duration duration) {
-        auto option = try_pop_front();
-        if (!option.has_value()) {
-            // We are obviously cheating: this is only a quick emulation
-            // of what should be done with semaphores.
-            std::this_thread::sleep_for(duration);
+        std::unique_lock<std::mutex> lock{mutex_};
+        if (!not_empty_.wait_for(lock, duration, [this] { return !queue_.empty(); })) {
+            return {};
         }
-        return option;
+        T element = std::move(queue_.front());
+        queue_.pop_front();
+        return element;
     }
 
+    /**
+     * @brief Appends an element, regardless of the queue capacity.
+     */
     void push_back(T&& t) {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            queue_.push_back(std::move(t));
+        }
+        not_empty_.notify_one();
+    }
+
+    /**
+     * @brief Appends an element, unless the queue is full.
+     *
+     * @return `true` if the element has been enqueued, `false` if the queue is full and
+     *         the element has been left untouched.
+     */
+    bool try_push_back(T&& t) {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            if (queue_.size() >= capacity_) {
+                return false;
+            }
+            queue_.push_back(std::move(t));
+        }
+        not_empty_.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Appends an element, removing the first one if the queue is full.
+     *
+     * @return The removed element, if any. It is returned, rather than destroyed,
+     *         so that it is not destroyed while holding the lock.
+     */
+    std::optional<T> push_back_evicting(T&& t) {
+        std::optional<T> evicted;
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            if (queue_.size() >= capacity_ && !queue_.empty()) {
+                evicted.emplace(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+            queue_.push_back(std::move(t));
+        }
+        not_empty_.notify_one();
+        return evicted;
+    }
+
+    /**
+     * @brief Replaces all the elements in the queue with the given one.
+     *
+     * @return The number of removed elements. They are destroyed once the lock is released.
+     */
+    std::size_t push_back_replacing(T&& t) {
+        std::deque<T> replaced;
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            replaced.swap(queue_);
+            queue_.push_back(std::move(t));
+        }
+        not_empty_.notify_one();
+        return replaced.size();
+    }
+
+    std::size_t capacity() const {
+        return capacity_;
+    }
+
+    std::size_t size() const {
         std::lock_guard<std::mutex> lock{mutex_};
-        queue_.push_back(std::move(t));
+        return queue_.size();
+    }
+
+    bool empty() const {
+        return size() == 0;
     }
 
 private:
+    const std::size_t capacity_;
     std::deque<T> queue_;
-    std::mutex mutex_;
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
 };
 
 } // namespace dpipe
@@ -0,0 +1,181 @@
+#ifndef DPIPE_UTILS_COROUTINE_H_
+#define DPIPE_UTILS_COROUTINE_H_
+
+#include <cassert>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace dpipe {
+
+template <typename T>
+class Async;
+
+namespace impl {
+
+/**
+ * @brief Promise type shared by every Async coroutine: it starts suspended and, once done, resumes
+ *        the coroutine awaiting it, if any.
+ */
+struct AsyncPromiseBase {
+    struct FinalAwaiter {
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            const auto continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() const noexcept {
+        return {};
+    }
+
+    void unhandled_exception() const noexcept {
+        std::terminate();
+    }
+
+    std::coroutine_handle<> continuation{};
+};
+
+template <typename T>
+struct AsyncPromise : AsyncPromiseBase {
+    Async<T> get_return_object();
+
+    void return_value(T value) {
+        result.emplace(std::move(value));
+    }
+
+    std::optional<T> result{};
+};
+
+template <>
+struct AsyncPromise<void> : AsyncPromiseBase {
+    Async<void> get_return_object();
+
+    void return_void() const {}
+};
+
+} // namespace impl
+
+/**
+ * @brief A lazily-started coroutine producing a value of type `T`, used by asynchronous element
+ *        implementations (see AsyncSource and AsyncFilter).
+ *
+ * An Async coroutine does not run until it is awaited by another coroutine, which is resumed as
+ * soon as the awaited one returns, or until it is started by its owner.
+ * Exceptions escaping the coroutine terminate the program.
+ *
+ * @code
+ * dpipe::Async<std::optional<dpipe::Frame<Sample>>> produce() {
+ *     co_await loop_->readable(fd_);
+ *     co_return dpipe::Frame<Sample>::make(read_sample(fd_));
+ * }
+ * @endcode
+ *
+ * @tparam T The type of the value returned by the coroutine, or `void`.
+ */
+template <typename T = void>
+class [[nodiscard]] Async {
+public:
+    using promise_type = impl::AsyncPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Async() = default;
+
+    explicit Async(Handle handle)
+            : handle_{handle} {}
+
+    ~Async() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    Async(const Async& other) = delete;
+    Async& operator=(const Async& other) = delete;
+
+    Async(Async&& other) noexcept
+            : handle_{std::exchange(other.handle_, {})} {}
+
+    Async& operator=(Async&& other) noexcept {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Returns whether the object holds a coroutine.
+     */
+    bool valid() const {
+        return static_cast<bool>(handle_);
+    }
+
+    /**
+     * @brief Returns whether the coroutine has returned.
+     */
+    bool done() const {
+        return handle_ && handle_.done();
+    }
+
+    /**
+     * @brief Runs the coroutine on the calling thread, until its first suspension point, without
+     *        any coroutine to resume once done. To be called once, in place of awaiting it.
+     */
+    void start() {
+        assert(handle_ && !handle_.done());
+        handle_.resume();
+    }
+
+    bool await_ready() const noexcept {
+        return !handle_ || handle_.done();
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+
+    T await_resume() {
+        assert(done());
+        if constexpr (!std::is_void_v<T>) {
+            assert(handle_.promise().result.has_value());
+            return std::move(*handle_.promise().result);
+        }
+    }
+
+private:
+    Handle handle_{};
+};
+
+namespace impl {
+
+template <typename T>
+Async<T> AsyncPromise<T>::get_return_object() {
+    return Async<T>{std::coroutine_handle<AsyncPromise<T>>::from_promise(*this)};
+}
+
+inline Async<void> AsyncPromise<void>::get_return_object() {
+    return Async<void>{std::coroutine_handle<AsyncPromise<void>>::from_promise(*this)};
+}
+
+} // namespace impl
+
+} // namespace dpipe
+
+#endif // DPIPE_UTILS_COROUTINE_H_
@@ -0,0 +1,349 @@
+#ifndef DPIPE_UTILS_EVENT_LOOP_H_
+#define DPIPE_UTILS_EVENT_LOOP_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <iterator>
+#include <list>
+#include <map>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <dpipe/utils/executor.h>
+#include <dpipe/utils/thread-options.h>
+
+namespace dpipe {
+
+/**
+ * @brief A single-threaded event loop resuming coroutines (see Async) once the file descriptors
+ *        or the timers they await are ready, so that many I/O-bound elements share one thread.
+ *
+ * Awaitables returned by `readable`, `writable`, `sleep_until`, `sleep_for` and `yield` must be
+ * awaited by coroutines running on the loop thread. Destroying a coroutine suspended on any of
+ * them, which is only allowed on the loop thread as well, cancels the wait.
+ * Tasks posted from any thread run on the loop thread, in order, between readiness checks, once
+ * their time is reached for the delayed ones.
+ */
+class EventLoop : public Executor {
+public:
+    /**
+     * @brief Constructor. It spawns the loop thread.
+     *
+     * @param thread Options of the loop thread.
+     */
+    explicit EventLoop(ThreadOptions thread = {}) {
+        [[maybe_unused]] const int result = ::pipe(wake_);
+        assert(result == 0);
+        for (int fd : wake_) {
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        thread_ = std::jthread{[this, thread = std::move(thread)](std::stop_token token) {
+            apply_thread_options(thread);
+            loop_thread_.store(std::this_thread::get_id());
+            while (!token.stop_requested()) {
+                iterate(true);
+            }
+        }};
+    }
+
+    /**
+     * @brief Destructor. Pending tasks are discarded, the running one is waited for.
+     *        Coroutines still suspended on the loop are not resumed any more.
+     */
+    ~EventLoop() override {
+        thread_.request_stop();
+        wake();
+        thread_ = {};
+        ::close(wake_[0]);
+        ::close(wake_[1]);
+    }
+
+    EventLoop(const EventLoop& other) = delete;
+    EventLoop& operator=(const EventLoop& other) = delete;
+
+    EventLoop(EventLoop&& other) = delete;
+    EventLoop& operator=(EventLoop&& other) = delete;
+
+    void post(Task&& task) override {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            posted_.push_back(std::move(task));
+        }
+        wake();
+    }
+
+    void post_at(Clock::time_point time, Task&& task) override {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            delayed_.emplace(time, std::move(task));
+        }
+        // Lets the loop wait for the new deadline.
+        wake();
+    }
+
+    /**
+     * @brief Runs the pending tasks and resumes the coroutines whose file descriptors or timers are
+     *        ready, without blocking. It does nothing unless called by the loop thread.
+     */
+    bool run_one() override {
+        return in_loop() && iterate(false);
+    }
+
+    /**
+     * @brief Runs the loop from the loop thread itself, _e.g._, from a coroutine, until the
+     *        condition holds. The condition is checked before blocking for events.
+     */
+    template <typename Condition>
+    void run_until(Condition&& condition) {
+        assert(in_loop());
+        while (!condition()) {
+            iterate(true);
+        }
+    }
+
+    /**
+     * @brief Returns whether the calling thread is the loop thread.
+     */
+    bool in_loop() const {
+        return loop_thread_.load(std::memory_order_relaxed) == std::this_thread::get_id();
+    }
+
+    /**
+     * @brief An awaitable suspending the calling coroutine until a file descriptor is ready.
+     *        `co_await` returns the events reported by `poll`, including `POLLHUP` and `POLLERR`.
+     */
+    class FdAwaiter {
+    public:
+        FdAwaiter(EventLoop& loop, int fd, short events)
+                : loop_{loop}
+                , fd_{fd}
+                , events_{events} {}
+
+        ~FdAwaiter() {
+            if (handle_) {
+                loop_.fd_waiters_.erase(position_);
+            }
+            loop_.unqueue(queued_);
+        }
+
+        FdAwaiter(const FdAwaiter& other) = delete;
+        FdAwaiter& operator=(const FdAwaiter& other) = delete;
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            assert(loop_.in_loop());
+            handle_ = handle;
+            position_ = loop_.fd_waiters_.insert(loop_.fd_waiters_.end(), this);
+        }
+
+        short await_resume() const noexcept {
+            return revents_;
+        }
+
+    private:
+        friend class EventLoop;
+
+        EventLoop& loop_;
+        int fd_;
+        short events_;
+        short revents_{0};
+        // Set while registered with the loop.
+        std::coroutine_handle<> handle_{};
+        std::list<FdAwaiter*>::iterator position_{};
+        // Set while ready, but not resumed yet.
+        std::coroutine_handle<> queued_{};
+    };
+
+    /**
+     * @brief An awaitable suspending the calling coroutine until a point in time.
+     */
+    class TimerAwaiter {
+    public:
+        TimerAwaiter(EventLoop& loop, Clock::time_point deadline)
+                : loop_{loop}
+                , deadline_{deadline} {}
+
+        ~TimerAwaiter() {
+            if (handle_) {
+                loop_.timers_.erase(position_);
+            }
+            loop_.unqueue(queued_);
+        }
+
+        TimerAwaiter(const TimerAwaiter& other) = delete;
+        TimerAwaiter& operator=(const TimerAwaiter& other) = delete;
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            assert(loop_.in_loop());
+            handle_ = handle;
+            position_ = loop_.timers_.emplace(deadline_, this);
+        }
+
+        void await_resume() const noexcept {}
+
+    private:
+        friend class EventLoop;
+
+        EventLoop& loop_;
+        Clock::time_point deadline_;
+        // Set while registered with the loop.
+        std::coroutine_handle<> handle_{};
+        std::multimap<Clock::time_point, TimerAwaiter*>::iterator position_{};
+        // Set while ready, but not resumed yet.
+        std::coroutine_handle<> queued_{};
+    };
+
+    FdAwaiter readable(int fd) {
+        return FdAwaiter{*this, fd, POLLIN};
+    }
+
+    FdAwaiter writable(int fd) {
+        return FdAwaiter{*this, fd, POLLOUT};
+    }
+
+    TimerAwaiter sleep_until(Clock::time_point deadline) {
+        return TimerAwaiter{*this, deadline};
+    }
+
+    template <typename Rep, typename Period>
+    TimerAwaiter sleep_for(std::chrono::duration<Rep, Period> duration) {
+        return TimerAwaiter{*this, Clock::now() + duration};
+    }
+
+    /**
+     * @brief Returns an awaitable letting the other coroutines ready on the loop run first.
+     */
+    TimerAwaiter yield() {
+        return TimerAwaiter{*this, Clock::time_point{}};
+    }
+
+private:
+    void wake() {
+        // A full pipe already wakes the loop up.
+        const char byte = 0;
+        [[maybe_unused]] const auto written = ::write(wake_[1], &byte, 1);
+    }
+
+    void queue(std::coroutine_handle<>& queued, std::coroutine_handle<> handle) {
+        queued = handle;
+        ready_.push_back(&queued);
+    }
+
+    // Cancels the resumption of a ready coroutine, destroyed before being resumed.
+    void unqueue(std::coroutine_handle<>& queued) {
+        if (queued) {
+            ready_.erase(std::find(ready_.begin(), ready_.end(), &queued));
+        }
+    }
+
+    // Runs the posted tasks and the delayed ones that are due, then waits for events, unless
+    // `block` is false or tasks have run, and resumes the coroutines that are ready. Returns
+    // whether anything has run.
+    bool iterate(bool block) {
+        std::vector<Task> tasks;
+        auto deadline = Clock::time_point::max();
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            tasks.swap(posted_);
+            if (!delayed_.empty()) {
+                const auto now = Clock::now();
+                while (!delayed_.empty() && delayed_.begin()->first <= now) {
+                    tasks.push_back(std::move(delayed_.begin()->second));
+                    delayed_.erase(delayed_.begin());
+                }
+                if (!delayed_.empty()) {
+                    deadline = delayed_.begin()->first;
+                }
+            }
+        }
+        for (auto& task : tasks) {
+            task();
+        }
+        if (!timers_.empty()) {
+            deadline = std::min(deadline, timers_.begin()->first);
+        }
+        int timeout = -1;
+        if (!block || !tasks.empty() || !ready_.empty()) {
+            timeout = 0;
+        } else if (deadline != Clock::time_point::max()) {
+            const auto left = deadline - Clock::now();
+            // Rounded up, so that the loop does not wake up before the deadline.
+            timeout = static_cast<int>(std::max<Clock::rep>(
+                    0, std::chrono::ceil<std::chrono::milliseconds>(left).count()));
+        }
+        pollfds_.clear();
+        pollfds_.push_back({wake_[0], POLLIN, 0});
+        for (auto* waiter : fd_waiters_) {
+            pollfds_.push_back({waiter->fd_, waiter->events_, 0});
+        }
+        ::poll(pollfds_.data(), static_cast<nfds_t>(pollfds_.size()), timeout);
+        if (pollfds_[0].revents != 0) {
+            char bytes[64];
+            while (::read(wake_[0], bytes, sizeof(bytes)) > 0) {
+            }
+        }
+        // Coroutines are resumed once every ready one is unregistered, as they may register again.
+        // Those left when a coroutine runs the loop through `run_until` are resumed by the nested
+        // iterations.
+        auto waiter = fd_waiters_.begin();
+        for (std::size_t i = 1; i < pollfds_.size(); ++i) {
+            auto* current = *waiter;
+            waiter = std::next(waiter);
+            if (pollfds_[i].revents != 0) {
+                current->revents_ = pollfds_[i].revents;
+                queue(current->queued_, std::exchange(current->handle_, {}));
+                fd_waiters_.erase(current->position_);
+            }
+        }
+        const auto now = Clock::now();
+        while (!timers_.empty() && timers_.begin()->first <= now) {
+            auto* timer = timers_.begin()->second;
+            queue(timer->queued_, std::exchange(timer->handle_, {}));
+            timers_.erase(timers_.begin());
+        }
+        const bool resumed = !ready_.empty();
+        while (!ready_.empty()) {
+            auto* queued = ready_.front();
+            ready_.pop_front();
+            std::exchange(*queued, {}).resume();
+        }
+        return resumed || !tasks.empty();
+    }
+
+    int wake_[2]{-1, -1};
+    std::mutex mutex_;
+    std::vector<Task> posted_;
+    std::multimap<Clock::time_point, Task> delayed_;
+    std::atomic<std::thread::id> loop_thread_{};
+    // Only accessed by the loop thread.
+    std::list<FdAwaiter*> fd_waiters_;
+    std::multimap<Clock::time_point, TimerAwaiter*> timers_;
+    std::vector<pollfd> pollfds_;
+    // Handles of the coroutines ready to be resumed, owned by their awaiters.
+    std::deque<std::coroutine_handle<>*> ready_;
+    std::jthread thread_;
+};
+
+} // namespace dpipe
+
+#endif // DPIPE_UTILS_EVENT_LOOP_H_
@@ -0,0 +1,44 @@
+#ifndef DPIPE_UTILS_EXECUTOR_H_
+#define DPIPE_UTILS_EXECUTOR_H_
+
+#include <chrono>
+#include <functional>
+
+namespace dpipe {
+
+/**
+ * @brief An interface for objects running tasks on behalf of pipelines and decouplers, in place of
+ *        their dedicated threads.
+ */
+class Executor {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Task = std::function<void()>;
+
+    virtual ~Executor() = default;
+
+    /**
+     * @brief Schedules a task to be run. It can be called from any thread, including from
+     *        inside a running task.
+     */
+    virtual void post(Task&& task) = 0;
+
+    /**
+     * @brief Schedules a task to be run once a point in time is reached, without holding any
+     *        thread until then. It can be called from any thread, including from inside a
+     *        running task.
+     */
+    virtual void post_at(Clock::time_point time, Task&& task) = 0;
+
+    /**
+     * @brief Runs a pending task, if any, on the calling thread.
+     *        A task waiting for another one to make progress calls it to avoid deadlocks.
+     *
+     * @return `true` if a task has been run.
+     */
+    virtual bool run_one() = 0;
+};
+
+} // namespace dpipe
+
+#endif // DPIPE_UTILS_EXECUTOR_H_
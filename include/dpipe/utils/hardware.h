@@ -0,0 +1,35 @@
+#ifndef DPIPE_UTILS_HARDWARE_H_
+#define DPIPE_UTILS_HARDWARE_H_
+
+#include <cstddef>
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#endif
+
+namespace dpipe {
+
+/**
+ * @brief Size in bytes of a cache line, used to keep data written by different threads apart.
+ *
+ * `std::hardware_destructive_interference_size` is not used on purpose: its value may change
+ * between compiler flags, which would make it unsafe in a header-only library.
+ */
+inline constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * @brief Hints the processor that the calling thread is busy-waiting.
+ */
+inline void cpu_relax() {
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+    _mm_pause();
+#endif
+}
+
+} // namespace dpipe
+
+#endif // DPIPE_UTILS_HARDWARE_H_
@@ -0,0 +1,149 @@
+#ifndef DPIPE_UTILS_MPSC_QUEUE_H_
+#define DPIPE_UTILS_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+
+#include <dpipe/utils/hardware.h>
+
+namespace dpipe {
+
+/**
+ * @brief A bounded, lock-free, multi-producer/single-consumer queue backed by a ring buffer.
+ *
+ * Any number of threads may push concurrently, but only one thread may pop at any given time.
+ * Every slot carries a sequence number telling whether it is free for the producer claiming it or
+ * filled for the consumer, so that producers only contend on claiming the tail index and the
+ * consumer never touches it.
+ *
+ * A producer preempted between claiming a slot and filling it makes the queue look empty to the
+ * consumer until it resumes, even if later slots are already filled.
+ *
+ * @tparam T The element type contained by the queue. It does not need to be default-constructible.
+ */
+template <typename T>
+class MpscQueue {
+public:
+    using ElementType = T;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param capacity Minimum number of elements the queue can hold.
+     *                 It is rounded up to the next power of two.
+     */
+    explicit MpscQueue(std::size_t capacity)
+            : capacity_{std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity)}
+            , mask_{capacity_ - 1}
+            , slots_{std::make_unique<Slot[]>(capacity_)} {
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~MpscQueue() {
+        while (try_pop_front().has_value()) {
+        }
+    }
+
+    MpscQueue(const MpscQueue& other) = delete;
+    MpscQueue& operator=(const MpscQueue& other) = delete;
+
+    MpscQueue(MpscQueue&& other) = delete;
+    MpscQueue& operator=(MpscQueue&& other) = delete;
+
+    /**
+     * @brief Appends an element, unless the queue is full. It may be called by any thread.
+     *
+     * @return `true` if the element has been enqueued, `false` if the queue is full and
+     *         the element has been left untouched.
+     */
+    bool try_push_back(T&& t) {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            auto& slot = slots_[tail & mask_];
+            const auto sequence = slot.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence - tail);
+            if (diff == 0) {
+                // The slot is free: claim it, unless another producer did it first.
+                if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                    new (slot.storage) T(std::move(t));
+                    slot.sequence.store(tail + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                // The slot still holds the element pushed one lap before.
+                return false;
+            } else {
+                // Another producer claimed the slot meanwhile.
+                tail = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Removes the first element, if any. To be called by the consumer only.
+     */
+    std::optional<T> try_pop_front() {
+        const auto head = head_.load(std::memory_order_relaxed);
+        auto& slot = slots_[head & mask_];
+        if (slot.sequence.load(std::memory_order_acquire) != head + 1) {
+            return {};
+        }
+        T* element = std::launder(reinterpret_cast<T*>(slot.storage));
+        std::optional<T> option{std::move(*element)};
+        element->~T();
+        // The slot is free for the producer pushing the element one lap after.
+        slot.sequence.store(head + capacity_, std::memory_order_release);
+        head_.store(head + 1, std::memory_order_relaxed);
+        return option;
+    }
+
+    /**
+     * @brief Returns the number of elements in the queue, including the ones still being pushed.
+     *        The value is only a snapshot when called concurrently with push or pop.
+     */
+    std::size_t size() const {
+        const auto head = head_.load(std::memory_order_acquire);
+        const auto tail = tail_.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    /**
+     * @brief Returns whether the queue is empty.
+     *        The value is only a snapshot when called concurrently with push or pop.
+     */
+    bool empty() const {
+        return size() == 0;
+    }
+
+    /**
+     * @brief Returns the maximum number of elements the queue can hold.
+     */
+    std::size_t capacity() const {
+        return capacity_;
+    }
+
+private:
+    struct Slot {
+        std::atomic<std::size_t> sequence;
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    const std::size_t capacity_;
+    const std::size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    // Claimed by producers, one slot at a time.
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail_{0};
+    // Only written by the consumer.
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head_{0};
+};
+
+} // namespace dpipe
+
+#endif // DPIPE_UTILS_MPSC_QUEUE_H_
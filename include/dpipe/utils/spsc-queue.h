@@ -0,0 +1,139 @@
+#ifndef DPIPE_UTILS_SPSC_QUEUE_H_
+#define DPIPE_UTILS_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+
+#include <dpipe/utils/hardware.h>
+
+namespace dpipe {
+
+/**
+ * @brief A bounded, lock-free, single-producer/single-consumer queue backed by a ring buffer.
+ *
+ * Only one thread may push and only one thread may pop at any given time.
+ * Producer and consumer indices live on separate cache lines, and each side keeps a cached
+ * copy of the other side's index, so that the shared indices are only read when the cached
+ * value says that the queue looks full (producer) or empty (consumer).
+ *
+ * @tparam T The element type contained by the queue. It does not need to be default-constructible.
+ */
+template <typename T>
+class SpscQueue {
+public:
+    using ElementType = T;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param capacity Minimum number of elements the queue can hold.
+     *                 It is rounded up to the next power of two.
+     */
+    explicit SpscQueue(std::size_t capacity)
+            : capacity_{std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity)}
+            , mask_{capacity_ - 1}
+            , slots_{std::make_unique<Slot[]>(capacity_)} {}
+
+    ~SpscQueue() {
+        while (try_pop_front().has_value()) {
+        }
+    }
+
+    SpscQueue(const SpscQueue& other) = delete;
+    SpscQueue& operator=(const SpscQueue& other) = delete;
+
+    SpscQueue(SpscQueue&& other) = delete;
+    SpscQueue& operator=(SpscQueue&& other) = delete;
+
+    /**
+     * @brief Appends an element, unless the queue is full. To be called by the producer only.
+     *
+     * @return `true` if the element has been enqueued, `false` if the queue is full and
+     *         the element has been left untouched.
+     */
+    bool try_push_back(T&& t) {
+        const auto tail = producer_.index.load(std::memory_order_relaxed);
+        if (tail - producer_.cached_index == capacity_) {
+            producer_.cached_index = consumer_.index.load(std::memory_order_acquire);
+            if (tail - producer_.cached_index == capacity_) {
+                return false;
+            }
+        }
+        new (slot(tail)) T(std::move(t));
+        producer_.index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the first element, if any. To be called by the consumer only.
+     */
+    std::optional<T> try_pop_front() {
+        const auto head = consumer_.index.load(std::memory_order_relaxed);
+        if (head == consumer_.cached_index) {
+            consumer_.cached_index = producer_.index.load(std::memory_order_acquire);
+            if (head == consumer_.cached_index) {
+                return {};
+            }
+        }
+        T* element = std::launder(reinterpret_cast<T*>(slot(head)));
+        std::optional<T> option{std::move(*element)};
+        element->~T();
+        consumer_.index.store(head + 1, std::memory_order_release);
+        return option;
+    }
+
+    /**
+     * @brief Returns the number of elements in the queue.
+     *        The value is only a snapshot when called concurrently with push or pop.
+     */
+    std::size_t size() const {
+        const auto head = consumer_.index.load(std::memory_order_acquire);
+        const auto tail = producer_.index.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    /**
+     * @brief Returns whether the queue is empty.
+     *        The value is only a snapshot when called concurrently with push or pop.
+     */
+    bool empty() const {
+        return size() == 0;
+    }
+
+    /**
+     * @brief Returns the maximum number of elements the queue can hold.
+     */
+    std::size_t capacity() const {
+        return capacity_;
+    }
+
+private:
+    struct Slot {
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    // Each side owns its index and reads the other one, keeping a cached copy of it.
+    struct alignas(CACHE_LINE_SIZE) Side {
+        std::atomic<std::size_t> index{0};
+        std::size_t cached_index{0};
+    };
+
+    std::byte* slot(std::size_t index) {
+        return slots_[index & mask_].storage;
+    }
+
+    const std::size_t capacity_;
+    const std::size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    Side producer_;
+    Side consumer_;
+};
+
+} // namespace dpipe
+
+#endif // DPIPE_UTILS_SPSC_QUEUE_H_
@@ -0,0 +1,130 @@
+#ifndef DPIPE_UTILS_THREAD_OPTIONS_H_
+#define DPIPE_UTILS_THREAD_OPTIONS_H_
+
+#include <charconv>
+#include <cstddef>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace dpipe {
+
+/**
+ * @brief Scheduling options of a thread spawned by a pipeline element.
+ *
+ * Options are applied by the thread itself, as soon as it starts, so that the memory it allocates
+ * afterwards is placed on its NUMA node by the kernel's first-touch policy. Options not supported
+ * by the platform, or not permitted to the process (_e.g._, `SCHED_FIFO` without `CAP_SYS_NICE`),
+ * are skipped.
+ */
+struct ThreadOptions {
+    /// @brief Name of the thread, as shown by debuggers and `top -H`.
+    ///        Linux truncates it to 15 characters. If empty, the thread is not named.
+    std::string name{};
+    /// @brief CPUs the thread is pinned to (Linux only). If empty, the thread is not pinned.
+    std::vector<std::size_t> cpus{};
+    /// @brief NUMA node whose CPUs the thread is pinned to, if `cpus` is empty (Linux only).
+    std::optional<std::size_t> numa_node{};
+    /// @brief Real-time priority of the thread, from 1 to 99, under the `SCHED_FIFO` policy.
+    ///        If not set, the thread keeps the default policy.
+    std::optional<int> fifo_priority{};
+};
+
+/**
+ * @brief Parses a Linux CPU list, _e.g._, "0-3,8,10-11". Malformed ranges are skipped.
+ */
+inline std::vector<std::size_t> parse_cpu_list(std::string_view list) {
+    std::vector<std::size_t> cpus;
+    while (!list.empty()) {
+        const auto comma = list.find(',');
+        const auto range = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+        const auto* end = range.data() + range.size();
+        std::size_t first = 0;
+        auto result = std::from_chars(range.data(), end, first);
+        if (result.ec != std::errc{}) {
+            continue;
+        }
+        std::size_t last = first;
+        if (result.ptr != end && *result.ptr == '-') {
+            result = std::from_chars(result.ptr + 1, end, last);
+            if (result.ec != std::errc{}) {
+                continue;
+            }
+        }
+        for (auto cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+/**
+ * @brief Returns the CPUs of a NUMA node, as listed by sysfs (Linux only).
+ *        The list is empty if the node does not exist or the platform is not supported.
+ */
+inline std::vector<std::size_t> cpus_of_numa_node(std::size_t node) {
+    std::ifstream file{"/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"};
+    std::string list;
+    std::getline(file, list);
+    return parse_cpu_list(list);
+}
+
+/**
+ * @brief Applies the options to the calling thread.
+ *
+ * @return `true` if every option has been applied, `false` if any has been skipped.
+ */
+inline bool apply_thread_options(const ThreadOptions& options) {
+    bool applied = true;
+#if defined(__linux__)
+    if (!options.name.empty()) {
+        const auto name = options.name.substr(0, 15);
+        applied = pthread_setname_np(pthread_self(), name.c_str()) == 0 && applied;
+    }
+    auto cpus = options.cpus;
+    if (cpus.empty() && options.numa_node.has_value()) {
+        cpus = cpus_of_numa_node(*options.numa_node);
+        applied = !cpus.empty() && applied;
+    }
+    if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (auto cpu : cpus) {
+            if (cpu < static_cast<std::size_t>(CPU_SETSIZE)) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        applied = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 && applied;
+    }
+#elif defined(__APPLE__)
+    if (!options.name.empty()) {
+        applied = pthread_setname_np(options.name.c_str()) == 0 && applied;
+    }
+    applied = options.cpus.empty() && !options.numa_node.has_value() && applied;
+#else
+    applied = options.name.empty() && options.cpus.empty() && !options.numa_node.has_value();
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    if (options.fifo_priority.has_value()) {
+        sched_param param{};
+        param.sched_priority = *options.fifo_priority;
+        applied = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0 && applied;
+    }
+#else
+    applied = !options.fifo_priority.has_value() && applied;
+#endif
+    return applied;
+}
+
+} // namespace dpipe
+
+#endif // DPIPE_UTILS_THREAD_OPTIONS_H_
@@ -0,0 +1,251 @@
+#ifndef DPIPE_UTILS_THREAD_POOL_H_
+#define DPIPE_UTILS_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <dpipe/utils/executor.h>
+#include <dpipe/utils/hardware.h>
+
+namespace dpipe {
+
+/**
+ * @brief A work-stealing thread pool.
+ *
+ * Every worker thread owns a queue of tasks. Tasks posted by a worker go to its own queue, tasks
+ * posted from outside are spread round-robin. A worker runs the tasks of its own queue in order
+ * and, when it runs out of them, steals from the other queues before parking.
+ * Delayed tasks are kept in a timer queue shared by the workers, which run them first once due,
+ * and park until the earliest deadline when left with nothing else to do.
+ */
+class ThreadPool : public Executor {
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param threads Number of worker threads. Defaults to the number of hardware threads.
+     */
+    explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency()) {
+        if (threads < 1) {
+            threads = 1;
+        }
+        for (std::size_t i = 0; i < threads; ++i) {
+            queues_.push_back(std::make_unique<Queue>());
+        }
+        for (std::size_t i = 0; i < threads; ++i) {
+            threads_.emplace_back([this, i] { run_worker(i); });
+        }
+    }
+
+    /**
+     * @brief Destructor. Pending tasks are discarded, running ones are waited for.
+     */
+    ~ThreadPool() override {
+        stopping_.store(true);
+        epoch_.fetch_add(1);
+        epoch_.notify_all();
+        {
+            std::lock_guard<std::mutex> lock{timers_mutex_};
+            timers_wakeup_.notify_all();
+        }
+        threads_.clear();
+    }
+
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+    ThreadPool(ThreadPool&& other) = delete;
+    ThreadPool& operator=(ThreadPool&& other) = delete;
+
+    void post(Task&& task) override {
+        auto index = current_index();
+        if (!index.has_value()) {
+            index = next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+        }
+        {
+            auto& queue = *queues_[*index];
+            std::lock_guard<std::mutex> lock{queue.mutex};
+            queue.tasks.push_back(std::move(task));
+        }
+        wake();
+    }
+
+    void post_at(Clock::time_point time, Task&& task) override {
+        {
+            std::lock_guard<std::mutex> lock{timers_mutex_};
+            timers_.emplace(time, std::move(task));
+            timer_count_.store(timers_.size(), std::memory_order_relaxed);
+        }
+        // A parked worker parks again, until the earliest deadline.
+        wake();
+    }
+
+    bool run_one() override {
+        auto task = take_due_timer();
+        if (!task.has_value()) {
+            task = find_task(current_index().value_or(0));
+        }
+        if (!task.has_value()) {
+            return false;
+        }
+        (*task)();
+        return true;
+    }
+
+    /**
+     * @brief Returns the number of worker threads.
+     */
+    std::size_t size() const {
+        return queues_.size();
+    }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // Index of the queue owned by the calling thread, if it is a worker of this pool.
+    std::optional<std::size_t> current_index() const {
+        if (current_pool() != this) {
+            return {};
+        }
+        return current_worker();
+    }
+
+    static const ThreadPool*& current_pool() {
+        thread_local const ThreadPool* pool = nullptr;
+        return pool;
+    }
+
+    static std::size_t& current_worker() {
+        thread_local std::size_t index = 0;
+        return index;
+    }
+
+    void wake() {
+        // Pairs with `park`: either a parking worker sees the task, or this thread sees it parking.
+        epoch_.fetch_add(1);
+        if (sleepers_.load() > 0) {
+            epoch_.notify_one();
+            if (timed_sleepers_.load() > 0) {
+                std::lock_guard<std::mutex> lock{timers_mutex_};
+                timers_wakeup_.notify_all();
+            }
+        }
+    }
+
+    std::optional<Task> take_due_timer() {
+        if (timer_count_.load(std::memory_order_relaxed) == 0) {
+            return {};
+        }
+        const auto now = Clock::now();
+        std::lock_guard<std::mutex> lock{timers_mutex_};
+        if (timers_.empty() || timers_.begin()->first > now) {
+            return {};
+        }
+        std::optional<Task> task{std::move(timers_.begin()->second)};
+        timers_.erase(timers_.begin());
+        timer_count_.store(timers_.size(), std::memory_order_relaxed);
+        return task;
+    }
+
+    std::optional<Task> find_task(std::size_t own) {
+        // Own queue first, from the front, then the others, from the back.
+        for (std::size_t i = 0; i < queues_.size(); ++i) {
+            auto& queue = *queues_[(own + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock{queue.mutex};
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            std::optional<Task> task;
+            if (i == 0) {
+                task.emplace(std::move(queue.tasks.front()));
+                queue.tasks.pop_front();
+            } else {
+                task.emplace(std::move(queue.tasks.back()));
+                queue.tasks.pop_back();
+            }
+            return task;
+        }
+        return {};
+    }
+
+    void run_worker(std::size_t index) {
+        current_pool() = this;
+        current_worker() = index;
+        while (!stopping_.load(std::memory_order_relaxed)) {
+            auto task = take_due_timer();
+            if (!task.has_value()) {
+                task = find_task(index);
+            }
+            if (task.has_value()) {
+                (*task)();
+            } else {
+                park();
+            }
+        }
+    }
+
+    void park() {
+        sleepers_.fetch_add(1);
+        const auto epoch = epoch_.load();
+        bool idle = true;
+        for (const auto& queue : queues_) {
+            std::lock_guard<std::mutex> lock{queue->mutex};
+            if (!queue->tasks.empty()) {
+                idle = false;
+                break;
+            }
+        }
+        if (idle && !stopping_.load()) {
+            auto deadline = Clock::time_point::max();
+            {
+                std::lock_guard<std::mutex> lock{timers_mutex_};
+                if (!timers_.empty()) {
+                    deadline = timers_.begin()->first;
+                }
+            }
+            if (deadline == Clock::time_point::max()) {
+                epoch_.wait(epoch);
+            } else {
+                // Same pairing as above, through the mutex, for `wake` to notify the condition.
+                timed_sleepers_.fetch_add(1);
+                std::unique_lock<std::mutex> lock{timers_mutex_};
+                timers_wakeup_.wait_until(lock, deadline, [&] {
+                    return epoch_.load() != epoch || stopping_.load();
+                });
+                lock.unlock();
+                timed_sleepers_.fetch_sub(1);
+            }
+        }
+        sleepers_.fetch_sub(1);
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::atomic<std::size_t> next_queue_{0};
+    std::atomic<uint32_t> epoch_{0};
+    std::atomic<std::size_t> sleepers_{0};
+    std::atomic<bool> stopping_{false};
+    std::mutex timers_mutex_;
+    std::condition_variable timers_wakeup_;
+    std::multimap<Clock::time_point, Task> timers_;
+    // Size of `timers_`, checked without locking before looking for a due task.
+    std::atomic<std::size_t> timer_count_{0};
+    std::atomic<std::size_t> timed_sleepers_{0};
+    // Declared last, so that threads are joined before anything else is destroyed.
+    std::vector<std::jthread> threads_;
+};
+
+} // namespace dpipe
+
+#endif // DPIPE_UTILS_THREAD_POOL_H_
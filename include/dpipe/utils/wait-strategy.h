@@ -0,0 +1,150 @@
+#ifndef DPIPE_UTILS_WAIT_STRATEGY_H_
+#define DPIPE_UTILS_WAIT_STRATEGY_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stop_token>
+#include <thread>
+
+#include <dpipe/utils/hardware.h>
+
+namespace dpipe {
+
+/**
+ * @brief How a thread waits for a condition to become true, _e.g._, for a queue to have data.
+ */
+enum class WaitStrategy {
+    /// Spin on the condition. Lowest latency, but it keeps a core busy even when idle.
+    BusySpin,
+    /// Spin for the spin budget, then keep yielding the processor between checks.
+    SpinYield,
+    /// Park the thread immediately, to be woken up by a notification. No CPU usage when idle.
+    Park,
+    /// Spin for the spin budget, then park the thread.
+    SpinPark,
+};
+
+/**
+ * @brief Blocks a single waiting thread until a condition, made true by another thread, holds.
+ *
+ * The thread that makes the condition true must call `notify` afterwards.
+ * Notifications are cheap when the waiting thread is not parked: parking strategies only pay
+ * for a memory fence, the other ones pay nothing.
+ */
+class Waiter {
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param strategy    The wait strategy.
+     * @param spin_budget Number of condition checks before yielding or parking
+     *                    (only used by `SpinYield` and `SpinPark`).
+     */
+    explicit Waiter(WaitStrategy strategy = WaitStrategy::SpinPark, std::size_t spin_budget = 256)
+            : strategy_{strategy}
+            , spin_budget_{spin_budget} {}
+
+    Waiter(const Waiter& other) = delete;
+    Waiter& operator=(const Waiter& other) = delete;
+
+    Waiter(Waiter&& other) = delete;
+    Waiter& operator=(Waiter&& other) = delete;
+
+    /**
+     * @brief Waits until `ready()` returns `true` or a stop is requested through `token`.
+     *
+     * @return `true` if the condition holds, `false` if the wait has been interrupted.
+     */
+    template <typename Predicate>
+    bool wait(Predicate&& ready, const std::stop_token& token) {
+        if (ready()) {
+            return true;
+        }
+        std::size_t spins = 0;
+        if (strategy_ != WaitStrategy::Park) {
+            while (strategy_ == WaitStrategy::BusySpin || spins < spin_budget_) {
+                if (token.stop_requested()) {
+                    return false;
+                }
+                cpu_relax();
+                if (ready()) {
+                    return true;
+                }
+                ++spins;
+            }
+        }
+        if (strategy_ == WaitStrategy::SpinYield) {
+            while (!token.stop_requested()) {
+                std::this_thread::yield();
+                if (ready()) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        return park(ready, token);
+    }
+
+    /**
+     * @brief Wakes up the waiting thread, if parked.
+     *        It must be called after making the condition true.
+     */
+    void notify() {
+        if (!parks()) {
+            return;
+        }
+        // Pairs with the fence in `park`: either the waiting thread sees the condition,
+        // or this thread sees it parked.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked_.load(std::memory_order_relaxed)) {
+            wake();
+        }
+    }
+
+    /**
+     * @brief Returns the wait strategy.
+     */
+    WaitStrategy strategy() const {
+        return strategy_;
+    }
+
+private:
+    bool parks() const {
+        return strategy_ == WaitStrategy::Park || strategy_ == WaitStrategy::SpinPark;
+    }
+
+    void wake() {
+        epoch_.fetch_add(1, std::memory_order_release);
+        epoch_.notify_one();
+    }
+
+    template <typename Predicate>
+    bool park(Predicate& ready, const std::stop_token& token) {
+        std::stop_callback on_stop{token, [this] { wake(); }};
+        while (!token.stop_requested()) {
+            const auto epoch = epoch_.load(std::memory_order_acquire);
+            parked_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (ready()) {
+                parked_.store(false, std::memory_order_relaxed);
+                return true;
+            }
+            epoch_.wait(epoch, std::memory_order_acquire);
+            parked_.store(false, std::memory_order_relaxed);
+            if (ready()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const WaitStrategy strategy_;
+    const std::size_t spin_budget_;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> epoch_{0};
+    std::atomic<bool> parked_{false};
+};
+
+} // namespace dpipe
+
+#endif // DPIPE_UTILS_WAIT_STRATEGY_H_
@@ -1,28 +1,51 @@
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stop_token>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <vector>
 
 #include <dpipe/dpipe.h>
+#include <dpipe/utils/async-queue.h>
+#include <dpipe/utils/mpsc-queue.h>
+#include <dpipe/utils/spsc-queue.h>
+#include <dpipe/utils/thread-options.h>
+#include <dpipe/utils/thread-pool.h>
+#include <dpipe/utils/wait-strategy.h>
 #include <gtest/gtest.h>
 
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 #include "toys.h"
 
 using dpipe::make_arm;
+using dpipe::make_broadcast_splitter;
 using dpipe::make_pipe;
 using dpipe::make_splitter;
+using dpipe::make_static_arm;
+using dpipe::make_static_pipe;
 
 static constexpr uint8_t TOTAL_FRAMES = 10;
 
-static void run_pipeline(dpipe::Pipeline& pipeline, uint8_t milliseconds) {
+static void run_pipeline(dpipe::Pipeline& pipeline) {
     pipeline.start();
-    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
-    pipeline.stop();
+    pipeline.wait();
 }
 
 TEST(DPipe, SimpleSourceToSink) {
     uint64_t counter = 0;
     auto pipeline = make_pipe(CounterSink<RawPayload>{counter}, RampUpSource{TOTAL_FRAMES});
-    run_pipeline(pipeline, TOTAL_FRAMES);
+    run_pipeline(pipeline);
     EXPECT_EQ(counter, TOTAL_FRAMES);
 }
 
@@ -30,16 +53,177 @@ TEST(DPipe, SimpleSourceToSinkWithDecoupler) {
     uint64_t counter = 0;
     auto pipeline = make_pipe(CounterSink<RawPayload>{counter}, dpipe::DecouplerPlaceholder{},
                               RampUpSource{TOTAL_FRAMES});
-    run_pipeline(pipeline, TOTAL_FRAMES);
+    run_pipeline(pipeline);
+    EXPECT_EQ(counter, TOTAL_FRAMES);
+}
+
+TEST(DPipe, SimpleSourceToSinkWithLockedDecoupler) {
+    uint64_t counter = 0;
+    auto pipeline = make_pipe(CounterSink<RawPayload>{counter},
+                              dpipe::DecouplerPlaceholder{{.queue = dpipe::DecouplerQueue::Locked}},
+                              RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    EXPECT_EQ(counter, TOTAL_FRAMES);
+}
+
+TEST(DPipe, SimpleSourceToSinkWithTinyDecoupler) {
+    uint64_t counter = 0;
+    auto pipeline = make_pipe(CounterSink<RawPayload>{counter},
+                              dpipe::DecouplerPlaceholder{{.capacity = 2}},
+                              RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
     EXPECT_EQ(counter, TOTAL_FRAMES);
 }
 
+TEST(DPipe, SimpleSourceToSinkWithEveryWaitStrategy) {
+    for (auto strategy : {dpipe::WaitStrategy::BusySpin, dpipe::WaitStrategy::SpinYield,
+                          dpipe::WaitStrategy::Park, dpipe::WaitStrategy::SpinPark}) {
+        uint64_t counter = 0;
+        auto pipeline = make_pipe(CounterSink<RawPayload>{counter},
+                                  dpipe::DecouplerPlaceholder{{.wait_strategy = strategy}},
+                                  RampUpSource{TOTAL_FRAMES});
+        run_pipeline(pipeline);
+        EXPECT_EQ(counter, TOTAL_FRAMES);
+    }
+}
+
+static std::vector<uint8_t> overflow_decoupler(dpipe::DecouplerOptions options,
+                                               uint64_t& dropped) {
+    std::atomic<bool> gate{false};
+    std::atomic<uint64_t> arrived{0};
+    std::vector<uint8_t> levels;
+    options.capacity = 2;
+    options.counters = std::make_shared<dpipe::DecouplerCounters>();
+    {
+        dpipe::Decoupler<RawPayload> decoupler{
+                std::make_unique<dpipe::Sink<GatedSink>>(gate, arrived, levels), options};
+        // The first frame is held by the sink, the others overflow the queue.
+        decoupler.push(dpipe::Frame<RawPayload>::make(uint8_t{0}));
+        while (arrived.load() == 0) {
+            std::this_thread::yield();
+        }
+        for (uint8_t level = 1; level < TOTAL_FRAMES; ++level) {
+            decoupler.push(dpipe::Frame<RawPayload>::make(level));
+        }
+        gate.store(true);
+        while (arrived.load() + options.counters->dropped.load() < TOTAL_FRAMES) {
+            std::this_thread::yield();
+        }
+    }
+    dropped = options.counters->dropped.load();
+    return levels;
+}
+
+TEST(DPipe, DecouplerDropsNewestFrames) {
+    uint64_t dropped = 0;
+    auto levels = overflow_decoupler({.overflow = dpipe::OverflowPolicy::DropNewest}, dropped);
+    EXPECT_EQ(levels, (std::vector<uint8_t>{0, 1, 2}));
+    EXPECT_EQ(dropped, TOTAL_FRAMES - 3);
+}
+
+TEST(DPipe, DecouplerDropsOldestFrames) {
+    uint64_t dropped = 0;
+    auto levels = overflow_decoupler({.overflow = dpipe::OverflowPolicy::DropOldest}, dropped);
+    EXPECT_EQ(levels, (std::vector<uint8_t>{0, TOTAL_FRAMES - 2, TOTAL_FRAMES - 1}));
+    EXPECT_EQ(dropped, TOTAL_FRAMES - 3);
+}
+
+TEST(DPipe, DecouplerConflatesFrames) {
+    uint64_t dropped = 0;
+    auto levels = overflow_decoupler({.overflow = dpipe::OverflowPolicy::Conflate}, dropped);
+    EXPECT_EQ(levels, (std::vector<uint8_t>{0, TOTAL_FRAMES - 1}));
+    EXPECT_EQ(dropped, TOTAL_FRAMES - 2);
+}
+
+TEST(DPipe, DecouplerBlocksProducer) {
+    std::atomic<bool> gate{false};
+    std::atomic<uint64_t> arrived{0};
+    std::vector<uint8_t> levels;
+    auto counters = std::make_shared<dpipe::DecouplerCounters>();
+    {
+        dpipe::Decoupler<RawPayload> decoupler{
+                std::make_unique<dpipe::Sink<GatedSink>>(gate, arrived, levels),
+                {.capacity = 2, .wait_strategy = dpipe::WaitStrategy::Park, .counters = counters}};
+        std::thread opener{[&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(TOTAL_FRAMES));
+            gate.store(true);
+        }};
+        for (uint8_t level = 0; level < TOTAL_FRAMES; ++level) {
+            decoupler.push(dpipe::Frame<RawPayload>::make(level));
+        }
+        opener.join();
+        while (arrived.load() < TOTAL_FRAMES) {
+            std::this_thread::yield();
+        }
+    }
+    EXPECT_EQ(levels.size(), TOTAL_FRAMES);
+    EXPECT_EQ(counters->dropped.load(), 0);
+    EXPECT_GT(counters->blocked_ns.load(), 0);
+}
+
+static std::vector<dpipe::Frame<RawPayload>> make_frames(uint8_t count) {
+    std::vector<dpipe::Frame<RawPayload>> frames;
+    for (uint8_t level = 0; level < count; ++level) {
+        frames.push_back(dpipe::Frame<RawPayload>::make(level));
+    }
+    return frames;
+}
+
+TEST(DPipe, BatchThroughFilterAndSink) {
+    std::vector<std::size_t> batch_sizes;
+    uint8_t threshold = 2;
+    auto arm = make_arm<RawPayload>(BatchRecorderSink{batch_sizes}, ThresholdFilter{threshold});
+    auto frames = make_frames(TOTAL_FRAMES);
+    arm->push_batch(frames);
+    EXPECT_EQ(batch_sizes, (std::vector<std::size_t>{std::size_t{TOTAL_FRAMES} - threshold}));
+}
+
+TEST(DPipe, BatchFallsBackToSingleFrames) {
+    uint64_t counter = 0;
+    uint8_t shift = 1;
+    auto arm = make_arm<RawPayload>(CounterSink<CalibratedPayload>{counter}, CalibrationFilter{},
+                                    ShiftUpFilter{shift});
+    auto frames = make_frames(TOTAL_FRAMES);
+    arm->push_batch(frames);
+    EXPECT_EQ(counter, TOTAL_FRAMES);
+}
+
+TEST(DPipe, BatchThroughSplitter) {
+    std::vector<std::size_t> batch_sizes1;
+    std::vector<std::size_t> batch_sizes2;
+    auto splitter = make_splitter(make_arm<RawPayload>(BatchRecorderSink{batch_sizes1}),
+                                  make_arm<RawPayload>(BatchRecorderSink{batch_sizes2}));
+    auto frames = make_frames(TOTAL_FRAMES);
+    splitter->push_batch(frames);
+    EXPECT_EQ(batch_sizes1, (std::vector<std::size_t>{TOTAL_FRAMES}));
+    EXPECT_EQ(batch_sizes2, (std::vector<std::size_t>{TOTAL_FRAMES}));
+}
+
+TEST(DPipe, DecouplerDrainsBatches) {
+    static constexpr std::size_t MAX_BATCH = 4;
+    std::vector<std::size_t> batch_sizes;
+    {
+        dpipe::Decoupler<RawPayload> decoupler{
+                std::make_unique<dpipe::Sink<BatchRecorderSink>>(batch_sizes),
+                {.wait_strategy = dpipe::WaitStrategy::Park, .max_batch = MAX_BATCH}};
+        auto frames = make_frames(TOTAL_FRAMES);
+        decoupler.push_batch(frames);
+        decoupler.finish();
+    }
+    std::size_t total = 0;
+    for (auto size : batch_sizes) {
+        EXPECT_LE(size, MAX_BATCH);
+        total += size;
+    }
+    EXPECT_EQ(total, TOTAL_FRAMES);
+}
+
 TEST(DPipe, StraightPipeline) {
     uint64_t counter = 0;
     uint8_t threshold = 2;
     auto pipeline = make_pipe(CounterSink<RawPayload>{counter}, ThresholdFilter{threshold},
                               RampUpSource{TOTAL_FRAMES});
-    run_pipeline(pipeline, TOTAL_FRAMES);
+    run_pipeline(pipeline);
     EXPECT_EQ(counter, TOTAL_FRAMES - threshold);
 }
 
@@ -48,7 +232,7 @@ TEST(DPipe, StraightPipelineWithTypeChange) {
     uint8_t threshold = 2;
     auto pipeline = make_pipe(CounterSink<CalibratedPayload>{counter}, CalibrationFilter{},
                               ThresholdFilter{threshold}, RampUpSource{TOTAL_FRAMES});
-    run_pipeline(pipeline, TOTAL_FRAMES);
+    run_pipeline(pipeline);
     EXPECT_EQ(counter, TOTAL_FRAMES - threshold);
 }
 
@@ -58,7 +242,17 @@ TEST(DPipe, StraightPipelineWithDecoupler) {
     auto pipeline = make_pipe(CounterSink<CalibratedPayload>{counter}, CalibrationFilter{},
                               ThresholdFilter{threshold}, dpipe::DecouplerPlaceholder{},
                               RampUpSource{TOTAL_FRAMES});
-    run_pipeline(pipeline, TOTAL_FRAMES);
+    run_pipeline(pipeline);
+    EXPECT_EQ(counter, TOTAL_FRAMES - threshold);
+}
+
+TEST(DPipe, StraightPipelineWithFilterAfterDecoupler) {
+    uint64_t counter = 0;
+    uint8_t threshold = 2;
+    auto pipeline = make_pipe(CounterSink<CalibratedPayload>{counter}, CalibrationFilter{},
+                              dpipe::DecouplerPlaceholder{}, ThresholdFilter{threshold},
+                              RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
     EXPECT_EQ(counter, TOTAL_FRAMES - threshold);
 }
 
@@ -70,11 +264,24 @@ TEST(DPipe, PipelineSplitIntoTwoArms) {
     auto arm2 = make_arm<RawPayload>(CounterSink<RawPayload>{counter2}, ThresholdFilter{threshold});
     auto splitter = make_splitter(std::move(arm1), std::move(arm2));
     auto pipeline = make_pipe(std::move(splitter), RampUpSource{TOTAL_FRAMES});
-    run_pipeline(pipeline, TOTAL_FRAMES);
+    run_pipeline(pipeline);
     EXPECT_EQ(counter1, TOTAL_FRAMES);
     EXPECT_EQ(counter2, TOTAL_FRAMES - threshold);
 }
 
+TEST(DPipe, SplitterHandsTheOriginalFrameToTheLastArm) {
+    uint64_t counter = 0;
+    uint64_t unique = 0;
+    auto arm1 = make_arm<RawPayload>(CounterSink<RawPayload>{counter});
+    auto arm2 = make_arm<RawPayload>(UniqueCounterSink{unique});
+    auto splitter = make_splitter(std::move(arm1), std::move(arm2));
+    auto pipeline = make_pipe(std::move(splitter), RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    EXPECT_EQ(counter, TOTAL_FRAMES);
+    // The first arm dropped its copy, so the last one holds the only reference.
+    EXPECT_EQ(unique, TOTAL_FRAMES);
+}
+
 TEST(DPipe, PipelineSplitIntoFourArms) {
     uint64_t counter1 = 0;
     uint64_t counter2 = 0;
@@ -93,10 +300,1630 @@ TEST(DPipe, PipelineSplitIntoFourArms) {
     auto pipeline = make_pipe(make_splitter(std::move(arm1), std::move(arm2), std::move(arm3),
                                             std::move(arm4), std::move(arm5)),
                               dpipe::DecouplerPlaceholder{}, RampUpSource{TOTAL_FRAMES});
-    run_pipeline(pipeline, TOTAL_FRAMES);
+    run_pipeline(pipeline);
     EXPECT_EQ(counter1, TOTAL_FRAMES);
     EXPECT_EQ(counter2, TOTAL_FRAMES - threshold);
     EXPECT_EQ(counter3, TOTAL_FRAMES);
     EXPECT_EQ(counter4, TOTAL_FRAMES - threshold);
     EXPECT_EQ(counter5, TOTAL_FRAMES + shift - threshold);
 }
+
+TEST(EndOfStream, FiltersFlushPendingFrames) {
+    std::vector<uint8_t> levels;
+    auto pipeline = make_pipe(RecorderSink{levels}, HoldBackFilter{}, dpipe::DecouplerPlaceholder{},
+                              HoldBackFilter{}, RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    std::vector<uint8_t> expected;
+    for (uint8_t level = 0; level < TOTAL_FRAMES; ++level) {
+        expected.push_back(level);
+    }
+    EXPECT_EQ(levels, expected);
+}
+
+TEST(EndOfStream, IdleSourceIsPolledAgain) {
+    uint64_t counter = 0;
+    auto pipeline = make_pipe(CounterSink<RawPayload>{counter}, dpipe::DecouplerPlaceholder{},
+                              IntermittentSource{TOTAL_FRAMES});
+    pipeline.start({.idle_spins = 1,
+                    .idle_min_sleep = std::chrono::microseconds(1),
+                    .idle_max_sleep = std::chrono::microseconds(100)});
+    pipeline.wait();
+    EXPECT_EQ(counter, TOTAL_FRAMES);
+}
+
+TEST(EndOfStream, ReachesEverySinkThroughSplitterAndParallelFilter) {
+    uint64_t counter1 = 0;
+    std::vector<uint8_t> levels;
+    auto arm1 = make_arm<RawPayload>(CounterSink<RawPayload>{counter1},
+                                     dpipe::DecouplerPlaceholder{{.capacity = 2}});
+    auto arm2 = make_arm<RawPayload>(
+            RecorderSink{levels},
+            dpipe::ParallelPlaceholder{[] { return JitterFilter{}; }, {.threads = 3}});
+    auto pipeline = make_pipe(make_splitter(std::move(arm1), std::move(arm2)),
+                              RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    EXPECT_EQ(counter1, TOTAL_FRAMES);
+    EXPECT_EQ(levels.size(), TOTAL_FRAMES);
+}
+
+TEST(EndOfStream, DrainForwardsQueuedFrames) {
+    std::atomic<uint64_t> produced{0};
+    uint64_t counter = 0;
+    auto pipeline = make_pipe(CounterSink<RawPayload>{counter}, JitterFilter{},
+                              dpipe::DecouplerPlaceholder{}, EndlessSource{produced});
+    pipeline.start();
+    while (produced.load() < TOTAL_FRAMES) {
+        std::this_thread::yield();
+    }
+    pipeline.drain();
+    EXPECT_GE(counter, TOTAL_FRAMES);
+    EXPECT_EQ(counter, produced.load());
+}
+
+TEST(EndOfStream, PipelineOnExecutorWaitsForEndOfStream) {
+    auto pool = std::make_shared<dpipe::ThreadPool>(1);
+    std::vector<uint8_t> levels;
+    auto pipeline = make_pipe(RecorderSink{levels}, HoldBackFilter{},
+                              dpipe::DecouplerPlaceholder{{.executor = pool}},
+                              IntermittentSource{TOTAL_FRAMES});
+    pipeline.start(pool);
+    pipeline.wait();
+    EXPECT_EQ(levels.size(), TOTAL_FRAMES);
+}
+
+TEST(EndOfStream, IdleSourceOnExecutorDoesNotBlockOtherTasks) {
+    auto pool = std::make_shared<dpipe::ThreadPool>(1);
+    uint64_t counter = 0;
+    std::atomic<uint64_t> polls{0};
+    auto pipeline = make_pipe(CounterSink<RawPayload>{counter}, SilentSource{polls});
+    pipeline.start({.idle_spins = 0,
+                    .idle_min_sleep = std::chrono::seconds(1),
+                    .idle_max_sleep = std::chrono::seconds(1),
+                    .executor = pool});
+    // Let the source back off before sharing the thread of the pool.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::atomic<bool> ran{false};
+    const auto posted = std::chrono::steady_clock::now();
+    pool->post([&ran] {
+        ran.store(true);
+        ran.notify_all();
+    });
+    ran.wait(false);
+    EXPECT_LT(std::chrono::steady_clock::now() - posted, std::chrono::milliseconds(500));
+    // The source is not polled again before its backoff elapsed, nor is the thread kept busy.
+    EXPECT_EQ(polls.load(), 1);
+    // Draining does not wait for the backoff either.
+    const auto drained = std::chrono::steady_clock::now();
+    pipeline.drain();
+    EXPECT_LT(std::chrono::steady_clock::now() - drained, std::chrono::milliseconds(500));
+    EXPECT_EQ(counter, 0);
+}
+
+TEST(BroadcastSplitter, EveryArmGetsEveryFrameInOrder) {
+    std::vector<uint8_t> levels1;
+    std::vector<uint8_t> levels2;
+    std::vector<uint8_t> levels3;
+    auto pipeline = make_pipe(make_broadcast_splitter({.capacity = 4, .max_batch = 3},
+                                                      make_arm<RawPayload>(RecorderSink{levels1}),
+                                                      make_arm<RawPayload>(RecorderSink{levels2}),
+                                                      make_arm<RawPayload>(RecorderSink{levels3},
+                                                                           JitterFilter{})),
+                              RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    std::vector<uint8_t> expected;
+    for (uint8_t level = 0; level < TOTAL_FRAMES; ++level) {
+        expected.push_back(level);
+    }
+    EXPECT_EQ(levels1, expected);
+    EXPECT_EQ(levels2, expected);
+    EXPECT_EQ(levels3, expected);
+}
+
+TEST(BroadcastSplitter, SlowestArmGatesTheProducer) {
+    std::atomic<bool> gate{false};
+    std::atomic<uint64_t> arrived{0};
+    std::vector<uint8_t> gated_levels;
+    std::vector<uint8_t> levels;
+    auto splitter = make_broadcast_splitter(
+            {.capacity = 2, .wait_strategy = dpipe::WaitStrategy::Park},
+            make_arm<RawPayload>(GatedSink{gate, arrived, gated_levels}),
+            make_arm<RawPayload>(RecorderSink{levels}));
+    std::thread opener{[&] {
+        while (arrived.load() == 0) {
+            std::this_thread::yield();
+        }
+        gate.store(true);
+    }};
+    auto frames = make_frames(TOTAL_FRAMES);
+    splitter->push_batch(frames);
+    splitter->finish();
+    opener.join();
+    EXPECT_EQ(gated_levels.size(), TOTAL_FRAMES);
+    EXPECT_EQ(levels.size(), TOTAL_FRAMES);
+}
+
+TEST(BroadcastSplitter, RingReleasesFramesReadByEveryArm) {
+    dpipe::FramePool<RawPayload> pool;
+    uint64_t counter1 = 0;
+    uint64_t counter2 = 0;
+    auto arm1 = make_arm<RawPayload>(CounterSink<RawPayload>{counter1});
+    auto arm2 = make_arm<RawPayload>(CounterSink<RawPayload>{counter2});
+    auto pipeline = make_pipe(make_broadcast_splitter({}, std::move(arm1), std::move(arm2)),
+                              PooledRampUpSource{TOTAL_FRAMES, pool});
+    run_pipeline(pipeline);
+    EXPECT_EQ(counter1, TOTAL_FRAMES);
+    EXPECT_EQ(counter2, TOTAL_FRAMES);
+    EXPECT_EQ(pool.stats().in_flight, 0);
+}
+
+TEST(Merger, PipelinesFeedOneArm) {
+    std::vector<uint8_t> levels;
+    auto merger = dpipe::make_merger(3, {}, make_arm<RawPayload>(RecorderSink{levels},
+                                                                 HoldBackFilter{}));
+    auto pipeline1 = make_pipe(merger.input(0), RampUpSource{TOTAL_FRAMES});
+    auto pipeline2 = make_pipe(merger.input(1), ShiftUpFilter{TOTAL_FRAMES},
+                               RampUpSource{TOTAL_FRAMES});
+    auto pipeline3 = make_static_pipe(merger.input(2), ShiftUpFilter{2 * TOTAL_FRAMES},
+                                      RampUpSource{TOTAL_FRAMES});
+    pipeline1.start();
+    pipeline2.start();
+    pipeline3.start();
+    pipeline1.wait();
+    pipeline2.wait();
+    pipeline3.wait();
+    // The frame held back by the arm reaches the sink only if the end of stream does.
+    ASSERT_EQ(levels.size(), 3 * TOTAL_FRAMES);
+    std::sort(levels.begin(), levels.end());
+    for (uint8_t level = 0; level < 3 * TOTAL_FRAMES; ++level) {
+        EXPECT_EQ(levels[level], level);
+    }
+    const auto metrics = merger.metrics();
+    if (dpipe::METRICS_ENABLED) {
+        ASSERT_EQ(metrics.size(), 3);
+        EXPECT_EQ(metrics[0].kind, "Merger");
+        EXPECT_EQ(metrics[0].frames_in, 3 * TOTAL_FRAMES);
+        EXPECT_EQ(metrics[0].frames_out, 3 * TOTAL_FRAMES);
+        EXPECT_EQ(metrics[2].kind, "Sink");
+    }
+}
+
+// Pushes a first frame into the gated arm, then the given frames while the arm is blocked on it.
+static std::vector<uint8_t> merge_behind_gate(const dpipe::MergerOptions& options,
+                                              const std::vector<std::vector<uint8_t>>& inputs) {
+    std::atomic<bool> gate{false};
+    std::atomic<uint64_t> arrived{0};
+    std::vector<uint8_t> levels;
+    auto merger = dpipe::make_merger(inputs.size(), options,
+                                     make_arm<RawPayload>(GatedSink{gate, arrived, levels}));
+    std::vector<std::unique_ptr<dpipe::MergerInput<RawPayload>>> ports;
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        ports.push_back(merger.input(i));
+    }
+    ports[0]->push(dpipe::Frame<RawPayload>::make(uint8_t{0}));
+    while (arrived.load() == 0) {
+        std::this_thread::yield();
+    }
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        for (auto level : inputs[i]) {
+            ports[i]->push(dpipe::Frame<RawPayload>::make(level));
+        }
+    }
+    gate.store(true);
+    for (auto& port : ports) {
+        port->finish();
+    }
+    return levels;
+}
+
+TEST(Merger, ArrivalOrderKeepsPushOrder) {
+    const auto levels = merge_behind_gate({}, {{1, 2, 3}, {10, 11, 12}});
+    EXPECT_EQ(levels, (std::vector<uint8_t>{0, 1, 2, 3, 10, 11, 12}));
+}
+
+TEST(Merger, RoundRobinTakesInputsInTurn) {
+    const auto levels = merge_behind_gate({.policy = dpipe::MergePolicy::RoundRobin},
+                                          {{1, 2, 3, 4}, {10, 11}, {20}});
+    EXPECT_EQ(levels, (std::vector<uint8_t>{0, 10, 20, 1, 11, 2, 3, 4}));
+}
+
+TEST(Merger, TimestampPolicyOrdersFrames) {
+    std::vector<uint8_t> levels;
+    auto merger = dpipe::make_merger(
+            2, {.policy = dpipe::MergePolicy::Timestamp, .max_wait = std::chrono::seconds(10)},
+            make_arm<RawPayload>(RecorderSink{levels}),
+            [](const RawPayload& payload) { return std::chrono::nanoseconds(payload.level); });
+    auto even = merger.input(0);
+    auto odd = merger.input(1);
+    for (uint8_t level = 0; level < TOTAL_FRAMES; level += 2) {
+        even->push(dpipe::Frame<RawPayload>::make(level));
+    }
+    for (uint8_t level = 1; level < TOTAL_FRAMES; level += 2) {
+        odd->push(dpipe::Frame<RawPayload>::make(level));
+    }
+    even->finish();
+    odd->finish();
+    std::vector<uint8_t> expected;
+    for (uint8_t level = 0; level < TOTAL_FRAMES; ++level) {
+        expected.push_back(level);
+    }
+    EXPECT_EQ(levels, expected);
+}
+
+TEST(Merger, TimestampPolicyWaitsForSilentInputsUpToMaxWait) {
+    uint64_t counter = 0;
+    auto merger = dpipe::make_merger(
+            2, {.policy = dpipe::MergePolicy::Timestamp, .max_wait = std::chrono::milliseconds(1)},
+            make_arm<RawPayload>(CounterSink<RawPayload>{counter}));
+    auto pipeline = make_pipe(merger.input(0), RampUpSource{TOTAL_FRAMES});
+    auto silent = merger.input(1);
+    run_pipeline(pipeline);
+    EXPECT_EQ(counter, TOTAL_FRAMES);
+    silent->finish();
+}
+
+TEST(MpscQueue, PushAndPopInOrderUntilFull) {
+    dpipe::MpscQueue<int> queue{4};
+    EXPECT_EQ(queue.capacity(), 4);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.try_push_back(int{i}));
+    }
+    EXPECT_FALSE(queue.try_push_back(4));
+    EXPECT_EQ(queue.size(), 4);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(queue.try_pop_front(), i);
+    }
+    EXPECT_FALSE(queue.try_pop_front().has_value());
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(MpscQueue, TransfersFromManyThreads) {
+    static constexpr uint64_t PRODUCERS = 4;
+    static constexpr uint64_t COUNT = 10000;
+    dpipe::MpscQueue<uint64_t> queue{64};
+    std::vector<std::thread> producers;
+    for (uint64_t p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&queue, p] {
+            for (uint64_t i = 0; i < COUNT; ++i) {
+                while (!queue.try_push_back(p * COUNT + i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    // Values of every producer come out in the order they have been pushed.
+    std::vector<uint64_t> expected(PRODUCERS, 0);
+    uint64_t received = 0;
+    while (received < PRODUCERS * COUNT) {
+        auto value = queue.try_pop_front();
+        if (value.has_value()) {
+            EXPECT_EQ(*value % COUNT, expected[*value / COUNT]);
+            expected[*value / COUNT] += 1;
+            ++received;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+}
+
+TEST(FrameBatch, StoresColumnsAligned) {
+    dpipe::FrameBatch<RawPayload> batch{TOTAL_FRAMES};
+    for (uint8_t level = 0; level < TOTAL_FRAMES; ++level) {
+        batch.push_back(RawPayload{level});
+    }
+    EXPECT_TRUE(batch.full());
+    const auto levels = batch.column<&RawPayload::level>();
+    ASSERT_EQ(levels.size(), TOTAL_FRAMES);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(levels.data()) % dpipe::FrameBatch<int>::ALIGNMENT,
+              0);
+    for (uint8_t level = 0; level < TOTAL_FRAMES; ++level) {
+        EXPECT_EQ(levels[level], level);
+        EXPECT_EQ(batch[level].level, level);
+    }
+    // Payloads without columns are stored whole.
+    dpipe::FrameBatch<uint64_t> whole{2};
+    whole.push_back(42);
+    EXPECT_EQ(whole.column_at<0>().front(), 42);
+}
+
+TEST(FrameBatch, BatchedCalibrationMatchesPerFrame) {
+    std::vector<float> expected;
+    auto pipeline1 = make_pipe(PercentageRecorderSink{expected}, CalibrationFilter{},
+                               RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline1);
+    std::vector<float> percentages;
+    auto pipeline2 = make_static_pipe(PercentageRecorderSink{percentages},
+                                      dpipe::Unbatcher<CalibratedPayload>{},
+                                      BatchCalibrationFilter{}, dpipe::Batcher<RawPayload>{4},
+                                      RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline2);
+    // The last, partial batch is flushed at the end of stream.
+    ASSERT_EQ(percentages.size(), expected.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_FLOAT_EQ(percentages[i], expected[i]);
+    }
+}
+
+TEST(FrameBatch, InPlaceFilterCopiesSharedBatches) {
+    std::vector<uint8_t> levels1;
+    std::vector<uint8_t> levels2;
+    uint8_t shift = 1;
+    auto arm1 = make_arm<dpipe::FrameBatch<RawPayload>>(RecorderSink{levels1},
+                                                        dpipe::Unbatcher<RawPayload>{},
+                                                        BatchShiftUpFilter{shift});
+    auto arm2 = make_arm<dpipe::FrameBatch<RawPayload>>(RecorderSink{levels2},
+                                                        dpipe::Unbatcher<RawPayload>{});
+    auto pipeline = make_pipe(make_splitter(std::move(arm1), std::move(arm2)),
+                              dpipe::Batcher<RawPayload>{3}, RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    ASSERT_EQ(levels1.size(), TOTAL_FRAMES);
+    ASSERT_EQ(levels2.size(), TOTAL_FRAMES);
+    for (uint8_t level = 0; level < TOTAL_FRAMES; ++level) {
+        EXPECT_EQ(levels1[level], level + shift);
+        EXPECT_EQ(levels2[level], level);
+    }
+}
+
+TEST(SpscQueue, CapacityIsRoundedUpToPowerOfTwo) {
+    EXPECT_EQ(dpipe::SpscQueue<int>{0}.capacity(), 2);
+    EXPECT_EQ(dpipe::SpscQueue<int>{5}.capacity(), 8);
+    EXPECT_EQ(dpipe::SpscQueue<int>{16}.capacity(), 16);
+}
+
+TEST(SpscQueue, PushAndPopInOrderUntilFull) {
+    dpipe::SpscQueue<int> queue{4};
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.try_push_back(int{i}));
+    }
+    EXPECT_FALSE(queue.try_push_back(4));
+    EXPECT_EQ(queue.size(), 4);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(queue.try_pop_front(), i);
+    }
+    EXPECT_FALSE(queue.try_pop_front().has_value());
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(SpscQueue, MovesFramesWithoutCopying) {
+    dpipe::SpscQueue<dpipe::Frame<RawPayload>> queue{2};
+    auto frame = dpipe::Frame<RawPayload>::make(uint8_t{7});
+    EXPECT_TRUE(queue.try_push_back(std::move(frame)));
+    auto popped = queue.try_pop_front();
+    ASSERT_TRUE(popped.has_value());
+    EXPECT_EQ((*popped)->level, 7);
+}
+
+TEST(SpscQueue, TransfersAcrossThreads) {
+    static constexpr uint64_t COUNT = 10000;
+    dpipe::SpscQueue<uint64_t> queue{64};
+    std::thread producer{[&queue] {
+        for (uint64_t i = 0; i < COUNT; ++i) {
+            while (!queue.try_push_back(uint64_t{i})) {
+                std::this_thread::yield();
+            }
+        }
+    }};
+    uint64_t expected = 0;
+    while (expected < COUNT) {
+        auto value = queue.try_pop_front();
+        if (value.has_value()) {
+            EXPECT_EQ(*value, expected);
+            ++expected;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+}
+
+TEST(AsyncQueue, TimedPopWakesUpOnPush) {
+    dpipe::AsyncQueue<int> queue;
+    std::thread producer{[&queue] { queue.push_back(42); }};
+    auto value = queue.try_pop_front_for(std::chrono::seconds(10));
+    producer.join();
+    EXPECT_EQ(value, 42);
+    EXPECT_FALSE(queue.try_pop_front_for(std::chrono::milliseconds(1)).has_value());
+}
+
+TEST(AsyncQueue, ReplacedElementsAreDestroyedOutsideTheLock) {
+    dpipe::AsyncQueue<dpipe::Frame<int>> queue;
+    int data = 0;
+    std::size_t size_on_release = 0;
+    // The releaser takes the lock of the queue, as a pool would take its own.
+    queue.push_back(dpipe::Frame<int>::adopt(
+            &data, [&](int*) { size_on_release = queue.size(); }));
+    EXPECT_EQ(queue.push_back_replacing(dpipe::Frame<int>::make(1)), 1);
+    EXPECT_EQ(size_on_release, 1);
+}
+
+TEST(Waiter, ParkedThreadIsWokenUpByNotify) {
+    dpipe::Waiter waiter{dpipe::WaitStrategy::Park};
+    std::atomic<bool> flag{false};
+    std::stop_source stop;
+    std::thread notifier{[&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        flag.store(true);
+        waiter.notify();
+    }};
+    EXPECT_TRUE(waiter.wait([&] { return flag.load(); }, stop.get_token()));
+    notifier.join();
+}
+
+TEST(Waiter, StopInterruptsParkedThread) {
+    for (auto strategy : {dpipe::WaitStrategy::BusySpin, dpipe::WaitStrategy::SpinYield,
+                          dpipe::WaitStrategy::Park, dpipe::WaitStrategy::SpinPark}) {
+        dpipe::Waiter waiter{strategy, 16};
+        std::stop_source stop;
+        std::thread stopper{[&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            stop.request_stop();
+        }};
+        EXPECT_FALSE(waiter.wait([] { return false; }, stop.get_token()));
+        stopper.join();
+    }
+}
+
+TEST(FramePool, RecyclesReleasedFrames) {
+    dpipe::FramePool<RawPayload> pool;
+    {
+        auto frame1 = dpipe::Frame<RawPayload>::make(pool, uint8_t{1});
+        auto frame2 = dpipe::MutFrame<RawPayload>::make(pool, uint8_t{2});
+        EXPECT_EQ(frame1->level, 1);
+        EXPECT_EQ(frame2->level, 2);
+        EXPECT_EQ(pool.stats().in_flight, 2);
+    }
+    for (uint8_t level = 0; level < TOTAL_FRAMES; ++level) {
+        auto frame = dpipe::Frame<RawPayload>::make(pool, level);
+        EXPECT_EQ(frame->level, level);
+    }
+    auto stats = pool.stats();
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.hits, TOTAL_FRAMES);
+    EXPECT_EQ(stats.in_flight, 0);
+    EXPECT_EQ(stats.high_water, 2);
+    EXPECT_GT(stats.hit_rate(), 0.8);
+}
+
+TEST(FramePool, RecyclesFramesReleasedByOtherThreads) {
+    dpipe::FramePool<RawPayload> pool;
+    uint64_t counter = 0;
+    auto pipeline = make_pipe(CounterSink<RawPayload>{counter}, dpipe::DecouplerPlaceholder{},
+                              PooledRampUpSource{TOTAL_FRAMES, pool});
+    run_pipeline(pipeline);
+    EXPECT_EQ(counter, TOTAL_FRAMES);
+    auto stats = pool.stats();
+    EXPECT_EQ(stats.hits + stats.misses, TOTAL_FRAMES);
+    EXPECT_EQ(stats.in_flight, 0);
+}
+
+TEST(FramePool, FramesOutliveThePool) {
+    auto pool = std::make_unique<dpipe::FramePool<RawPayload>>();
+    auto frame = dpipe::Frame<RawPayload>::make(*pool, uint8_t{3});
+    pool.reset();
+    EXPECT_EQ(frame->level, 3);
+}
+
+TEST(MutFrame, FromUniqueFrameReusesDataObject) {
+    auto frame = dpipe::Frame<RawPayload>::make(uint8_t{1});
+    const auto* address = &*frame;
+    auto mut_frame = dpipe::MutFrame<RawPayload>::from(std::move(frame));
+    EXPECT_EQ(&*mut_frame, address);
+    mut_frame->level = 2;
+    EXPECT_EQ(mut_frame->level, 2);
+}
+
+TEST(MutFrame, FromSharedFrameClonesDataObject) {
+    auto frame = dpipe::Frame<RawPayload>::make(uint8_t{1});
+    auto copy = frame;
+    auto mut_frame = dpipe::MutFrame<RawPayload>::from(std::move(copy));
+    EXPECT_NE(&*mut_frame, &*frame);
+    mut_frame->level = 2;
+    EXPECT_EQ(frame->level, 1);
+    EXPECT_EQ(mut_frame->level, 2);
+}
+
+TEST(Frame, AdoptedDataObjectIsReleasedWithLastReference) {
+    RawPayload buffer{7};
+    int released = 0;
+    auto frame = dpipe::Frame<RawPayload>::adopt(&buffer, [&](RawPayload* data) {
+        EXPECT_EQ(data, &buffer);
+        released += 1;
+    });
+    EXPECT_EQ(&*frame, &buffer);
+    auto copy = frame;
+    frame = dpipe::Frame<RawPayload>::make();
+    EXPECT_EQ(released, 0);
+    copy = dpipe::Frame<RawPayload>::make();
+    EXPECT_EQ(released, 1);
+}
+
+TEST(MutFrame, AdoptedDataObjectIsModifiedInPlace) {
+    RawPayload buffer{1};
+    int released = 0;
+    {
+        auto mut_frame =
+                dpipe::MutFrame<RawPayload>::adopt(&buffer, [&](RawPayload*) { released += 1; });
+        mut_frame->level = 2;
+        dpipe::Frame<RawPayload> frame = std::move(mut_frame);
+        // Once unique again, the adopted data object is reused.
+        auto again = dpipe::MutFrame<RawPayload>::from(std::move(frame));
+        EXPECT_EQ(&*again, &buffer);
+    }
+    EXPECT_EQ(buffer.level, 2);
+    EXPECT_EQ(released, 1);
+}
+
+TEST(Frame, AdoptedFramesFlowThroughSplittersAndDecouplers) {
+    std::vector<RawPayload> buffers;
+    for (uint8_t level = 0; level < TOTAL_FRAMES; ++level) {
+        buffers.push_back(RawPayload{level});
+    }
+    std::atomic<std::size_t> released{0};
+    std::vector<uint8_t> levels1;
+    std::vector<uint8_t> levels2;
+    auto arm1 = make_arm<RawPayload>(RecorderSink{levels1}, dpipe::DecouplerPlaceholder{});
+    auto arm2 = make_arm<RawPayload>(RecorderSink{levels2});
+    auto splitter = make_splitter(std::move(arm1), std::move(arm2));
+    {
+        auto pipeline = make_pipe(std::move(splitter), AdoptingSource{buffers, released});
+        run_pipeline(pipeline);
+    }
+    EXPECT_EQ(levels1, levels2);
+    EXPECT_EQ(levels1.size(), TOTAL_FRAMES);
+    EXPECT_EQ(released.load(), TOTAL_FRAMES);
+}
+
+TEST(Frame, ConfinedFramesCountReferencesAsSharedOnes) {
+    auto frame = dpipe::Frame<RawPayload>::make(uint8_t{1});
+    dpipe::impl::FrameOwnership::confine(frame);
+    EXPECT_TRUE(frame.is_unique());
+    {
+        auto copy = frame;
+        EXPECT_FALSE(frame.is_unique());
+        // Copies taken once shared are counted as well.
+        dpipe::impl::share_frame(copy);
+        auto other = copy;
+        EXPECT_FALSE(frame.is_unique());
+    }
+    EXPECT_TRUE(frame.is_unique());
+
+    // A frame referred to elsewhere is not confined.
+    auto copy = frame;
+    dpipe::impl::FrameOwnership::confine(copy);
+    EXPECT_FALSE(copy.is_unique());
+}
+
+TEST(Frame, ConfinedFramesAreSharedWhenHandedOverToAnotherThread) {
+    dpipe::FramePool<RawPayload> pool;
+    std::vector<uint8_t> levels1;
+    std::vector<uint8_t> levels2;
+    auto arm1 = make_static_arm<RawPayload>(RecorderSink{levels1}, dpipe::DecouplerPlaceholder{});
+    auto arm2 = make_static_arm<RawPayload>(RecorderSink{levels2}, ShiftUpFilter{0});
+    {
+        auto pipeline = make_static_pipe(make_splitter(std::move(arm1), std::move(arm2)),
+                                         PooledRampUpSource{TOTAL_FRAMES, pool});
+        run_pipeline(pipeline);
+    }
+    EXPECT_EQ(levels1, levels2);
+    EXPECT_EQ(levels1.size(), TOTAL_FRAMES);
+    EXPECT_EQ(pool.stats().in_flight, 0);
+}
+
+TEST(Frame, ViewSharesTheDataObjectOfItsParent) {
+    auto parent = dpipe::Frame<StereoPayload>::make(RawPayload{1}, RawPayload{2});
+    auto view = dpipe::Frame<RawPayload>::view_of(parent, parent->right);
+    EXPECT_EQ(&*view, &parent->right);
+    // The parent is still referred to, so the view is copied before being modified.
+    EXPECT_FALSE(view.is_unique());
+    auto copy = dpipe::MutFrame<RawPayload>::from(dpipe::Frame<RawPayload>{view});
+    EXPECT_NE(&*copy, &parent->right);
+
+    // The view keeps the data object alive, and is unique once the parent is gone.
+    const auto* right = &parent->right;
+    parent = dpipe::Frame<StereoPayload>::make();
+    auto mut_view = dpipe::MutFrame<RawPayload>::from(std::move(view));
+    EXPECT_EQ(&*mut_view, right);
+    mut_view->level = 3;
+    EXPECT_EQ(mut_view->level, 3);
+}
+
+TEST(Frame, FilterChangesPayloadTypeThroughViews) {
+    std::vector<uint8_t> levels;
+    auto pipeline = make_pipe(RecorderSink{levels}, LeftViewFilter{}, dpipe::DecouplerPlaceholder{},
+                              StereoSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    std::vector<uint8_t> expected;
+    for (uint8_t level = 0; level < TOTAL_FRAMES; ++level) {
+        expected.push_back(level);
+    }
+    EXPECT_EQ(levels, expected);
+}
+
+TEST(StaticPipe, StraightPipelineWithTypeChange) {
+    uint64_t counter = 0;
+    uint8_t threshold = 2;
+    auto pipeline = make_static_pipe(CounterSink<CalibratedPayload>{counter}, CalibrationFilter{},
+                                     ThresholdFilter{threshold}, RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    EXPECT_EQ(counter, TOTAL_FRAMES - threshold);
+}
+
+TEST(StaticPipe, StraightPipelineWithDecouplers) {
+    uint64_t counter = 0;
+    uint8_t shift = 1;
+    uint8_t threshold = 2;
+    auto pipeline = make_static_pipe(CounterSink<CalibratedPayload>{counter}, CalibrationFilter{},
+                                     dpipe::DecouplerPlaceholder{}, ThresholdFilter{threshold},
+                                     ShiftUpFilter{shift}, dpipe::DecouplerPlaceholder{},
+                                     RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    EXPECT_EQ(counter, TOTAL_FRAMES + shift - threshold);
+}
+
+TEST(StaticPipe, PipelineSplitIntoStaticArms) {
+    uint64_t counter1 = 0;
+    uint64_t counter2 = 0;
+    uint8_t threshold = 2;
+    auto arm1 = make_static_arm<RawPayload>(CounterSink<RawPayload>{counter1});
+    auto arm2 = make_static_arm<RawPayload>(CounterSink<CalibratedPayload>{counter2},
+                                            CalibrationFilter{}, dpipe::DecouplerPlaceholder{},
+                                            ThresholdFilter{threshold});
+    auto pipeline = make_static_pipe(make_splitter(std::move(arm1), std::move(arm2)),
+                                     RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    EXPECT_EQ(counter1, TOTAL_FRAMES);
+    EXPECT_EQ(counter2, TOTAL_FRAMES - threshold);
+}
+
+TEST(StaticPipe, BatchThroughStaticArm) {
+    std::vector<std::size_t> batch_sizes;
+    uint8_t threshold = 2;
+    auto arm = make_static_arm<RawPayload>(BatchRecorderSink{batch_sizes},
+                                           ThresholdFilter{threshold});
+    auto frames = make_frames(TOTAL_FRAMES);
+    arm->push_batch(frames);
+    EXPECT_EQ(batch_sizes, (std::vector<std::size_t>{std::size_t{TOTAL_FRAMES} - threshold}));
+}
+
+TEST(ParallelFilter, KeepsFramesInOrder) {
+    std::vector<uint8_t> levels;
+    uint8_t threshold = 2;
+    auto pipeline = make_pipe(RecorderSink{levels}, ThresholdFilter{threshold},
+                              dpipe::ParallelPlaceholder{[] { return JitterFilter{}; },
+                                                         {.threads = 3, .capacity = 2}},
+                              RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    std::vector<uint8_t> expected;
+    for (uint8_t level = threshold; level < TOTAL_FRAMES; ++level) {
+        expected.push_back(level);
+    }
+    EXPECT_EQ(levels, expected);
+}
+
+TEST(ParallelFilter, SkipsDiscardedFramesInOrder) {
+    std::vector<uint8_t> levels;
+    uint8_t threshold = 2;
+    auto pipeline = make_pipe(RecorderSink{levels},
+                              dpipe::ParallelPlaceholder{[&] { return ThresholdFilter{threshold}; },
+                                                         {.threads = 4}},
+                              RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    EXPECT_EQ(levels.size(), TOTAL_FRAMES - threshold);
+    EXPECT_TRUE(std::is_sorted(levels.begin(), levels.end()));
+}
+
+TEST(ParallelFilter, ForwardsAllFramesUnordered) {
+    std::vector<uint8_t> levels;
+    auto arm = make_static_arm<RawPayload>(
+            RecorderSink{levels},
+            dpipe::ParallelPlaceholder{[] { return JitterFilter{}; },
+                                       {.threads = 3, .ordered = false, .capacity = 2}});
+    for (uint8_t level = 0; level < TOTAL_FRAMES; ++level) {
+        arm->push(dpipe::Frame<RawPayload>::make(level));
+    }
+    arm->finish();
+    std::sort(levels.begin(), levels.end());
+    std::vector<uint8_t> expected;
+    for (uint8_t level = 0; level < TOTAL_FRAMES; ++level) {
+        expected.push_back(level);
+    }
+    EXPECT_EQ(levels, expected);
+}
+
+TEST(ThreadPool, RunsPostedTasks) {
+    static constexpr int TASKS = 100;
+    std::atomic<int> counter{0};
+    {
+        dpipe::ThreadPool pool{2};
+        for (int i = 0; i < TASKS; ++i) {
+            pool.post([&] {
+                // Tasks posted from a worker land in its own queue.
+                pool.post([&] { counter += 1; });
+            });
+        }
+        while (counter.load() < TASKS) {
+            std::this_thread::yield();
+        }
+    }
+    EXPECT_EQ(counter.load(), TASKS);
+}
+
+TEST(ThreadPool, RunsDelayedTasksOnceDue) {
+    dpipe::ThreadPool pool{2};
+    std::atomic<int> ran{0};
+    const auto posted = dpipe::Executor::Clock::now();
+    const auto delay = std::chrono::milliseconds(50);
+    std::atomic<dpipe::Executor::Clock::time_point> at{};
+    pool.post_at(posted + delay, [&] {
+        at.store(dpipe::Executor::Clock::now());
+        ran.fetch_add(1);
+        ran.notify_all();
+    });
+    pool.post([&] {
+        ran.fetch_add(1);
+        ran.notify_all();
+    });
+    for (int seen = ran.load(); seen < 2; seen = ran.load()) {
+        ran.wait(seen);
+    }
+    EXPECT_GE(at.load() - posted, delay);
+}
+
+TEST(ThreadPool, PipelineAndDecouplersShareThePool) {
+    auto pool = std::make_shared<dpipe::ThreadPool>(2);
+    uint64_t counter1 = 0;
+    uint64_t counter2 = 0;
+    uint8_t threshold = 2;
+    auto arm1 = make_arm<RawPayload>(CounterSink<RawPayload>{counter1},
+                                     dpipe::DecouplerPlaceholder{{.executor = pool}});
+    auto arm2 = make_arm<RawPayload>(CounterSink<CalibratedPayload>{counter2}, CalibrationFilter{},
+                                     dpipe::DecouplerPlaceholder{{.executor = pool}},
+                                     ThresholdFilter{threshold});
+    auto pipeline = make_pipe(make_splitter(std::move(arm1), std::move(arm2)),
+                              dpipe::DecouplerPlaceholder{{.executor = pool}},
+                              RampUpSource{TOTAL_FRAMES});
+    pipeline.start(pool);
+    pipeline.wait();
+    EXPECT_EQ(counter1, TOTAL_FRAMES);
+    EXPECT_EQ(counter2, TOTAL_FRAMES - threshold);
+}
+
+TEST(ThreadPool, BlockedProducerHelpsTheSingleWorker) {
+    auto pool = std::make_shared<dpipe::ThreadPool>(1);
+    uint64_t counter = 0;
+    auto pipeline = make_pipe(CounterSink<RawPayload>{counter},
+                              dpipe::DecouplerPlaceholder{{.capacity = 2, .executor = pool}},
+                              RampUpSource{TOTAL_FRAMES});
+    pipeline.start(pool);
+    pipeline.wait();
+    EXPECT_EQ(counter, TOTAL_FRAMES);
+}
+
+TEST(ThreadOptions, ParsesCpuLists) {
+    EXPECT_EQ(dpipe::parse_cpu_list("0-3,8,10-11"),
+              (std::vector<std::size_t>{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(dpipe::parse_cpu_list("5"), (std::vector<std::size_t>{5}));
+    EXPECT_TRUE(dpipe::parse_cpu_list("").empty());
+    EXPECT_EQ(dpipe::parse_cpu_list("x,2"), (std::vector<std::size_t>{2}));
+}
+
+#if defined(__linux__)
+static std::string current_thread_name() {
+    char name[16] = {};
+    pthread_getname_np(pthread_self(), name, sizeof(name));
+    return name;
+}
+
+static std::vector<std::size_t> current_thread_cpus() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+    std::vector<std::size_t> cpus;
+    for (std::size_t cpu = 0; cpu < static_cast<std::size_t>(CPU_SETSIZE); ++cpu) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+TEST(ThreadOptions, PipelineAndDecouplerThreadsAreNamedAndPinned) {
+    // Every process may run on the first CPU it is allowed to, so pin threads there.
+    const auto cpu = current_thread_cpus().front();
+    std::string source_name;
+    std::string sink_name;
+    std::vector<std::size_t> source_cpus;
+    std::vector<std::size_t> sink_cpus;
+    uint64_t counter = 0;
+    auto pipeline = make_pipe(
+            CounterSink<RawPayload>{counter}, ThreadProbeFilter{[&] {
+                sink_name = current_thread_name();
+                sink_cpus = current_thread_cpus();
+            }},
+            dpipe::DecouplerPlaceholder{{.thread = {.name = "dpipe-sink", .cpus = {cpu}}}},
+            ThreadProbeFilter{[&] {
+                source_name = current_thread_name();
+                source_cpus = current_thread_cpus();
+            }},
+            RampUpSource{TOTAL_FRAMES});
+    pipeline.start({.thread = {.name = "dpipe-source-thread", .cpus = {cpu}}});
+    pipeline.wait();
+    EXPECT_EQ(counter, TOTAL_FRAMES);
+    // Names are truncated to 15 characters.
+    EXPECT_EQ(source_name, "dpipe-source-th");
+    EXPECT_EQ(sink_name, "dpipe-sink");
+    EXPECT_EQ(source_cpus, std::vector<std::size_t>{cpu});
+    EXPECT_EQ(sink_cpus, std::vector<std::size_t>{cpu});
+}
+
+TEST(ThreadOptions, NumaNodeCpusAreListed) {
+    if (!std::filesystem::exists("/sys/devices/system/node/node0")) {
+        GTEST_SKIP() << "NUMA topology not exposed";
+    }
+    EXPECT_FALSE(dpipe::cpus_of_numa_node(0).empty());
+}
+
+TEST(ThreadOptions, FifoPriorityIsAppliedWhenPermitted) {
+    std::thread thread{[] {
+        // Not permitted without CAP_SYS_NICE, but then the policy must be left untouched.
+        const bool applied = dpipe::apply_thread_options({.fifo_priority = 1});
+        int policy = 0;
+        sched_param param{};
+        pthread_getschedparam(pthread_self(), &policy, &param);
+        if (applied) {
+            EXPECT_EQ(policy, SCHED_FIFO);
+            EXPECT_EQ(param.sched_priority, 1);
+        } else {
+            EXPECT_NE(policy, SCHED_FIFO);
+        }
+    }};
+    thread.join();
+}
+#endif
+
+#if !defined(_WIN32)
+TEST(Async, SourceAwaitsFileDescriptor) {
+    auto loop = std::make_shared<dpipe::EventLoop>();
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+    std::vector<uint8_t> levels;
+    auto pipeline = make_pipe(RecorderSink{levels},
+                              dpipe::AsyncPlaceholder{FdSource{*loop, fds[0]}, {.loop = loop}});
+    pipeline.start();
+    std::vector<uint8_t> expected;
+    for (uint8_t level = 0; level < TOTAL_FRAMES; ++level) {
+        ASSERT_EQ(::write(fds[1], &level, 1), 1);
+        expected.push_back(level);
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    ::close(fds[1]);
+    pipeline.wait();
+    ::close(fds[0]);
+    EXPECT_EQ(levels, expected);
+}
+
+TEST(Async, ManySourcesShareTheLoopThread) {
+    static constexpr std::size_t SOURCES = 8;
+    auto loop = std::make_shared<dpipe::EventLoop>(dpipe::ThreadOptions{.name = "dpipe-loop"});
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::vector<uint64_t> counters(SOURCES, 0);
+    std::vector<dpipe::Pipeline> pipelines;
+    for (std::size_t i = 0; i < SOURCES; ++i) {
+        pipelines.push_back(make_pipe(
+                CounterSink<RawPayload>{counters[i]}, ThreadProbeFilter{[&] {
+                    std::lock_guard<std::mutex> lock{mutex};
+                    threads.insert(std::this_thread::get_id());
+                }},
+                dpipe::AsyncPlaceholder{
+                        TimerSource{*loop, TOTAL_FRAMES, std::chrono::microseconds(500)},
+                        {.loop = loop}}));
+    }
+    for (auto& pipeline : pipelines) {
+        pipeline.start();
+    }
+    for (auto& pipeline : pipelines) {
+        pipeline.wait();
+    }
+    EXPECT_EQ(counters, std::vector<uint64_t>(SOURCES, TOTAL_FRAMES));
+    EXPECT_EQ(threads.size(), 1);
+}
+
+TEST(Async, FilterKeepsOrderAndDropsFrames) {
+    auto loop = std::make_shared<dpipe::EventLoop>();
+    std::vector<uint8_t> levels;
+    auto pipeline = make_pipe(RecorderSink{levels},
+                              dpipe::AsyncPlaceholder{DelayFilter{*loop}, {.loop = loop}},
+                              RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    std::vector<uint8_t> expected;
+    for (uint8_t level = 0; level < TOTAL_FRAMES; level += 2) {
+        expected.push_back(level);
+    }
+    EXPECT_EQ(levels, expected);
+}
+
+TEST(Async, SourceAndFilterOnTheSameLoop) {
+    auto loop = std::make_shared<dpipe::EventLoop>();
+    std::vector<uint8_t> levels;
+    auto pipeline = make_static_pipe(
+            RecorderSink{levels}, dpipe::AsyncPlaceholder{DelayFilter{*loop}, {.loop = loop}},
+            dpipe::AsyncPlaceholder{
+                    TimerSource{*loop, TOTAL_FRAMES, std::chrono::microseconds(100)},
+                    {.loop = loop}});
+    run_pipeline(pipeline);
+    std::vector<uint8_t> expected;
+    for (uint8_t level = 0; level < TOTAL_FRAMES; level += 2) {
+        expected.push_back(level);
+    }
+    EXPECT_EQ(levels, expected);
+}
+
+TEST(Async, DrainCancelsPendingWaits) {
+    auto loop = std::make_shared<dpipe::EventLoop>();
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+    uint64_t counter = 0;
+    {
+        // Nothing is ever written, so the source waits until drained.
+        auto pipeline = make_pipe(CounterSink<RawPayload>{counter},
+                                  dpipe::AsyncPlaceholder{FdSource{*loop, fds[0]}, {.loop = loop}});
+        pipeline.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        pipeline.drain();
+        // Stopping a source waiting on the loop cancels its wait as well.
+        pipeline.start();
+    }
+    ::close(fds[0]);
+    ::close(fds[1]);
+    EXPECT_EQ(counter, 0);
+}
+
+TEST(Async, LoopRunsDelayedTasksOnceDue) {
+    dpipe::EventLoop loop;
+    std::atomic<int> ran{0};
+    const auto posted = dpipe::EventLoop::Clock::now();
+    const auto delay = std::chrono::milliseconds(50);
+    std::atomic<dpipe::EventLoop::Clock::time_point> at{};
+    loop.post_at(posted + delay, [&] {
+        at.store(dpipe::EventLoop::Clock::now());
+        ran.fetch_add(1);
+        ran.notify_all();
+    });
+    // Delayed tasks do not hold back the others.
+    loop.post([&] {
+        EXPECT_EQ(ran.load(), 0);
+        ran.fetch_add(1);
+        ran.notify_all();
+    });
+    for (int seen = ran.load(); seen < 2; seen = ran.load()) {
+        ran.wait(seen);
+    }
+    EXPECT_GE(at.load() - posted, delay);
+}
+#endif
+
+#if !defined(_WIN32)
+TEST(MmapFile, SinkWritesRecordsReplayedBySource) {
+    const auto path = std::filesystem::temp_directory_path() / "dpipe-mmap-file-test.bin";
+    {
+        // Grow the file a few times.
+        auto pipeline = make_pipe(
+                dpipe::MmapFileSink<RawPayload>{path.string(), {.initial_capacity = 3}},
+                RampUpSource{TOTAL_FRAMES});
+        run_pipeline(pipeline);
+    }
+    EXPECT_EQ(std::filesystem::file_size(path), TOTAL_FRAMES * sizeof(RawPayload));
+    {
+        // Append as many records again.
+        auto pipeline = make_pipe(
+                dpipe::MmapFileSink<RawPayload>{path.string(), {.append = true}},
+                RampUpSource{TOTAL_FRAMES});
+        run_pipeline(pipeline);
+    }
+    std::vector<uint8_t> levels;
+    auto pipeline = make_pipe(
+            RecorderSink{levels},
+            dpipe::MmapFileSource<RawPayload>{path.string(), {.populate = true}});
+    run_pipeline(pipeline);
+    std::vector<uint8_t> expected;
+    for (int i = 0; i < 2; ++i) {
+        for (uint8_t level = 0; level < TOTAL_FRAMES; ++level) {
+            expected.push_back(level);
+        }
+    }
+    EXPECT_EQ(levels, expected);
+    std::filesystem::remove(path);
+}
+
+TEST(MmapFile, FramesPointIntoTheMappingAndKeepItAlive) {
+    const auto path = std::filesystem::temp_directory_path() / "dpipe-mmap-frame-test.bin";
+    {
+        dpipe::MmapFileSink<RawPayload> sink{path.string()};
+        for (uint8_t level = 0; level < TOTAL_FRAMES; ++level) {
+            sink.consume(dpipe::Frame<RawPayload>::make(level));
+        }
+    }
+    std::optional<dpipe::Frame<RawPayload>> first;
+    std::optional<dpipe::Frame<RawPayload>> second;
+    {
+        dpipe::MmapFileSource<RawPayload> source{path.string()};
+        ASSERT_TRUE(source.is_open());
+        EXPECT_EQ(source.size(), TOTAL_FRAMES);
+        first = source.produce();
+        second = source.produce();
+    }
+    std::filesystem::remove(path);
+    // Records are contiguous in the mapping, which outlives the source and the file.
+    EXPECT_EQ(&**second, &**first + 1);
+    EXPECT_EQ((*second)->level, 1);
+    // Once unique, the frame is modified in place, without affecting the file.
+    second.reset();
+    auto mutable_frame = dpipe::MutFrame<RawPayload>::from(std::move(*first));
+    mutable_frame->level = 42;
+    EXPECT_EQ(mutable_frame->level, 42);
+}
+
+TEST(MmapFile, MissingFileIsAnEmptyStream) {
+    dpipe::MmapFileSource<RawPayload> source{"/nonexistent/dpipe-mmap-file.bin"};
+    EXPECT_FALSE(source.is_open());
+    EXPECT_FALSE(source.produce().has_value());
+    EXPECT_TRUE(source.end_of_stream());
+}
+#endif
+
+#if !defined(_WIN32)
+static std::string shm_test_name(const char* test) {
+    return "/dpipe-" + std::string{test} + "-" + std::to_string(::getpid());
+}
+
+TEST(SharedMemory, ForkedProducerFeedsConsumer) {
+    const auto name = shm_test_name("fork");
+    const pid_t child = ::fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        // A ring smaller than the stream, so that the producer waits for the consumer, once
+        // attached.
+        dpipe::ShmSink<RawPayload> sink{name, {.capacity = 4}};
+        while (!sink.is_attached()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+        auto pipeline = make_pipe(std::move(sink), RampUpSource{TOTAL_FRAMES});
+        run_pipeline(pipeline);
+        ::_exit(0);
+    }
+    std::vector<uint8_t> levels;
+    auto pipeline = make_pipe(RecorderSink{levels}, dpipe::ShmSource<RawPayload>{name});
+    run_pipeline(pipeline);
+    int status = -1;
+    ASSERT_EQ(::waitpid(child, &status, 0), child);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    std::vector<uint8_t> expected;
+    for (uint8_t level = 0; level < TOTAL_FRAMES; ++level) {
+        expected.push_back(level);
+    }
+    EXPECT_EQ(levels, expected);
+}
+
+TEST(SharedMemory, SlotsAreHandedBackInOrderOnceReleased) {
+    const auto name = shm_test_name("release");
+    dpipe::ShmSink<RawPayload> sink{name, {.capacity = 2}};
+    ASSERT_TRUE(sink.is_open());
+    dpipe::ShmSource<RawPayload> source{name};
+    ASSERT_TRUE(source.is_open());
+    sink.consume(dpipe::Frame<RawPayload>::make(uint8_t{0}));
+    sink.consume(dpipe::Frame<RawPayload>::make(uint8_t{1}));
+    auto first = source.produce();
+    auto second = source.produce();
+    ASSERT_TRUE(first.has_value() && second.has_value());
+    EXPECT_EQ((*first)->level, 0);
+    EXPECT_EQ((*second)->level, 1);
+
+    // The ring is full: the third frame waits for the first slot.
+    std::atomic<bool> written{false};
+    std::jthread producer{[&] {
+        sink.consume(dpipe::Frame<RawPayload>::make(uint8_t{2}));
+        written.store(true);
+    }};
+    second.reset();
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+    EXPECT_FALSE(written.load());
+    first.reset();
+    producer.join();
+    EXPECT_TRUE(written.load());
+    auto third = source.produce();
+    ASSERT_TRUE(third.has_value());
+    EXPECT_EQ((*third)->level, 2);
+    EXPECT_FALSE(source.end_of_stream());
+    sink.finish();
+    EXPECT_FALSE(source.produce().has_value());
+    EXPECT_TRUE(source.end_of_stream());
+}
+
+TEST(SharedMemory, ConsumerReachesEndOfStreamWhenProducerExits) {
+    const auto name = shm_test_name("crash");
+    const pid_t child = ::fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        // Exit without reaching the end of stream, as if the producer crashed.
+        dpipe::ShmSink<RawPayload> sink{name};
+        sink.consume(dpipe::Frame<RawPayload>::make(uint8_t{42}));
+        ::_exit(0);
+    }
+    ASSERT_EQ(::waitpid(child, nullptr, 0), child);
+    std::vector<uint8_t> levels;
+    auto pipeline = make_pipe(RecorderSink{levels}, dpipe::ShmSource<RawPayload>{name});
+    run_pipeline(pipeline);
+    EXPECT_EQ(levels, std::vector<uint8_t>{42});
+}
+
+TEST(SharedMemory, SinkDiscardsFramesThatDoNotFitUntilASourceAttaches) {
+    dpipe::ShmSink<RawPayload> sink{shm_test_name("unattached"), {.capacity = 2}};
+    ASSERT_TRUE(sink.is_open());
+    EXPECT_FALSE(sink.is_attached());
+    for (uint8_t level = 0; level < 5; ++level) {
+        sink.consume(dpipe::Frame<RawPayload>::make(level));
+    }
+    EXPECT_EQ(sink.discarded(), 3);
+}
+
+TEST(SharedMemory, SourceIsIdleUntilTheRingExists) {
+    dpipe::ShmSource<RawPayload> source{shm_test_name("missing"), {.idle_timeout = {}}};
+    EXPECT_FALSE(source.is_open());
+    EXPECT_FALSE(source.produce().has_value());
+    EXPECT_FALSE(source.end_of_stream());
+}
+#endif
+
+TEST(Metrics, HistogramBucketsAreLogLinear) {
+    using dpipe::LatencyHistogram;
+    for (uint64_t value : {0u, 1u, 7u, 8u, 15u, 16u, 17u, 1000u, 123456u}) {
+        const auto bucket = LatencyHistogram::bucket_of(value);
+        EXPECT_LE(LatencyHistogram::lower_bound_of(bucket), value);
+        EXPECT_GT(LatencyHistogram::lower_bound_of(bucket + 1), value);
+    }
+    EXPECT_LT(LatencyHistogram::bucket_of(UINT64_MAX), LatencyHistogram::BUCKETS);
+
+    LatencyHistogram histogram;
+    histogram.record(100, 99);
+    histogram.record(10000);
+    const auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 100);
+    EXPECT_EQ(snapshot.mean(), std::chrono::nanoseconds(199));
+    EXPECT_EQ(snapshot.percentile(0.5), std::chrono::nanoseconds(103));
+    EXPECT_EQ(snapshot.percentile(0.999), std::chrono::nanoseconds(10239));
+}
+
+TEST(Metrics, PipelineReportsEveryElement) {
+    uint64_t counter = 0;
+    uint8_t threshold = 2;
+    auto pipeline = make_pipe(CounterSink<CalibratedPayload>{counter}, CalibrationFilter{},
+                              ThresholdFilter{threshold}, dpipe::DecouplerPlaceholder{},
+                              RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    const auto metrics = pipeline.metrics();
+    ASSERT_EQ(metrics.size(), 5);
+
+    EXPECT_EQ(metrics[0].kind, "Source");
+    EXPECT_EQ(metrics[0].frames_out, TOTAL_FRAMES);
+    EXPECT_EQ(metrics[0].latency.count, TOTAL_FRAMES);
+    EXPECT_TRUE(metrics[0].utilization.has_value());
+
+    EXPECT_EQ(metrics[1].kind, "Decoupler");
+    EXPECT_EQ(metrics[1].frames_in, TOTAL_FRAMES);
+    EXPECT_EQ(metrics[1].frames_out, TOTAL_FRAMES);
+    EXPECT_EQ(metrics[1].queue_depth, 0);
+    EXPECT_GE(metrics[1].peak_queue_depth, 1);
+    EXPECT_TRUE(metrics[1].utilization.has_value());
+
+    EXPECT_EQ(metrics[2].kind, "Filter");
+    EXPECT_EQ(metrics[2].frames_in, TOTAL_FRAMES);
+    EXPECT_EQ(metrics[2].frames_out, TOTAL_FRAMES - threshold);
+    EXPECT_EQ(metrics[2].frames_dropped, threshold);
+    EXPECT_EQ(metrics[2].latency.count, TOTAL_FRAMES);
+    EXPECT_FALSE(metrics[2].utilization.has_value());
+
+    EXPECT_EQ(metrics[3].kind, "Filter");
+    EXPECT_EQ(metrics[3].frames_out, TOTAL_FRAMES - threshold);
+
+    EXPECT_EQ(metrics[4].kind, "Sink");
+    EXPECT_EQ(metrics[4].frames_in, TOTAL_FRAMES - threshold);
+    EXPECT_EQ(counter, TOTAL_FRAMES - threshold);
+}
+
+TEST(Metrics, SplitterAndStaticArmsReportInDepthFirstOrder) {
+    uint64_t counter1 = 0;
+    uint64_t counter2 = 0;
+    uint8_t threshold = 2;
+    auto arm1 = make_static_arm<RawPayload>(CounterSink<RawPayload>{counter1});
+    auto arm2 = make_arm<RawPayload>(CounterSink<RawPayload>{counter2}, ThresholdFilter{threshold});
+    auto pipeline = make_static_pipe(make_splitter(std::move(arm1), std::move(arm2)),
+                                     RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    const auto metrics = pipeline.metrics();
+    std::vector<std::string> kinds;
+    for (const auto& element : metrics) {
+        kinds.push_back(element.kind);
+    }
+    EXPECT_EQ(kinds, (std::vector<std::string>{"Source", "Splitter", "Sink", "Filter", "Sink"}));
+    EXPECT_EQ(metrics[1].frames_out, 2 * TOTAL_FRAMES);
+    EXPECT_EQ(metrics[2].frames_in, TOTAL_FRAMES);
+    EXPECT_EQ(metrics[4].frames_in, TOTAL_FRAMES - threshold);
+}
+
+// Counts the frames of the events with the given name and phase.
+static std::size_t count_events(const std::vector<dpipe::TraceEvent>& events,
+                                std::string_view name, dpipe::TraceEvent::Phase phase) {
+    std::size_t count = 0;
+    for (const auto& event : events) {
+        if (event.name == name && event.phase == phase) {
+            count += event.count;
+        }
+    }
+    return count;
+}
+
+TEST(Tracing, RecordsSpansOfEveryElementAndQueueWaits) {
+    using Phase = dpipe::TraceEvent::Phase;
+    dpipe::clear_trace();
+    dpipe::enable_tracing();
+    uint64_t counter = 0;
+    uint8_t threshold = 0;
+    auto pipeline = make_pipe(CounterSink<RawPayload>{counter}, ThresholdFilter{threshold},
+                              dpipe::DecouplerPlaceholder{}, RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    dpipe::disable_tracing();
+    const auto events = dpipe::collect_trace();
+    EXPECT_EQ(count_events(events, "Source", Phase::Span), TOTAL_FRAMES);
+    EXPECT_EQ(count_events(events, "Decoupler", Phase::QueueBegin), TOTAL_FRAMES);
+    EXPECT_EQ(count_events(events, "Decoupler", Phase::QueueEnd), TOTAL_FRAMES);
+    EXPECT_EQ(count_events(events, "Threshold", Phase::Span), TOTAL_FRAMES);
+    EXPECT_EQ(count_events(events, "Sink", Phase::Span), TOTAL_FRAMES);
+    EXPECT_TRUE(std::is_sorted(events.begin(), events.end(),
+                               [](auto& a, auto& b) { return a.begin < b.begin; }));
+
+    // Every frame leaves the queue on another thread, after entering it.
+    for (const auto& begin : events) {
+        if (begin.phase != Phase::QueueBegin) {
+            continue;
+        }
+        const auto end = std::find_if(events.begin(), events.end(), [&](auto& event) {
+            return event.phase == Phase::QueueEnd && event.frame == begin.frame;
+        });
+        ASSERT_NE(end, events.end());
+        EXPECT_NE(end->thread, begin.thread);
+        EXPECT_GE(end->begin, begin.begin);
+    }
+}
+
+TEST(Tracing, FramesKeepTheIdAssignedByTheirSource) {
+    using Phase = dpipe::TraceEvent::Phase;
+    dpipe::clear_trace();
+    dpipe::enable_tracing();
+    uint64_t counter = 0;
+    // The filter outputs new data objects, recycled from a pool, one frame at a time.
+    auto pipeline = make_pipe(CounterSink<CalibratedPayload>{counter}, CalibrationFilter{},
+                              dpipe::DecouplerPlaceholder{{.max_batch = 1}},
+                              RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    dpipe::disable_tracing();
+    std::vector<uint64_t> sourced;
+    std::vector<uint64_t> sunk;
+    for (const auto& event : dpipe::collect_trace()) {
+        if (event.phase != Phase::Span) {
+            continue;
+        }
+        if (std::string_view{event.name} == "Source") {
+            sourced.push_back(event.frame);
+        } else if (std::string_view{event.name} == "Sink") {
+            sunk.push_back(event.frame);
+        }
+    }
+    ASSERT_EQ(sourced.size(), TOTAL_FRAMES);
+    for (uint64_t i = 0; i < TOTAL_FRAMES; ++i) {
+        EXPECT_EQ(sourced[i], sourced[0] + i);
+    }
+    EXPECT_EQ(sunk, sourced);
+}
+
+TEST(Tracing, FramesMergedFromSeveralSourcesHaveDistinctIds) {
+    using Phase = dpipe::TraceEvent::Phase;
+    dpipe::clear_trace();
+    dpipe::enable_tracing();
+    uint64_t counter = 0;
+    auto merger = dpipe::make_merger(2, {}, make_arm<RawPayload>(CounterSink<RawPayload>{counter},
+                                                                 dpipe::DecouplerPlaceholder{}));
+    auto pipeline1 = make_pipe(merger.input(0), RampUpSource{TOTAL_FRAMES});
+    auto pipeline2 = make_pipe(merger.input(1), RampUpSource{TOTAL_FRAMES});
+    pipeline1.start();
+    pipeline2.start();
+    pipeline1.wait();
+    pipeline2.wait();
+    dpipe::disable_tracing();
+    ASSERT_EQ(counter, 2 * TOTAL_FRAMES);
+    // Both sources number their frames from 0, yet every frame enters and leaves the queue of the
+    // decoupler under its own id.
+    std::set<uint64_t> queued;
+    std::set<uint64_t> dequeued;
+    for (const auto& event : dpipe::collect_trace()) {
+        if (event.phase == Phase::QueueBegin) {
+            queued.insert(event.frame);
+        } else if (event.phase == Phase::QueueEnd) {
+            dequeued.insert(event.frame);
+        }
+    }
+    EXPECT_EQ(queued.size(), 2 * TOTAL_FRAMES);
+    EXPECT_EQ(dequeued, queued);
+}
+
+TEST(Tracing, NothingIsRecordedUnlessEnabled) {
+    dpipe::clear_trace();
+    uint64_t counter = 0;
+    auto pipeline = make_pipe(CounterSink<RawPayload>{counter}, RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    EXPECT_EQ(counter, TOTAL_FRAMES);
+    EXPECT_TRUE(dpipe::collect_trace().empty());
+}
+
+TEST(Tracing, ThreadsKeepTheirLatestEvents) {
+    dpipe::clear_trace();
+    dpipe::enable_tracing(4);
+    uint64_t counter = 0;
+    auto pipeline = make_pipe(CounterSink<RawPayload>{counter}, RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+    dpipe::disable_tracing();
+    const auto events = dpipe::collect_trace();
+    ASSERT_GE(events.size(), 4);
+    EXPECT_LT(events.size(), 2 * TOTAL_FRAMES);
+    EXPECT_EQ(events.back().name, std::string_view{"Sink"});
+}
+
+TEST(Tracing, WritesChromeTraceOfATimeWindow) {
+    dpipe::clear_trace();
+    dpipe::enable_tracing();
+    const auto since = std::chrono::steady_clock::now();
+    uint64_t counter = 0;
+    auto pipeline = make_pipe(CounterSink<RawPayload>{counter}, dpipe::DecouplerPlaceholder{},
+                              RampUpSource{TOTAL_FRAMES});
+    pipeline.start({.thread = {.name = "traced-source"}});
+    pipeline.wait();
+    dpipe::disable_tracing();
+
+    std::ostringstream trace;
+    dpipe::write_chrome_trace(trace, since);
+    const auto json = trace.str();
+    EXPECT_TRUE(json.starts_with("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    EXPECT_TRUE(json.ends_with("]}\n"));
+    EXPECT_NE(json.find("\"args\":{\"name\":\"traced-source\"}"), std::string::npos);
+    EXPECT_NE(json.find("{\"name\":\"Source\",\"cat\":\"dpipe\",\"ph\":\"X\""),
+              std::string::npos);
+    EXPECT_NE(json.find("{\"name\":\"Decoupler\",\"cat\":\"dpipe\",\"ph\":\"b\""),
+              std::string::npos);
+
+    // Events before the window are left out.
+    std::ostringstream later;
+    dpipe::write_chrome_trace(later, std::chrono::steady_clock::now());
+    EXPECT_EQ(later.str().find("\"ph\":\"X\""), std::string::npos);
+}
+
+TEST(FrameHeader, IsCarriedByCopiesMutFramesAndViews) {
+    auto frame = dpipe::Frame<StereoPayload>::make(RawPayload{1}, RawPayload{2});
+    EXPECT_FALSE(frame.header().is_stamped());
+    dpipe::FrameHeader header;
+    header.sequence = 7;
+    header.created = std::chrono::steady_clock::now();
+    frame.set_header(header);
+
+    const auto copy = frame;
+    EXPECT_EQ(copy.header().sequence, 7);
+    // The data object is shared, so it is deep-copied along with the header.
+    auto mut = dpipe::MutFrame<StereoPayload>::from(dpipe::Frame<StereoPayload>{frame});
+    EXPECT_EQ(mut.header().sequence, 7);
+    EXPECT_EQ(mut.into_immutable().header().created, header.created);
+    const auto view = dpipe::Frame<RawPayload>::view_of(frame, frame->left);
+    EXPECT_EQ(view.header().sequence, 7);
+}
+
+// Number of hops recorded out of the given number of filters, as `DPIPE_FRAME_HEADER_HOPS` may be
+// set by the build.
+static uint32_t recorded_hops(uint32_t filters) {
+    return static_cast<uint32_t>(std::min<std::size_t>(filters, dpipe::FrameHeader::MAX_HOPS));
+}
+
+TEST(FrameHeader, SourcesStampAndFiltersCarryHeaders) {
+    std::vector<dpipe::FrameHeader> headers1;
+    std::vector<dpipe::FrameHeader> headers2;
+    const auto before = std::chrono::steady_clock::now();
+    auto arm1 = make_arm<RawPayload>(HeaderRecorderSink{headers1});
+    auto arm2 = make_arm<RawPayload>(HeaderRecorderSink{headers2}, ShiftUpFilter{1});
+    auto pipeline = make_pipe(make_splitter(std::move(arm1), std::move(arm2)),
+                              dpipe::DecouplerPlaceholder{}, ThresholdFilter{2},
+                              RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+
+    ASSERT_EQ(headers1.size(), TOTAL_FRAMES - 2);
+    ASSERT_EQ(headers2.size(), TOTAL_FRAMES - 2);
+    for (std::size_t i = 0; i < headers1.size(); ++i) {
+        // Frames dropped by the filter leave a gap in the sequence.
+        EXPECT_EQ(headers1[i].sequence, i + 2);
+        EXPECT_GE(headers1[i].created, before);
+        ASSERT_EQ(headers1[i].hop_count, recorded_hops(1));
+        // The filter of the second arm records one more hop.
+        EXPECT_EQ(headers2[i].sequence, headers1[i].sequence);
+        EXPECT_EQ(headers2[i].created, headers1[i].created);
+        ASSERT_EQ(headers2[i].hop_count, recorded_hops(2));
+        if constexpr (dpipe::FrameHeader::MAX_HOPS >= 2) {
+            EXPECT_GE(headers1[i].hops[0], headers1[i].created);
+            EXPECT_GE(headers2[i].hops[1], headers2[i].hops[0]);
+        }
+    }
+}
+
+TEST(FrameHeader, FiltersCarryHeadersOfBatches) {
+    std::vector<dpipe::FrameHeader> headers;
+    // On a single worker, the source pushes every frame before the decoupler forwards them as a
+    // batch.
+    auto pool = std::make_shared<dpipe::ThreadPool>(1);
+    auto pipeline = make_pipe(HeaderRecorderSink{headers}, BatchRebuildFilter{}, ThresholdFilter{2},
+                              dpipe::DecouplerPlaceholder{{.executor = pool}},
+                              RampUpSource{TOTAL_FRAMES});
+    pipeline.start(pool);
+    pipeline.wait();
+
+    ASSERT_EQ(headers.size(), TOTAL_FRAMES - 2);
+    for (std::size_t i = 0; i < headers.size(); ++i) {
+        EXPECT_TRUE(headers[i].is_stamped());
+        EXPECT_EQ(headers[i].sequence, i + 2);
+        // Both filters record a hop, whether frames are passed through or created.
+        EXPECT_EQ(headers[i].hop_count, recorded_hops(2));
+    }
+}
+
+TEST(FrameHeader, BatchOutputsTakeTheFirstHeaderUnlessAsManyAsInputs) {
+    std::vector<dpipe::FrameHeader> headers;
+    auto arm = make_arm<RawPayload>(HeaderRecorderSink{headers}, BatchRebuildFilter{true});
+    std::vector<dpipe::Frame<RawPayload>> frames;
+    for (uint8_t level = 0; level < 3; ++level) {
+        frames.push_back(dpipe::Frame<RawPayload>::make(level));
+        dpipe::FrameHeader header;
+        header.sequence = 5 + level;
+        header.created = std::chrono::steady_clock::now();
+        frames.back().set_header(header);
+    }
+    arm->push_batch(frames);
+    ASSERT_EQ(headers.size(), 1);
+    EXPECT_EQ(headers[0].sequence, 5);
+}
+
+TEST(LatencySink, ReportsPercentilesAndGaps) {
+    using namespace std::chrono_literals;
+    dpipe::LatencyMonitor monitor;
+    const auto now = std::chrono::steady_clock::now();
+    const auto record = [&](uint64_t sequence, std::chrono::nanoseconds age) {
+        dpipe::FrameHeader header;
+        header.sequence = sequence;
+        header.created = now - age;
+        monitor.record(header, now);
+    };
+    for (uint64_t i = 0; i < 1000; ++i) {
+        record(i, i >= 998 ? 1ms : 10us);
+    }
+    // Sequence numbers 1000 to 1002 are skipped, then 1002 arrives late, and 1004 twice.
+    record(1003, 10us);
+    record(1002, 10us);
+    record(1004, 10us);
+    record(1004, 10us);
+    monitor.record(dpipe::FrameHeader{}, now);
+
+    const auto report = monitor.report();
+    EXPECT_EQ(report.frames, 1005);
+    EXPECT_EQ(report.unstamped, 1);
+    EXPECT_EQ(report.latency.count, 1004);
+    EXPECT_GE(report.p50, 10us);
+    EXPECT_LE(report.p50, 12us);
+    EXPECT_LE(report.p99, 12us);
+    EXPECT_GE(report.p999, 1ms);
+    EXPECT_EQ(report.gaps, 1);
+    EXPECT_EQ(report.missing, 3);
+    EXPECT_EQ(report.late, 1);
+}
+
+TEST(LatencySink, MeasuresFramesOfAPipeline) {
+    dpipe::LatencyMonitor monitor;
+    uint64_t counter = 0;
+    auto arm1 = make_arm<RawPayload>(CounterSink<RawPayload>{counter});
+    auto arm2 = make_arm<RawPayload>(dpipe::LatencySink<RawPayload>{monitor});
+    auto pipeline = make_pipe(make_splitter(std::move(arm1), std::move(arm2)),
+                              dpipe::DecouplerPlaceholder{}, ThresholdFilter{3},
+                              RampUpSource{TOTAL_FRAMES});
+    run_pipeline(pipeline);
+
+    const auto report = monitor.report();
+    EXPECT_EQ(counter, TOTAL_FRAMES - 3);
+    EXPECT_EQ(report.frames, TOTAL_FRAMES - 3);
+    EXPECT_EQ(report.latency.count, TOTAL_FRAMES - 3);
+    EXPECT_GT(report.p50.count(), 0);
+    EXPECT_GE(report.p999, report.p50);
+    EXPECT_EQ(report.gaps, 1);
+    EXPECT_EQ(report.missing, 3);
+    EXPECT_EQ(report.late, 0);
+}
+
+static dpipe::Frame<RawPayload> make_aged_frame(uint8_t level, std::chrono::nanoseconds age) {
+    auto frame = dpipe::Frame<RawPayload>::make(level);
+    dpipe::FrameHeader header;
+    header.sequence = level;
+    header.created = std::chrono::steady_clock::now() - age;
+    frame.set_header(header);
+    return frame;
+}
+
+TEST(Shedding, ShedderDiscardsFramesPastTheirDeadline) {
+    using namespace std::chrono_literals;
+    std::vector<uint8_t> levels;
+    auto counters = std::make_shared<dpipe::SheddingCounters>();
+    auto arm = make_arm<RawPayload>(
+            RecorderSink{levels},
+            dpipe::Shedder<RawPayload, dpipe::DeadlineShedding>{dpipe::DeadlineShedding{10s},
+                                                                counters});
+    arm->push(make_aged_frame(0, 0s));
+    arm->push(make_aged_frame(1, 1min));
+    std::vector<dpipe::Frame<RawPayload>> frames;
+    for (uint8_t level = 2; level < TOTAL_FRAMES; ++level) {
+        frames.push_back(make_aged_frame(level, level % 2 == 0 ? 0s : 1min));
+    }
+    arm->push_batch(frames);
+    // Frames without a header stamped by a source are never discarded.
+    arm->push(dpipe::Frame<RawPayload>::make(TOTAL_FRAMES));
+
+    EXPECT_EQ(levels, (std::vector<uint8_t>{0, 2, 4, 6, 8, TOTAL_FRAMES}));
+    EXPECT_EQ(counters->shed.load(), TOTAL_FRAMES / 2);
+}
+
+TEST(Shedding, DecouplerDiscardsStaleFramesBeforeForwarding) {
+    using namespace std::chrono_literals;
+    std::vector<uint8_t> levels;
+    auto counters = std::make_shared<dpipe::DecouplerCounters>();
+    {
+        dpipe::Decoupler<RawPayload> decoupler{std::make_unique<dpipe::Sink<RecorderSink>>(levels),
+                                               {.max_age = 10s, .counters = counters}};
+        for (uint8_t level = 0; level < TOTAL_FRAMES; ++level) {
+            decoupler.push(make_aged_frame(level, level % 3 == 0 ? 1min : 0s));
+        }
+        decoupler.finish();
+    }
+    EXPECT_EQ(levels, (std::vector<uint8_t>{1, 2, 4, 5, 7, 8}));
+    EXPECT_EQ(counters->shed.load(), 4);
+    EXPECT_EQ(counters->dropped.load(), 0);
+}
+
+TEST(Shedding, EveryNthShedsPartOfTheFramesUnderPressure) {
+    using namespace std::chrono_literals;
+    dpipe::EveryNthShedding policy{dpipe::DeadlineShedding{10s}, 3};
+    const auto now = std::chrono::steady_clock::now();
+    dpipe::FrameHeader stale;
+    stale.created = now - 1min;
+    dpipe::FrameHeader fresh;
+    fresh.created = now;
+
+    std::vector<bool> shed;
+    for (const auto* header : {&stale, &stale, &stale, &stale, &fresh, &stale, &stale, &stale}) {
+        shed.push_back(policy.shed(*header, now));
+    }
+    // The count starts over once the pressure is relieved.
+    EXPECT_EQ(shed, (std::vector<bool>{false, false, true, false, false, false, false, true}));
+}
+
+TEST(Shedding, QueueDepthShedsWhileTheDecouplerIsBackedUp) {
+    auto counters = std::make_shared<dpipe::DecouplerCounters>();
+    dpipe::QueueDepthShedding policy{counters, 3};
+    const dpipe::FrameHeader header;
+    const auto now = std::chrono::steady_clock::now();
+    EXPECT_FALSE(policy.shed(header, now));
+    counters->queue_depth.store(4);
+    EXPECT_TRUE(policy.shed(header, now));
+    counters->queue_depth.store(3);
+    EXPECT_FALSE(policy.shed(header, now));
+}
@@ -1,21 +1,38 @@
 #ifndef DPIPE_TESTS_TOYS_H_
 #define DPIPE_TESTS_TOYS_H_
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <limits>
 #include <optional>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
 
+#include <dpipe/frame-batch.h>
+#include <dpipe/frame-pool.h>
 #include <dpipe/frame.h>
 #include <dpipe/mut-frame.h>
 
+#if !defined(_WIN32)
+#include <dpipe/utils/coroutine.h>
+#include <dpipe/utils/event-loop.h>
+#include <unistd.h>
+#endif
+
 struct RawPayload {
     static constexpr uint8_t MAX_LEVEL = std::numeric_limits<uint8_t>::max();
     uint8_t level{};
+    static constexpr auto COLUMNS = std::tuple{&RawPayload::level};
 };
 
 struct CalibratedPayload {
     float percentage{};
+    static constexpr auto COLUMNS = std::tuple{&CalibratedPayload::percentage};
 };
 
 class RampUpSource {
@@ -37,11 +54,231 @@ public:
         return frame;
     }
 
+    bool end_of_stream() const {
+        return counter_ >= target_level_;
+    }
+
+private:
+    uint8_t target_level_{};
+    uint8_t counter_{};
+};
+
+class PooledRampUpSource {
+public:
+    using OutputPayload = RawPayload;
+    using OutputFrame = dpipe::Frame<OutputPayload>;
+
+    PooledRampUpSource(uint8_t target_level, dpipe::FramePool<RawPayload> pool)
+            : target_level_{target_level}
+            , pool_{std::move(pool)} {}
+
+    std::optional<OutputFrame> produce() {
+        if (counter_ >= target_level_) {
+            return {};
+        }
+
+        // Create a new immutable frame, recycling the memory of released frames.
+        auto frame = dpipe::Frame<RawPayload>::make(pool_, counter_);
+        counter_ += 1;
+        return frame;
+    }
+
+    bool end_of_stream() const {
+        return counter_ >= target_level_;
+    }
+
+private:
+    uint8_t target_level_{};
+    uint8_t counter_{};
+    dpipe::FramePool<RawPayload> pool_;
+};
+
+class AdoptingSource {
+public:
+    using OutputPayload = RawPayload;
+    using OutputFrame = dpipe::Frame<OutputPayload>;
+
+    // The buffers must outlive the frames. Every released buffer is counted.
+    AdoptingSource(std::vector<RawPayload>& buffers, std::atomic<std::size_t>& released)
+            : buffers_{buffers}
+            , released_{released} {}
+
+    std::optional<OutputFrame> produce() {
+        if (next_ >= buffers_.get().size()) {
+            return {};
+        }
+
+        // Wrap an externally-owned buffer, without copying it.
+        auto& released = released_.get();
+        auto frame = OutputFrame::adopt(&buffers_.get()[next_],
+                                        [&released](RawPayload*) { released.fetch_add(1); });
+        next_ += 1;
+        return frame;
+    }
+
+    bool end_of_stream() const {
+        return next_ >= buffers_.get().size();
+    }
+
+private:
+    std::reference_wrapper<std::vector<RawPayload>> buffers_;
+    std::reference_wrapper<std::atomic<std::size_t>> released_;
+    std::size_t next_{};
+};
+
+class IntermittentSource {
+public:
+    using OutputPayload = RawPayload;
+    using OutputFrame = dpipe::Frame<OutputPayload>;
+
+    explicit IntermittentSource(uint8_t target_level)
+            : target_level_{target_level} {}
+
+    std::optional<OutputFrame> produce() {
+        // Have no data every other poll.
+        polls_ += 1;
+        if (polls_ % 2 == 0 || counter_ >= target_level_) {
+            return {};
+        }
+        auto frame = dpipe::Frame<RawPayload>::make(counter_);
+        counter_ += 1;
+        return frame;
+    }
+
+    bool end_of_stream() const {
+        return counter_ >= target_level_;
+    }
+
+private:
+    uint8_t target_level_{};
+    uint8_t counter_{};
+    uint64_t polls_{};
+};
+
+class SilentSource {
+public:
+    using OutputPayload = RawPayload;
+    using OutputFrame = dpipe::Frame<OutputPayload>;
+
+    explicit SilentSource(std::atomic<uint64_t>& polls)
+            : polls_{polls} {}
+
+    std::optional<OutputFrame> produce() {
+        // Stay idle until drained, counting polls.
+        polls_.get() += 1;
+        return {};
+    }
+
+private:
+    std::reference_wrapper<std::atomic<uint64_t>> polls_;
+};
+
+class EndlessSource {
+public:
+    using OutputPayload = RawPayload;
+    using OutputFrame = dpipe::Frame<OutputPayload>;
+
+    explicit EndlessSource(std::atomic<uint64_t>& produced)
+            : produced_{produced} {}
+
+    std::optional<OutputFrame> produce() {
+        // Never reach the end of stream, counting produced frames.
+        auto frame = dpipe::Frame<RawPayload>::make(static_cast<uint8_t>(produced_.get().load()));
+        produced_.get() += 1;
+        return frame;
+    }
+
+private:
+    std::reference_wrapper<std::atomic<uint64_t>> produced_;
+};
+
+#if !defined(_WIN32)
+class TimerSource {
+public:
+    using OutputPayload = RawPayload;
+    using OutputFrame = dpipe::Frame<OutputPayload>;
+
+    TimerSource(dpipe::EventLoop& loop, uint8_t target_level, std::chrono::microseconds period)
+            : loop_{loop}
+            , target_level_{target_level}
+            , period_{period} {}
+
+    dpipe::Async<std::optional<OutputFrame>> produce() {
+        if (counter_ >= target_level_) {
+            co_return std::nullopt;
+        }
+        // Produce a frame per period, letting other coroutines run meanwhile.
+        co_await loop_.get().sleep_for(period_);
+        auto frame = dpipe::Frame<RawPayload>::make(counter_);
+        counter_ += 1;
+        co_return frame;
+    }
+
+    bool end_of_stream() const {
+        return counter_ >= target_level_;
+    }
+
 private:
+    std::reference_wrapper<dpipe::EventLoop> loop_;
     uint8_t target_level_{};
+    std::chrono::microseconds period_{};
     uint8_t counter_{};
 };
 
+class FdSource {
+public:
+    using OutputPayload = RawPayload;
+    using OutputFrame = dpipe::Frame<OutputPayload>;
+
+    FdSource(dpipe::EventLoop& loop, int fd)
+            : loop_{loop}
+            , fd_{fd} {}
+
+    dpipe::Async<std::optional<OutputFrame>> produce() {
+        // Turn every byte read from the file descriptor into a frame, until it is closed.
+        co_await loop_.get().readable(fd_);
+        uint8_t level = 0;
+        if (::read(fd_, &level, 1) != 1) {
+            closed_ = true;
+            co_return std::nullopt;
+        }
+        co_return dpipe::Frame<RawPayload>::make(level);
+    }
+
+    bool end_of_stream() const {
+        return closed_;
+    }
+
+private:
+    std::reference_wrapper<dpipe::EventLoop> loop_;
+    int fd_{};
+    bool closed_{false};
+};
+
+class DelayFilter {
+public:
+    using InputPayload = RawPayload;
+    using OutputPayload = RawPayload;
+    using InputFrame = dpipe::Frame<InputPayload>;
+    using OutputFrame = dpipe::Frame<OutputPayload>;
+
+    explicit DelayFilter(dpipe::EventLoop& loop)
+            : loop_{loop} {}
+
+    dpipe::Async<std::optional<OutputFrame>> process(InputFrame&& frame) {
+        // Hold frames for a variable amount of time, dropping the odd ones.
+        co_await loop_.get().sleep_for(std::chrono::microseconds((frame->level % 3) * 200));
+        if (frame->level % 2 != 0) {
+            co_return std::nullopt;
+        }
+        co_return std::move(frame);
+    }
+
+private:
+    std::reference_wrapper<dpipe::EventLoop> loop_;
+};
+#endif
+
 class ShiftUpFilter {
 public:
     using InputPayload = RawPayload;
@@ -53,8 +290,8 @@ public:
             : amount_{amount} {}
 
     std::optional<OutputFrame> process(InputFrame&& frame) {
-        // Clone a frame into a new mutable one.
-        auto shifted_frame = dpipe::MutFrame<RawPayload>::make(*frame);
+        // Turn the frame into a mutable one, cloning it only if shared.
+        auto shifted_frame = dpipe::MutFrame<RawPayload>::from(std::move(frame));
         if (RawPayload::MAX_LEVEL - shifted_frame->level >= amount_) {
             shifted_frame->level += amount_;
         } else {
@@ -73,6 +310,7 @@ public:
     using OutputPayload = RawPayload;
     using InputFrame = dpipe::Frame<InputPayload>;
     using OutputFrame = dpipe::Frame<OutputPayload>;
+    static constexpr const char* TRACE_NAME = "Threshold";
 
     explicit ThresholdFilter(uint8_t threshold)
             : threshold_{threshold} {}
@@ -85,10 +323,123 @@ public:
         return frame;
     }
 
+    void process_batch(std::span<InputFrame> frames, std::vector<OutputFrame>& outputs) {
+        // Same as above, a whole batch at once.
+        for (auto& frame : frames) {
+            if (frame->level >= threshold_) {
+                outputs.push_back(std::move(frame));
+            }
+        }
+    }
+
 private:
     uint8_t threshold_{};
 };
 
+class JitterFilter {
+public:
+    using InputPayload = RawPayload;
+    using OutputPayload = RawPayload;
+    using InputFrame = dpipe::Frame<InputPayload>;
+    using OutputFrame = dpipe::Frame<OutputPayload>;
+
+    std::optional<OutputFrame> process(InputFrame&& frame) {
+        // Take a variable amount of time, so that parallel instances finish out of order.
+        std::this_thread::sleep_for(std::chrono::microseconds((frame->level % 3) * 200));
+        return frame;
+    }
+};
+
+class HoldBackFilter {
+public:
+    using InputPayload = RawPayload;
+    using OutputPayload = RawPayload;
+    using InputFrame = dpipe::Frame<InputPayload>;
+    using OutputFrame = dpipe::Frame<OutputPayload>;
+
+    std::optional<OutputFrame> process(InputFrame&& frame) {
+        // Forward the previous frame, holding the current one.
+        auto previous = std::move(held_);
+        held_ = std::move(frame);
+        return previous;
+    }
+
+    std::optional<OutputFrame> finish() {
+        // Flush the held frame at the end of stream.
+        return std::move(held_);
+    }
+
+private:
+    std::optional<InputFrame> held_;
+};
+
+class ThreadProbeFilter {
+public:
+    using InputPayload = RawPayload;
+    using OutputPayload = RawPayload;
+    using InputFrame = dpipe::Frame<InputPayload>;
+    using OutputFrame = dpipe::Frame<OutputPayload>;
+
+    explicit ThreadProbeFilter(std::function<void()> probe)
+            : probe_{std::move(probe)} {}
+
+    std::optional<OutputFrame> process(InputFrame&& frame) {
+        // Inspect the thread running the filter.
+        probe_();
+        return frame;
+    }
+
+private:
+    std::function<void()> probe_;
+};
+
+struct StereoPayload {
+    RawPayload left{};
+    RawPayload right{};
+};
+
+class StereoSource {
+public:
+    using OutputPayload = StereoPayload;
+    using OutputFrame = dpipe::Frame<OutputPayload>;
+
+    explicit StereoSource(uint8_t target_level)
+            : target_level_{target_level} {}
+
+    std::optional<OutputFrame> produce() {
+        if (counter_ >= target_level_) {
+            return {};
+        }
+
+        auto frame = dpipe::Frame<StereoPayload>::make(RawPayload{counter_},
+                                                       RawPayload{RawPayload::MAX_LEVEL});
+        counter_ += 1;
+        return frame;
+    }
+
+    bool end_of_stream() const {
+        return counter_ >= target_level_;
+    }
+
+private:
+    uint8_t target_level_{};
+    uint8_t counter_{};
+};
+
+class LeftViewFilter {
+public:
+    using InputPayload = StereoPayload;
+    using OutputPayload = RawPayload;
+    using InputFrame = dpipe::Frame<InputPayload>;
+    using OutputFrame = dpipe::Frame<OutputPayload>;
+
+    std::optional<OutputFrame> process(InputFrame&& frame) {
+        // Forward one half of the frame, without copying it.
+        const auto& left = frame->left;
+        return OutputFrame::view_of(std::move(frame), left);
+    }
+};
+
 class CalibrationFilter {
 public:
     using InputPayload = RawPayload;
@@ -97,12 +448,81 @@ public:
     using OutputFrame = dpipe::Frame<OutputPayload>;
 
     std::optional<OutputFrame> process(InputFrame&& frame) {
-        // Create a new mutable frame from scratch.
-        auto calibrated_frame = dpipe::MutFrame<CalibratedPayload>::make();
+        // Create a new mutable frame from scratch, recycling the memory of released frames.
+        auto calibrated_frame = dpipe::MutFrame<CalibratedPayload>::make(pool_);
         calibrated_frame->percentage = static_cast<float>(frame->level) * 100.0;
         calibrated_frame->percentage /= RawPayload::MAX_LEVEL;
         return calibrated_frame;
     }
+
+private:
+    dpipe::FramePool<CalibratedPayload> pool_;
+};
+
+class BatchCalibrationFilter {
+public:
+    using InputPayload = dpipe::FrameBatch<RawPayload>;
+    using OutputPayload = dpipe::FrameBatch<CalibratedPayload>;
+
+    void process(const InputPayload& input, OutputPayload& output) {
+        // Same as CalibrationFilter, but over aligned columns, so that the loop is vectorised.
+        const auto levels = input.column<&RawPayload::level>();
+        auto percentages = output.column<&CalibratedPayload::percentage>();
+        for (std::size_t i = 0; i < levels.size(); ++i) {
+            percentages[i] = static_cast<float>(levels[i]) * SCALE;
+        }
+    }
+
+private:
+    static constexpr float SCALE = 100.0F / RawPayload::MAX_LEVEL;
+};
+
+class BatchShiftUpFilter {
+public:
+    using InputPayload = dpipe::FrameBatch<RawPayload>;
+    using OutputPayload = dpipe::FrameBatch<RawPayload>;
+
+    explicit BatchShiftUpFilter(uint8_t amount)
+            : amount_{amount} {}
+
+    void process(InputPayload& batch) {
+        // Modify the batch in place, cloning it only if shared.
+        for (auto& level : batch.column<&RawPayload::level>()) {
+            level += amount_;
+        }
+    }
+
+private:
+    uint8_t amount_{};
+};
+
+class BatchRebuildFilter {
+public:
+    using InputPayload = RawPayload;
+    using OutputPayload = RawPayload;
+    using InputFrame = dpipe::Frame<InputPayload>;
+    using OutputFrame = dpipe::Frame<OutputPayload>;
+
+    explicit BatchRebuildFilter(bool merge = false)
+            : merge_{merge} {}
+
+    void process_batch(std::span<InputFrame> frames, std::vector<OutputFrame>& outputs) {
+        // Create new frames, one per input frame, or a single one holding the highest level.
+        if (!merge_) {
+            for (const auto& frame : frames) {
+                outputs.push_back(OutputFrame::make(frame->level));
+            }
+            return;
+        }
+        uint8_t level = 0;
+        for (const auto& frame : frames) {
+            level = std::max(level, frame->level);
+        }
+        outputs.push_back(OutputFrame::make(level));
+    }
+
+private:
+    bool merge_{};
 };
 
 template <typename Payload>
@@ -123,4 +543,119 @@ private:
     std::reference_wrapper<uint64_t> counter_;
 };
 
+class UniqueCounterSink {
+public:
+    using InputPayload = RawPayload;
+    using InputFrame = dpipe::Frame<InputPayload>;
+
+    explicit UniqueCounterSink(uint64_t& counter)
+            : counter_{counter} {}
+
+    void consume(InputFrame&& frame) {
+        // Count incoming frames that could be modified in place.
+        counter_.get() += frame.is_unique() ? 1 : 0;
+    }
+
+private:
+    std::reference_wrapper<uint64_t> counter_;
+};
+
+class RecorderSink {
+public:
+    using InputPayload = RawPayload;
+    using InputFrame = dpipe::Frame<InputPayload>;
+
+    explicit RecorderSink(std::vector<uint8_t>& levels)
+            : levels_{levels} {}
+
+    void consume(InputFrame&& frame) {
+        // Record the level of incoming frames.
+        levels_.get().push_back(frame->level);
+    }
+
+private:
+    std::reference_wrapper<std::vector<uint8_t>> levels_;
+};
+
+class HeaderRecorderSink {
+public:
+    using InputPayload = RawPayload;
+    using InputFrame = dpipe::Frame<InputPayload>;
+
+    explicit HeaderRecorderSink(std::vector<dpipe::FrameHeader>& headers)
+            : headers_{headers} {}
+
+    void consume(InputFrame&& frame) {
+        // Record the header of incoming frames.
+        headers_.get().push_back(frame.header());
+    }
+
+private:
+    std::reference_wrapper<std::vector<dpipe::FrameHeader>> headers_;
+};
+
+class PercentageRecorderSink {
+public:
+    using InputPayload = CalibratedPayload;
+    using InputFrame = dpipe::Frame<InputPayload>;
+
+    explicit PercentageRecorderSink(std::vector<float>& percentages)
+            : percentages_{percentages} {}
+
+    void consume(InputFrame&& frame) {
+        // Record the percentage of incoming frames.
+        percentages_.get().push_back(frame->percentage);
+    }
+
+private:
+    std::reference_wrapper<std::vector<float>> percentages_;
+};
+
+class BatchRecorderSink {
+public:
+    using InputPayload = RawPayload;
+    using InputFrame = dpipe::Frame<InputPayload>;
+
+    explicit BatchRecorderSink(std::vector<std::size_t>& batch_sizes)
+            : batch_sizes_{batch_sizes} {}
+
+    void consume(InputFrame&& /* frame */) {
+        batch_sizes_.get().push_back(1);
+    }
+
+    void consume_batch(std::span<InputFrame> frames) {
+        // Record the size of incoming batches.
+        batch_sizes_.get().push_back(frames.size());
+    }
+
+private:
+    std::reference_wrapper<std::vector<std::size_t>> batch_sizes_;
+};
+
+class GatedSink {
+public:
+    using InputPayload = RawPayload;
+    using InputFrame = dpipe::Frame<InputPayload>;
+
+    GatedSink(const std::atomic<bool>& gate, std::atomic<uint64_t>& arrived,
+              std::vector<uint8_t>& levels)
+            : gate_{gate}
+            , arrived_{arrived}
+            , levels_{levels} {}
+
+    void consume(InputFrame&& frame) {
+        // Record incoming frames, but hold them until the gate opens.
+        arrived_.get() += 1;
+        while (!gate_.get().load()) {
+            std::this_thread::yield();
+        }
+        levels_.get().push_back(frame->level);
+    }
+
+private:
+    std::reference_wrapper<const std::atomic<bool>> gate_;
+    std::reference_wrapper<std::atomic<uint64_t>> arrived_;
+    std::reference_wrapper<std::vector<uint8_t>> levels_;
+};
+
 #endif // DPIPE_TESTS_TOYS_H_